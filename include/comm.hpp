@@ -4,6 +4,9 @@
 #include <cstdint>
 #include <nfl.hpp>
 #include "symenc.hpp"
+#include "macros.hpp"
+#include "rlweke.hpp"
+#include "poly_codec.hpp"
 
 /**
 @file
@@ -27,9 +30,11 @@ struct comm_msg_1_t
   /** Session ID */
   uint32_t sid;
   /** Receiver's RLWE sample for "branch 0" */
-  P p0;
+  packed_poly_t<P> p0;
   /** Seed for generation of common polynomial */
   uint8_t r_sid[sizeof(sid) + rbytes];
+  /** Seed from which the common polynomial m is expanded */
+  uint8_t seed[COMMON_POLY_SEEDBYTES];
 };
 
 /** Second message of [BDGM19] OT
@@ -45,7 +50,7 @@ struct comm_msg_2_t
   /** Session id */
   uint32_t sid;
   /** Sender's RLWE sample */
-  P pS;
+  packed_poly_t<P> pS;
   /**@{*/
   /** Signal as per [DXL12]
 
@@ -53,7 +58,7 @@ struct comm_msg_2_t
 secure key exchange scheme based on the learning with errors
 problem. Cryptology ePrint Archive, Report 2012/688, 2012.
 https://eprint.iacr.org/2012/688.*/
-  P signal0, signal1;
+  signal_bits_t<P::degree> signal0, signal1;
   /**@}*/
 
   /**@{*/
@@ -3,6 +3,9 @@
 
 #include <cstdint>
 #include "symenc.hpp"
+#include "macros.hpp"
+#include "rlweke.hpp"
+#include "poly_codec.hpp"
 #include <nfl.hpp>
 
 /**
@@ -24,9 +27,11 @@ struct comm_rot_msg_1_t
   /** Session ID */
   uint32_t sid;
   /** Receiver's RLWE sample for "branch 0" */
-  P p0;
+  packed_poly_t<P> p0;
   /** Seed for generation of common polynomial */
   uint8_t r_sid[sizeof(sid) + rbytes];
+  /** Seed from which the common polynomial m is expanded */
+  uint8_t seed[COMMON_POLY_SEEDBYTES];
 
   /**@{*/
   /** Commitment to receiver's random masks */
@@ -46,7 +51,7 @@ struct comm_rot_msg_2_t
   /** Session ID */
   uint32_t sid;
   /** Sender's RLWE sample */  
-  P pS;
+  packed_poly_t<P> pS;
 
   /**@{*/
   /** Signal as per [DXL12]
@@ -55,7 +60,7 @@ struct comm_rot_msg_2_t
 secure key exchange scheme based on the learning with errors
 problem. Cryptology ePrint Archive, Report 2012/688, 2012.
 https://eprint.iacr.org/2012/688.*/
-  P signal0, signal1;
+  signal_bits_t<P::degree> signal0, signal1;
   /**@}*/
 
   /** Random sender's mask */
@@ -0,0 +1,118 @@
+/**
+@file
+*/
+#ifndef __COMMON_POLY_HPP__
+#define __COMMON_POLY_HPP__
+#include <array>
+#include <cstring>
+#include <map>
+#include <vector>
+#include <nfl.hpp>
+#include "roms.hpp"
+#include "macros.hpp"
+
+/** Derives the common polynomial m from a seed with the polynomial ROM
+    (rom1_t), in the spirit of Kyber's matrix expansion. As the ROM output
+    is uniform in Zq, it is used directly as the NTT representation of m,
+    which is the form expected by alice_rot_t/bob_rot_t.
+
+    @tparam P NFL Polynomial type
+    @param m Returned common polynomial (NTT domain)
+    @param seed Public seed
+*/
+template<typename P>
+void expand_common_poly(P &m, const uint8_t seed[COMMON_POLY_SEEDBYTES])
+{
+  // Domain separation from the ROM applied on r_sid
+  uint8_t in[COMMON_POLY_SEEDBYTES + 1];
+  in[0] = 'm';
+  memcpy(&in[1], seed, COMMON_POLY_SEEDBYTES);
+
+  rom1_t<P> rom1;
+  rom_P_O<P> rom1_output(m);
+  rom1(rom1_output, in, sizeof(in));
+}
+
+/** Memoises the expansion of common polynomials per seed, so that the many
+    sessions sharing a seed only pay for one expansion and the wire only
+    needs to carry the seed.
+
+    The cache holds at most 'capacity' polynomials and evicts the oldest
+    entry when full. References returned by get() stay valid until the
+    entry is evicted. Not thread-safe: use one cache per thread.
+
+    @tparam P NFL Polynomial type
+*/
+template<typename P>
+struct common_poly_cache_t
+{
+  /** Seed type */
+  using seed_t = std::array<uint8_t, COMMON_POLY_SEEDBYTES>;
+  /** Aligned storage for the cached polynomials */
+  using poly_vector_t = std::vector<P, nfl::aligned_allocator<P, 64>>;
+
+  /** Cached polynomials */
+  poly_vector_t polys;
+  /** Seed of each slot of polys */
+  std::vector<seed_t> seeds;
+  /** Maps a seed to its slot in polys */
+  std::map<seed_t, size_t> index;
+  /** Next slot to be (re)used */
+  size_t next;
+  /**@{*/
+  /** Statistics */
+  size_t hits, misses;
+  /**@}*/
+
+  /** Constructor of the cache
+
+      @param capacity Maximum number of cached polynomials */
+  common_poly_cache_t(size_t capacity = 16)
+    : polys(capacity > 0 ? capacity : 1),
+      seeds(polys.size()),
+      next(0), hits(0), misses(0)
+  {
+  }
+
+  /** Samples a fresh public seed
+
+      @param seed Returned seed
+      @param ctx PRNG context */
+  static void new_seed(uint8_t seed[COMMON_POLY_SEEDBYTES],
+		       nfl::prng_ctx_t &ctx = nfl::default_prng_ctx())
+  {
+    nfl::fastrandombytes(ctx, seed, COMMON_POLY_SEEDBYTES);
+  }
+
+  /** Returns the common polynomial for seed, expanding it on a miss
+
+      @param seed Public seed
+      @return Common polynomial (NTT domain) */
+  const P &get(const uint8_t seed[COMMON_POLY_SEEDBYTES])
+  {
+    seed_t key;
+    memcpy(key.data(), seed, COMMON_POLY_SEEDBYTES);
+
+    typename std::map<seed_t, size_t>::const_iterator it = index.find(key);
+    if (it != index.end())
+      {
+	hits++;
+	return polys[it->second];
+      }
+
+    misses++;
+    size_t slot = next;
+    next = (next + 1) % polys.size();
+
+    if (misses > polys.size())
+      index.erase(seeds[slot]);
+
+    expand_common_poly<P>(polys[slot], seed);
+    seeds[slot] = key;
+    index[key] = slot;
+
+    return polys[slot];
+  }
+};
+
+#endif
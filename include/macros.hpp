@@ -8,5 +8,7 @@
 #define CEILING(x,y) (((x) + (y) - 1) / (y))
 #define MIN(x,y) ((x) < (y) ? (x) : (y))
 #define AES_OUTPUT_LENGTH(x) (CEILING(x, AES_BLOCK_SIZE) * AES_BLOCK_SIZE)
+/** Size of the seed from which the common polynomial is derived */
+#define COMMON_POLY_SEEDBYTES 32
 
 #endif
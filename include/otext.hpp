@@ -0,0 +1,318 @@
+/**
+@file
+
+IKNP OT extension seeded by the lattice ROT.
+
+[IKNP03] Yuval Ishai, Joe Kilian, Kobbi Nissim, and Erez Petrank.
+Extending oblivious transfers efficiently. In Dan Boneh, editor,
+CRYPTO 2003, pages 145–161. Springer, 2003.
+
+kappa base ROTs are run with reversed roles: the extension sender acts as
+Alice (alice_rot_t, learns (b, Mb)) and the extension receiver acts as
+Bob (bob_rot_t, learns (M0, M1)). The base ROT messages are then used as
+BLAKE3 keys of a PRG, and every extended OT only costs a few bits of PRG
+output, a bit-matrix transpose and a correlation-robust hash.
+*/
+#ifndef __OTEXT_HPP__
+#define __OTEXT_HPP__
+#include <cstdint>
+#include <cstring>
+#include "blake3.h"
+#if defined(NTT_AVX2) || defined(NTT_AVX512)
+#include <immintrin.h>
+#elif defined(NTT_SSE)
+#include <emmintrin.h>
+#endif
+
+/** Transposes a bit matrix. Bits are stored LSB first, i.e.
+    bit (x, y) of the input is (in[x * in_stride + y / 8] >> (y & 7)) & 1.
+
+    @param out Outputted matrix with ncols rows of nrows bits
+    @param in Inputted matrix with nrows rows of ncols bits
+    @param nrows Number of rows of the input (multiple of 8)
+    @param ncols Number of columns of the input (multiple of 8)
+    @param in_stride Bytes between two rows of the input (at least ncols / 8)
+*/
+inline void transpose_bits(uint8_t *out, const uint8_t *in,
+			   size_t nrows, size_t ncols, size_t in_stride)
+{
+  const size_t out_stride = nrows / 8;
+  size_t rr = 0;
+
+#if defined(NTT_AVX2) || defined(NTT_AVX512)
+  // 32 rows at a time: gather one byte per row, then each movemask
+  // extracts one output column of 32 bits
+  for (; rr + 32 <= nrows; rr += 32)
+    {
+      for (size_t cc = 0; cc < ncols; cc += 8)
+	{
+	  alignas(32) uint8_t col[32];
+	  for (size_t i = 0; i < 32; i++)
+	    col[i] = in[(rr + i) * in_stride + cc / 8];
+
+	  __m256i v = _mm256_load_si256((const __m256i *)col);
+	  for (int i = 7; i >= 0; i--)
+	    {
+	      uint32_t mask = _mm256_movemask_epi8(v);
+	      memcpy(&out[(cc + i) * out_stride + rr / 8], &mask, sizeof(mask));
+	      v = _mm256_slli_epi64(v, 1);
+	    }
+	}
+    }
+#endif
+#if defined(NTT_AVX2) || defined(NTT_AVX512) || defined(NTT_SSE)
+  // 16 rows at a time
+  for (; rr + 16 <= nrows; rr += 16)
+    {
+      for (size_t cc = 0; cc < ncols; cc += 8)
+	{
+	  alignas(16) uint8_t col[16];
+	  for (size_t i = 0; i < 16; i++)
+	    col[i] = in[(rr + i) * in_stride + cc / 8];
+
+	  __m128i v = _mm_load_si128((const __m128i *)col);
+	  for (int i = 7; i >= 0; i--)
+	    {
+	      uint16_t mask = _mm_movemask_epi8(v);
+	      memcpy(&out[(cc + i) * out_stride + rr / 8], &mask, sizeof(mask));
+	      v = _mm_slli_epi64(v, 1);
+	    }
+	}
+    }
+#endif
+  // Remaining rows, 8 at a time
+  for (; rr < nrows; rr += 8)
+    {
+      for (size_t cc = 0; cc < ncols; cc += 8)
+	{
+	  uint64_t x = 0;
+	  for (size_t i = 0; i < 8; i++)
+	    x |= (uint64_t)in[(rr + i) * in_stride + cc / 8] << (8 * i);
+
+	  for (size_t i = 0; i < 8; i++)
+	    {
+	      uint8_t b = 0;
+	      for (size_t l = 0; l < 8; l++)
+		b |= ((x >> (8 * l + i)) & 1) << l;
+	      out[(cc + i) * out_stride + rr / 8] = b;
+	    }
+	}
+    }
+}
+
+/** Pseudo-random generator keyed by a base ROT message (BLAKE3 XOF) */
+struct otext_prg_t
+{
+  /** Keyed BLAKE3 state */
+  blake3_hasher hasher;
+
+  /** Keys the PRG
+
+      @param key Base ROT message */
+  void seed(const uint8_t key[BLAKE3_KEY_LEN])
+  {
+    blake3_hasher_init_keyed(&hasher, key);
+  }
+
+  /** Outputs len bytes of the PRG stream starting at offset
+
+      @param out Outputted bytes
+      @param offset Position in the PRG stream
+      @param len Number of bytes */
+  void expand(uint8_t *out, uint64_t offset, size_t len)
+  {
+    blake3_hasher_finalize_seek(&hasher, offset, out, len);
+  }
+};
+
+/** Correlation-robust hash H(j, q) used to derive the extended OT messages
+
+    @param out Outputted message
+    @param j Index of the extended OT
+    @param q Row of the transposed matrix
+    @tparam qbytes Size of q
+    @tparam msgbytes Size of the output
+*/
+template<size_t qbytes, size_t msgbytes>
+void otext_hash(uint8_t out[msgbytes], uint64_t j, const uint8_t q[qbytes])
+{
+  blake3_hasher hasher;
+  blake3_hasher_init(&hasher);
+  blake3_hasher_update(&hasher, &j, sizeof(j));
+  blake3_hasher_update(&hasher, q, qbytes);
+  blake3_hasher_finalize(&hasher, out, msgbytes);
+}
+
+/** Implements the sender of the IKNP OT extension (semi-honest).
+    The sender plays Alice in the base ROTs.
+
+    @tparam kappa Number of base ROTs (security parameter)
+    @tparam msgbytes Size of the extended OT messages
+    @tparam block Number of OTs processed per pass (cache blocking)
+*/
+template<size_t kappa = 128, size_t msgbytes = 16, size_t block = 1024>
+struct iknp_sender_t
+{
+  static_assert(kappa % 8 == 0);
+  static_assert(block % 8 == 0);
+
+  /** Base ROT choice bits, s */
+  int s[kappa];
+  /** s packed as a bit string */
+  uint8_t s_packed[kappa / 8];
+  /** PRGs keyed with the base ROT messages k_{s_i} */
+  otext_prg_t prg[kappa];
+  /** Number of OTs extended so far */
+  uint64_t offset;
+
+  /**@{*/
+  /** Block of the matrix Q, column-wise and transposed */
+  uint8_t q_cols[kappa][block / 8];
+  uint8_t q_rows[block][kappa / 8];
+  /**@}*/
+
+  /** Initializes the sender with the outputs of kappa base ROTs
+      (alice_rot_t::msg2)
+
+      @param b Base ROT channels
+      @param Mb Base ROT messages */
+  void set_base(const int *b, const uint8_t (*Mb)[BLAKE3_KEY_LEN])
+  {
+    memset(s_packed, 0, sizeof(s_packed));
+    for (size_t i = 0; i < kappa; i++)
+      {
+	s[i] = b[i] & 1;
+	s_packed[i / 8] |= s[i] << (i & 7);
+	prg[i].seed(Mb[i]);
+      }
+    offset = 0;
+  }
+
+  /** Computes the next m extended OTs
+
+      @param x0 Outputted messages of channel 0 (m entries)
+      @param x1 Outputted messages of channel 1 (m entries)
+      @param u Receiver's correction matrix (kappa rows of m bits)
+      @param m Number of OTs (multiple of 8)
+      @return False when m is not a multiple of 8 */
+  bool extend(uint8_t (*x0)[msgbytes], uint8_t (*x1)[msgbytes],
+	      const uint8_t *u, size_t m)
+  {
+    if (m % 8 != 0)
+      return false;
+
+    for (size_t j0 = 0; j0 < m; j0 += block)
+      {
+	const size_t blk = (m - j0 < block) ? m - j0 : block;
+
+	for (size_t i = 0; i < kappa; i++)
+	  {
+	    prg[i].expand(q_cols[i], (offset + j0) / 8, blk / 8);
+	    if (s[i])
+	      {
+		const uint8_t *ui = &u[i * (m / 8) + j0 / 8];
+		for (size_t l = 0; l < blk / 8; l++)
+		  q_cols[i][l] ^= ui[l];
+	      }
+	  }
+
+	transpose_bits(&q_rows[0][0], &q_cols[0][0], kappa, blk, block / 8);
+
+	for (size_t j = 0; j < blk; j++)
+	  {
+	    otext_hash<kappa / 8, msgbytes>(x0[j0 + j], offset + j0 + j, q_rows[j]);
+	    for (size_t l = 0; l < kappa / 8; l++)
+	      q_rows[j][l] ^= s_packed[l];
+	    otext_hash<kappa / 8, msgbytes>(x1[j0 + j], offset + j0 + j, q_rows[j]);
+	  }
+      }
+
+    offset += m;
+    return true;
+  }
+};
+
+/** Implements the receiver of the IKNP OT extension (semi-honest).
+    The receiver plays Bob in the base ROTs.
+
+    @tparam kappa Number of base ROTs (security parameter)
+    @tparam msgbytes Size of the extended OT messages
+    @tparam block Number of OTs processed per pass (cache blocking)
+*/
+template<size_t kappa = 128, size_t msgbytes = 16, size_t block = 1024>
+struct iknp_receiver_t
+{
+  static_assert(kappa % 8 == 0);
+  static_assert(block % 8 == 0);
+
+  /**@{*/
+  /** PRGs keyed with the base ROT messages k0_i, k1_i */
+  otext_prg_t prg0[kappa];
+  otext_prg_t prg1[kappa];
+  /**@}*/
+  /** Number of OTs extended so far */
+  uint64_t offset;
+
+  /**@{*/
+  /** Block of the matrix T, column-wise and transposed */
+  uint8_t t_cols[kappa][block / 8];
+  uint8_t t_rows[block][kappa / 8];
+  /**@}*/
+  /** PRG output of the k1_i keys */
+  uint8_t g1[block / 8];
+
+  /** Initializes the receiver with the outputs of kappa base ROTs
+      (bob_rot_t::msg2)
+
+      @param M0 Base ROT messages of channel 0
+      @param M1 Base ROT messages of channel 1 */
+  void set_base(const uint8_t (*M0)[BLAKE3_KEY_LEN],
+		const uint8_t (*M1)[BLAKE3_KEY_LEN])
+  {
+    for (size_t i = 0; i < kappa; i++)
+      {
+	prg0[i].seed(M0[i]);
+	prg1[i].seed(M1[i]);
+      }
+    offset = 0;
+  }
+
+  /** Computes the next m extended OTs
+
+      @param u Outputted correction matrix to be sent (kappa rows of m bits)
+      @param xr Outputted messages of the chosen channels (m entries)
+      @param r Choice bits, packed LSB first (m bits)
+      @param m Number of OTs (multiple of 8)
+      @return False when m is not a multiple of 8 */
+  bool extend(uint8_t *u, uint8_t (*xr)[msgbytes],
+	      const uint8_t *r, size_t m)
+  {
+    if (m % 8 != 0)
+      return false;
+
+    for (size_t j0 = 0; j0 < m; j0 += block)
+      {
+	const size_t blk = (m - j0 < block) ? m - j0 : block;
+
+	for (size_t i = 0; i < kappa; i++)
+	  {
+	    prg0[i].expand(t_cols[i], (offset + j0) / 8, blk / 8);
+	    prg1[i].expand(g1, (offset + j0) / 8, blk / 8);
+
+	    uint8_t *ui = &u[i * (m / 8) + j0 / 8];
+	    for (size_t l = 0; l < blk / 8; l++)
+	      ui[l] = t_cols[i][l] ^ g1[l] ^ r[j0 / 8 + l];
+	  }
+
+	transpose_bits(&t_rows[0][0], &t_cols[0][0], kappa, blk, block / 8);
+
+	for (size_t j = 0; j < blk; j++)
+	  otext_hash<kappa / 8, msgbytes>(xr[j0 + j], offset + j0 + j, t_rows[j]);
+      }
+
+    offset += m;
+    return true;
+  }
+};
+
+#endif
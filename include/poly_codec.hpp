@@ -0,0 +1,232 @@
+/**
+@file
+
+Compact serialisation of NFL polynomials: every coefficient takes
+params<T>::kModulusBitsize bits instead of 8 * sizeof(T), e.g. 896 bytes
+instead of 1024 for the 14-bit moduli of params<uint16_t> and N=512.
+Coefficient i starts at bit i * nbits of the little endian bit stream.
+*/
+#ifndef __POLY_CODEC_HPP__
+#define __POLY_CODEC_HPP__
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <nfl.hpp>
+#include "macros.hpp"
+#if defined(NTT_AVX2) || defined(NTT_AVX512)
+#include <immintrin.h>
+#endif
+
+#if defined(NTT_AVX2) || defined(NTT_AVX512)
+/** Packs 16 coefficients of 14 bits into 28 bytes
+
+    @param out Outputted 28 bytes, followed by 2 bytes of padding (30 bytes
+    must be writable)
+    @param in 16 coefficients (32-byte aligned)
+*/
+inline void pack14_block(uint8_t *out, const uint16_t *in)
+{
+  const __m256i shuf = _mm256_setr_epi8(0, 1, 2, 3, 4, 5, 6, 8, 9, 10, 11, 12, 13, 14, -1, -1,
+					0, 1, 2, 3, 4, 5, 6, 8, 9, 10, 11, 12, 13, 14, -1, -1);
+  __m256i v = _mm256_load_si256((const __m256i *)in);
+
+  // c0 | c1 << 14 in 32-bit lanes, then d0 | d1 << 28 in 64-bit lanes
+  __m256i d = _mm256_madd_epi16(v, _mm256_set1_epi32(0x40000001));
+  __m256i q = _mm256_or_si256(_mm256_and_si256(d, _mm256_set1_epi64x(0xFFFFFFFF)),
+			      _mm256_slli_epi64(_mm256_srli_epi64(d, 32), 28));
+
+  // 7 bytes out of each 64-bit lane, 14 bytes per 128-bit lane
+  q = _mm256_shuffle_epi8(q, shuf);
+  _mm_storeu_si128((__m128i *)out, _mm256_castsi256_si128(q));
+  _mm_storeu_si128((__m128i *)(out + 14), _mm256_extracti128_si256(q, 1));
+}
+
+/** Unpacks 16 words of 14 bits from 28 bytes into 16-bit lanes
+
+    @param in 28 bytes, 32 of which must be readable
+    @return Unpacked words
+*/
+inline __m256i unpack14_vec(const uint8_t *in)
+{
+  const __m256i shuf = _mm256_setr_epi8(0, 1, 2, 3, 4, 5, 6, -1, 7, 8, 9, 10, 11, 12, 13, -1,
+					0, 1, 2, 3, 4, 5, 6, -1, 7, 8, 9, 10, 11, 12, 13, -1);
+  __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)in)),
+				      _mm_loadu_si128((const __m128i *)(in + 14)), 1);
+  v = _mm256_shuffle_epi8(v, shuf);
+
+  __m256i d = _mm256_or_si256(_mm256_and_si256(v, _mm256_set1_epi64x(0xFFFFFFF)),
+			      _mm256_slli_epi64(_mm256_srli_epi64(v, 28), 32));
+  return _mm256_or_si256(_mm256_and_si256(d, _mm256_set1_epi32(0x3FFF)),
+			 _mm256_slli_epi32(_mm256_srli_epi32(d, 14), 16));
+}
+
+/** Unpacks 16 coefficients of 14 bits from 28 bytes
+
+    @param out 16 outputted coefficients (32-byte aligned)
+    @param in 28 bytes, 32 of which must be readable
+    @param q Modulus
+    @return True when all coefficients are smaller than q
+*/
+inline bool unpack14_block(uint16_t *out, const uint8_t *in, uint16_t q)
+{
+  __m256i v = unpack14_vec(in);
+  _mm256_store_si256((__m256i *)out, v);
+
+  return _mm256_movemask_epi8(_mm256_cmpgt_epi16(v, _mm256_set1_epi16(q - 1))) == 0;
+}
+
+/** Number of coefficients handled by pack14_block/unpack14_block */
+#define PACK14_BLOCK 16
+#endif
+
+/** Packs and unpacks polynomials to nbits per coefficient
+
+    @tparam P NFL Polynomial type
+*/
+template<typename P>
+struct poly_codec_t
+{
+  /** Type of polynomial coefficients */
+  using value_t = typename P::value_type;
+  /** Bits per coefficient */
+  static constexpr size_t nbits = P::nbits;
+  /** Number of coefficients over all moduli */
+  static constexpr size_t ncoeffs = P::degree * P::nmoduli;
+  /** Size of a packed polynomial */
+  static constexpr size_t bytes = CEILING(ncoeffs * nbits, 8);
+  /** Bit accumulator, holding a coefficient plus up to 7 pending bits */
+  using acc_t = typename std::conditional<(nbits > 56), typename nfl::params<value_t>::greater_value_type,
+					  uint64_t>::type;
+
+#ifdef PACK14_BLOCK
+  /** Whether the SIMD kernels apply to P */
+  using simd_t = std::integral_constant<bool, std::is_same<value_t, uint16_t>::value &&
+					nbits == 14 && P::degree % PACK14_BLOCK == 0>;
+#else
+  using simd_t = std::false_type;
+#endif
+
+  /** Packs a polynomial
+
+      @param out Outputted packed polynomial
+      @param p Polynomial with coefficients reduced modulo q */
+  static void pack(uint8_t out[bytes], const P &p)
+  {
+    pack(out, p, simd_t());
+  }
+
+  /** Unpacks a polynomial
+
+      @param p Outputted polynomial
+      @param in Packed polynomial
+      @return False when a coefficient is not reduced modulo q, in which
+      case p must be discarded */
+  static bool unpack(P &p, const uint8_t in[bytes])
+  {
+    return unpack(p, in, simd_t());
+  }
+
+  /**@{*/
+  /** Portable implementations */
+  static void pack(uint8_t out[bytes], const P &p, std::false_type)
+  {
+    acc_t acc = 0;
+    size_t nacc = 0, j = 0;
+
+    for (size_t i = 0; i < ncoeffs; i++)
+      {
+	acc |= (acc_t)p.begin()[i] << nacc;
+	nacc += nbits;
+	for (; nacc >= 8; nacc -= 8, acc >>= 8)
+	  out[j++] = (uint8_t)acc;
+      }
+    if (nacc > 0)
+      out[j] = (uint8_t)acc;
+  }
+
+  static bool unpack(P &p, const uint8_t in[bytes], std::false_type)
+  {
+    const acc_t mask = ((acc_t)1 << nbits) - 1;
+    acc_t acc = 0;
+    size_t nacc = 0, j = 0;
+    bool valid = true;
+
+    for (size_t i = 0; i < ncoeffs; i++)
+      {
+	for (; nacc < nbits; nacc += 8)
+	  acc |= (acc_t)in[j++] << nacc;
+	p.begin()[i] = (value_t)(acc & mask);
+	acc >>= nbits;
+	nacc -= nbits;
+	valid = valid && (p.begin()[i] < P::get_modulus(i / P::degree));
+      }
+    return valid;
+  }
+  /**@}*/
+
+#ifdef PACK14_BLOCK
+  /**@{*/
+  /** SIMD implementations */
+  static void pack(uint8_t out[bytes], const P &p, std::true_type)
+  {
+    constexpr size_t block_bytes = PACK14_BLOCK * 14 / 8;
+    size_t i = 0;
+
+    // The kernel may write up to 2 bytes past its block
+    for (; i + PACK14_BLOCK < ncoeffs; i += PACK14_BLOCK)
+      pack14_block(&out[i * 14 / 8], &p.begin()[i]);
+
+    uint8_t last[block_bytes + 2];
+    pack14_block(last, &p.begin()[i]);
+    memcpy(&out[i * 14 / 8], last, block_bytes);
+  }
+
+  static bool unpack(P &p, const uint8_t in[bytes], std::true_type)
+  {
+    constexpr size_t block_bytes = PACK14_BLOCK * 14 / 8;
+    bool valid = true;
+    size_t i = 0;
+
+    // The kernel may read up to 4 bytes past its block
+    for (; i + PACK14_BLOCK < ncoeffs; i += PACK14_BLOCK)
+      valid &= unpack14_block(&p.begin()[i], &in[i * 14 / 8], P::get_modulus(i / P::degree));
+
+    uint8_t last[block_bytes + 4] = {0};
+    memcpy(last, &in[i * 14 / 8], block_bytes);
+    valid &= unpack14_block(&p.begin()[i], last, P::get_modulus(i / P::degree));
+
+    return valid;
+  }
+  /**@}*/
+#endif
+};
+
+/** Polynomial stored packed with poly_codec_t, e.g. in protocol messages
+
+    @tparam P NFL Polynomial type
+*/
+template<typename P>
+struct packed_poly_t
+{
+  /** Packed coefficients */
+  uint8_t data[poly_codec_t<P>::bytes];
+
+  /** Packs a polynomial
+
+      @param p Polynomial with coefficients reduced modulo q */
+  void pack(const P &p)
+  {
+    poly_codec_t<P>::pack(data, p);
+  }
+
+  /** Unpacks the polynomial
+
+      @param p Outputted polynomial
+      @return False when the packed polynomial is malformed */
+  bool unpack(P &p) const
+  {
+    return poly_codec_t<P>::unpack(p, data);
+  }
+};
+
+#endif
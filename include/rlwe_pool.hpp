@@ -0,0 +1,249 @@
+/**
+@file
+
+Offline/online split of the RLWE sampling in (R)OT msg1: the secret, the
+errors and the sample p = m * s + e do not depend on the peer's message, so
+they can be computed ahead of time by a background thread and consumed by
+the msg1_online variants of alice_ot_t, bob_ot_t, alice_rot_t and bob_rot_t.
+*/
+#ifndef __RLWE_POOL_HPP__
+#define __RLWE_POOL_HPP__
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <nfl.hpp>
+#include "rlweke.hpp"
+
+/** Precomputed RLWE sample
+
+    @tparam P NFL Polynomial type
+*/
+template<typename P>
+struct rlwe_sample_t
+{
+  /** Type of polynomial coefficients */
+  using value_t = typename P::value_type;
+
+  /** Secret (NTT domain) */
+  P s;
+  /** Error added to the shared key (coefficient domain) */
+  P e1;
+  /** RLWE sample m * s + e (NTT domain) */
+  P p;
+
+  /** Draws a new sample
+
+      @param m Common polynomial (NTT domain)
+      @param g_prng Gaussian Noise sampler
+      @param ctx PRNG context */
+  void sample(const P &m, nfl::FastGaussianNoise<uint8_t, value_t, 2> *g_prng,
+	      nfl::prng_ctx_t &ctx)
+  {
+    P e;
+
+    s = nfl::gaussian<uint8_t, value_t, 2>(g_prng, 1, &ctx);
+    e = nfl::gaussian<uint8_t, value_t, 2>(g_prng, 2, &ctx);
+    e1 = nfl::gaussian<uint8_t, value_t, 2>(g_prng, 2, &ctx);
+    s.ntt_pow_phi();
+    e.ntt_pow_phi();
+    p = m * s + e;
+  }
+};
+
+/** Pool of RLWE samples for one common polynomial, filled by a background
+    thread with its own sampler and PRNG context.
+
+    Samples go through a single-producer single-consumer ring: pop() and
+    try_pop() are lock-free and must all be called from the same thread.
+    Once the ring is full the producer sleeps until half of it has been
+    consumed, so that the consumer only pays for a wake-up every
+    capacity() / 2 samples.
+
+    On devices without a spare core the pool can be built without producer
+    thread and topped up with refill() in idle time between sessions.
+
+    @tparam P NFL Polynomial type
+*/
+template<typename P>
+struct rlwe_pool_t
+{
+  /** Type of polynomial coefficients */
+  using value_t = typename P::value_type;
+  /** Sample type */
+  using sample_t = rlwe_sample_t<P>;
+  /** Aligned storage for the ring */
+  using sample_vector_t = std::vector<sample_t, nfl::aligned_allocator<sample_t, 64>>;
+
+  /** Common polynomial (NTT domain) */
+  P m;
+  /** Gaussian Noise sampler of the producer */
+  std::unique_ptr<nfl::FastGaussianNoise<uint8_t, value_t, 2>> g_prng;
+  /** PRNG context of the producer */
+  nfl::prng_ctx_t ctx;
+
+  /** Ring of samples */
+  sample_vector_t ring;
+  /** ring.size() - 1, ring.size() being a power of 2 */
+  size_t mask;
+
+  /**@{*/
+  /** Number of popped and pushed samples, on separate cache lines */
+  std::atomic<size_t> head;
+  char pad0[64];
+  std::atomic<size_t> tail;
+  char pad1[64];
+  /**@}*/
+
+  /**@{*/
+  /** Sleeping of the producer while the ring is full */
+  std::mutex mtx;
+  std::condition_variable cv;
+  std::atomic<bool> waiting;
+  std::atomic<bool> stop;
+  /**@}*/
+
+  /** Producer thread (not joinable without background producer) */
+  std::thread producer;
+
+  /**@{*/
+  /** Samples served from the ring, and computed by pop() on an empty ring */
+  size_t hits, misses;
+  /**@}*/
+
+  /** Constructor of the pool
+
+      @param _m Common polynomial (NTT domain)
+      @param sigma Standard deviation of the Gaussian Noise sampler
+      @param security Security parameter of the Gaussian Noise sampler
+      @param capacity Number of samples kept ready, rounded up to a power of 2
+      @param background Whether to start a producer thread, otherwise the
+      ring is only filled by refill() */
+  rlwe_pool_t(const P &_m, double sigma, unsigned security = 138, size_t capacity = 64,
+	      bool background = true)
+    : m(_m),
+      g_prng(new nfl::FastGaussianNoise<uint8_t, value_t, 2>(sigma, security, P::degree)),
+      head(0), tail(0), waiting(false), stop(false), hits(0), misses(0)
+  {
+    size_t n = 2;
+    while (n < capacity)
+      n <<= 1;
+    ring.resize(n);
+    mask = n - 1;
+
+    if (background)
+      producer = std::thread(&rlwe_pool_t::produce, this);
+  }
+
+  /** Stops and joins the producer */
+  ~rlwe_pool_t()
+  {
+    stop = true;
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      cv.notify_one();
+    }
+    if (producer.joinable())
+      producer.join();
+  }
+
+  /** @return Number of samples kept ready */
+  size_t capacity() const
+  {
+    return ring.size();
+  }
+
+  /** @return Number of samples currently ready */
+  size_t size() const
+  {
+    return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+  }
+
+  /** Blocks until the producer has filled the ring and sleeps, e.g. before
+      timing the online phase */
+  void wait_idle() const
+  {
+    while (producer.joinable() && !waiting.load())
+      std::this_thread::yield();
+  }
+
+  /** Fills the ring from the calling thread. Only for pools without
+      background producer, and from the thread calling pop(). */
+  void refill()
+  {
+    size_t h = head.load(std::memory_order_relaxed);
+    for (size_t t = tail.load(std::memory_order_relaxed); t - h < ring.size(); t++)
+      {
+	ring[t & mask].sample(m, g_prng.get(), ctx);
+	tail.store(t + 1, std::memory_order_release);
+      }
+  }
+
+  /** Takes a sample from the ring
+
+      @param out Outputted sample
+      @return False when the ring is empty */
+  bool try_pop(sample_t &out)
+  {
+    size_t h = head.load(std::memory_order_relaxed);
+    if (h == tail.load(std::memory_order_acquire))
+      return false;
+
+    out = ring[h & mask];
+    head.store(h + 1);
+
+    if (waiting.load() &&
+	tail.load(std::memory_order_relaxed) - (h + 1) <= ring.size() / 2)
+      {
+	std::lock_guard<std::mutex> lock(mtx);
+	cv.notify_one();
+      }
+    return true;
+  }
+
+  /** Takes a sample from the ring, or computes it when the ring is empty
+
+      @param out Outputted sample
+      @param _g_prng Gaussian Noise sampler of the calling thread
+      @param _ctx PRNG context of the calling thread */
+  void pop(sample_t &out, nfl::FastGaussianNoise<uint8_t, value_t, 2> *_g_prng,
+	   nfl::prng_ctx_t &_ctx)
+  {
+    if (try_pop(out))
+      {
+	hits++;
+      }
+    else
+      {
+	misses++;
+	out.sample(m, _g_prng, _ctx);
+      }
+  }
+
+  /** Body of the producer thread */
+  void produce()
+  {
+    while (!stop.load(std::memory_order_relaxed))
+      {
+	size_t t = tail.load(std::memory_order_relaxed);
+
+	if (t - head.load() == ring.size())
+	  {
+	    // head and waiting are sequentially consistent, so either the
+	    // consumer sees waiting or the predicate sees its last pop
+	    std::unique_lock<std::mutex> lock(mtx);
+	    waiting = true;
+	    cv.wait(lock, [&] { return stop.load() || t - head.load() <= ring.size() / 2; });
+	    waiting = false;
+	    continue;
+	  }
+
+	ring[t & mask].sample(m, g_prng.get(), ctx);
+	tail.store(t + 1, std::memory_order_release);
+      }
+  }
+};
+
+#endif
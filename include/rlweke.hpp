@@ -5,6 +5,64 @@
 #define __RLWEKE_HPP__
 #include <nfl.hpp>
 #include <cstdint>
+#include <cstring>
+#include "macros.hpp"
+
+/** Resolves the PRNG context used by the protocol structures
+
+    @param ctx Context given at construction, or nullptr
+    @return ctx, or the default context of the calling thread when ctx is nullptr
+*/
+inline nfl::prng_ctx_t &prng_ctx(nfl::prng_ctx_t *ctx)
+{
+  return ctx != nullptr ? *ctx : nfl::default_prng_ctx();
+}
+
+/** Binary polynomial packed one bit per coefficient: coefficient i is
+    bit (i & 7) of byte i / 8.
+
+    @tparam degree Polynomial degree
+*/
+template<size_t degree>
+struct poly_bits_t
+{
+  /** Size of the packed polynomial in bytes */
+  static constexpr size_t bytes = CEILING(degree, 8);
+  /** Packed coefficients */
+  uint8_t bits[bytes];
+
+  /** Reads one coefficient
+
+      @param i Coefficient index
+      @return Coefficient bit */
+  unsigned char operator()(size_t i) const
+  {
+    return (bits[i >> 3] >> (i & 7)) & 1;
+  }
+
+  /** Compares two binary polynomials
+
+      @param o Other binary polynomial
+      @return True when both are equal */
+  bool operator==(const poly_bits_t &o) const
+  {
+    return memcmp(bits, o.bits, bytes) == 0;
+  }
+};
+
+/** Hint signal of the key exchange in [DXL12]
+
+    @tparam degree Polynomial degree
+*/
+template<size_t degree>
+using signal_bits_t = poly_bits_t<degree>;
+
+/** Key shared by the key exchange in [DXL12]
+
+    @tparam degree Polynomial degree
+*/
+template<size_t degree>
+using key_bits_t = poly_bits_t<degree>;
 
 /** Implements helping functions for the key exchange in [DXL12]
 
@@ -30,15 +88,20 @@ struct ke_t
   static constexpr signed_value_t qp1ov4 = (q + 1) / 4;
   static constexpr size_t degree = P::degree;
   /**@}*/
+  /** Packed hint signal type */
+  using signal_t = signal_bits_t<degree>;
+  /** Packed shared key type */
+  using key_t = key_bits_t<degree>;
 
   /** Extracts random byte with NFL
 
+      @param ctx PRNG context
       @return Random byte
    */
-  static unsigned char random_bit()
+  static unsigned char random_bit(nfl::prng_ctx_t &ctx = nfl::default_prng_ctx())
   {
     unsigned char r;
-    nfl::fastrandombytes(&r, 1);
+    nfl::fastrandombytes(ctx, &r, 1);
     return r;
   }
 
@@ -49,39 +112,14 @@ secure key exchange scheme based on the learning with errors
 problem. Cryptology ePrint Archive, Report 2012/688, 2012.
 https://eprint.iacr.org/2012/688.
 
-      @param sig Returned signal value
+      @param sig Returned packed signal
       @param k Input polynomial
       @param r Random bit
   */
-  static void signal(P &sig, const P &k, unsigned char r)
+  static void signal(signal_t &sig, const P &k, unsigned char r)
   {
-    sig = (value_t)0;
-
-    switch (r & 1)
-      {
-      case 0:
-	for (int i = 0; i < degree; i++)
-	  {
-	    signed_value_t ki = (k(0, i) <= qov2 ? k(0, i) :
-				 (signed_value_t)k(0, i) - q);
-
-	    if (ki < -qov4 || ki > qov4)
-	      sig(0, i) = 1;
-	  }
-	break;
-      case 1:
-	for (int i = 0; i < degree; i++)
-	  {
-	    signed_value_t ki = (k(0, i) <= qov2 ? k(0, i) :
-				 (signed_value_t)k(0, i) - q);
-
-	    if (ki < -qp1ov4 || ki > qp1ov4)
-	      sig(0, i) = 1;
-	  }
-	break;
-      default:
-	break;
-      }
+    nfl::ops::signal_loop<CC_SIMD, value_t>::run(sig.bits, k.begin(), degree, q,
+						 (r & 1) ? qp1ov4 : qov4);
   }
 
   /** Implements robust extractor as per [DXL12]
@@ -91,23 +129,13 @@ secure key exchange scheme based on the learning with errors
 problem. Cryptology ePrint Archive, Report 2012/688, 2012.
 https://eprint.iacr.org/2012/688.
 
-     @param sk Returned value
+     @param sk Returned packed key
      @param k Input polynomial
-     @param sig Hint signal polynomial
+     @param sig Packed hint signal
   */
-  static void mod2(P &sk, const P &k, const P &sig) {
-      sk = (value_t)0;
-
-      for (int i = 0; i < degree; i++) {
-          if (sig(0, i) == 1) {
-              sk(0, i) = qov2;
-          }
-      }
-      sk = sk + k;
-      for (int i = 0; i < degree; i++) {
-          signed_value_t ski = (sk(0, i) <= qov2 ? sk(0, i) : (signed_value_t)sk(0, i) - q);
-          sk(0, i) = ski & 1;
-      }
+  static void mod2(key_t &sk, const P &k, const signal_t &sig)
+  {
+    nfl::ops::mod2_loop<CC_SIMD, value_t>::run(sk.bits, k.begin(), sig.bits, degree, q);
   }
 };
 
@@ -126,20 +154,25 @@ struct alice_ke_t
   /**@{*/
   /** Polynomials used for RLWE sampling */
   P sA, eA1, eA2, kA;
-  P sk;
   /**@}*/
+  /** Shared key */
+  typename ke_t<P>::key_t sk;
 
   /** Coefficient type */
   using value_t = typename P::value_type;
   /** Gaussian Noise sampler */
   nfl::FastGaussianNoise<uint8_t, value_t, 2> *g_prng;
+  /** PRNG context (nullptr: default context of the calling thread) */
+  nfl::prng_ctx_t *ctx;
 
   /** Alice constructor
 
       @param _g_prng Gaussian Noise sampler
+      @param _ctx PRNG context, defaults to the context of the calling thread
   */
-  alice_ke_t(nfl::FastGaussianNoise<uint8_t, value_t, 2> *_g_prng)
-    : g_prng(_g_prng)
+  alice_ke_t(nfl::FastGaussianNoise<uint8_t, value_t, 2> *_g_prng,
+             nfl::prng_ctx_t *_ctx = nullptr)
+    : g_prng(_g_prng), ctx(_ctx)
   {
   }
 
@@ -150,9 +183,9 @@ struct alice_ke_t
   */
   void msg(P &pA, const P &m)
   {
-    sA = nfl::gaussian<uint8_t, value_t, 2>(g_prng);
-    eA1 = nfl::gaussian<uint8_t, value_t, 2>(g_prng, 2);
-    eA2 = nfl::gaussian<uint8_t, value_t, 2>(g_prng, 2);
+    sA = nfl::gaussian<uint8_t, value_t, 2>(g_prng, 1, &prng_ctx(ctx));
+    eA1 = nfl::gaussian<uint8_t, value_t, 2>(g_prng, 2, &prng_ctx(ctx));
+    eA2 = nfl::gaussian<uint8_t, value_t, 2>(g_prng, 2, &prng_ctx(ctx));
     sA.ntt_pow_phi();
     eA1.ntt_pow_phi();
 
@@ -165,7 +198,7 @@ struct alice_ke_t
       @param pB Bob's RLWE sample
       @param signal Hint signal
   */
-  void reconciliate(const P &pB, const P& signal)
+  void reconciliate(const P &pB, const typename ke_t<P>::signal_t &signal)
   {
     kA = sA * pB;
     kA.invntt_pow_invphi();
@@ -190,20 +223,25 @@ struct bob_ke_t
   /**@{*/
   /** Polynomials used for RLWE sampling */
   P sB, eB1, eB2, kB;
-  P sk;
   /**@}*/
+  /** Shared key */
+  typename ke_t<P>::key_t sk;
 
   /** Coefficient type */
   using value_t = typename P::value_type;
   /** Gaussian Noise sampler */
   nfl::FastGaussianNoise<uint8_t, value_t, 2> *g_prng;
+  /** PRNG context (nullptr: default context of the calling thread) */
+  nfl::prng_ctx_t *ctx;
 
   /** Bob constructor
 
       @param _g_prng Gaussian Noise sampler
+      @param _ctx PRNG context, defaults to the context of the calling thread
   */
-  bob_ke_t(nfl::FastGaussianNoise<uint8_t, value_t, 2> *_g_prng)
-    : g_prng(_g_prng)
+  bob_ke_t(nfl::FastGaussianNoise<uint8_t, value_t, 2> *_g_prng,
+           nfl::prng_ctx_t *_ctx = nullptr)
+    : g_prng(_g_prng), ctx(_ctx)
   {
   }
 
@@ -215,11 +253,11 @@ struct bob_ke_t
       @param pA Alice RLWE sample
       @param m Common polynomial
   */
-  void msg(P &pB, P &signal, const P &pA, const P &m)
+  void msg(P &pB, typename ke_t<P>::signal_t &signal, const P &pA, const P &m)
   {
-    sB = nfl::gaussian<uint8_t, value_t, 2>(g_prng);
-    eB1 = nfl::gaussian<uint8_t, value_t, 2>(g_prng, 2);
-    eB2 = nfl::gaussian<uint8_t, value_t, 2>(g_prng, 2);
+    sB = nfl::gaussian<uint8_t, value_t, 2>(g_prng, 1, &prng_ctx(ctx));
+    eB1 = nfl::gaussian<uint8_t, value_t, 2>(g_prng, 2, &prng_ctx(ctx));
+    eB2 = nfl::gaussian<uint8_t, value_t, 2>(g_prng, 2, &prng_ctx(ctx));
     sB.ntt_pow_phi();
     eB1.ntt_pow_phi();
 
@@ -229,7 +267,7 @@ struct bob_ke_t
     kB.invntt_pow_invphi();
     kB = kB + eB2;
 
-    ke_t<P>::signal(signal, kB, ke_t<P>::random_bit());
+    ke_t<P>::signal(signal, kB, ke_t<P>::random_bit(prng_ctx(ctx)));
     ke_t<P>::mod2(sk, kB, signal);
   }
 };
@@ -11,42 +11,28 @@
 #include <cstring>
 #include "symenc.hpp"
 #include "macros.hpp"
+#include "rlwe_pool.hpp"
 
-/** Converts binary polynomial into array. If size of the array is shorter
-    that polynomial degree, coefficients are hashed
+/** Converts packed binary polynomial into array. If size of the array is
+    shorter that polynomial degree, coefficients are hashed
 
     @tparam P NFL Polynomial type
     @tparam bbytes Size of the array
     @param arr Returned array
-    @param P Input polynomial
+    @param key Input packed binary polynomial
 */
 template<typename P, size_t bbytes>
-void convPtoArray(uint8_t arr[bbytes], const P &pol)
+void convPtoArray(uint8_t arr[bbytes], const key_bits_t<P::degree> &key)
 {
   if (bbytes*8 > P::degree)
     {
-      uint8_t coeffs[CEILING(P::degree, 8)];
-      memset(coeffs, 0, sizeof(coeffs));
-
-      for (size_t i = 0; i < P::degree; i++)
-	{
-	  size_t iLower = i & 7;
-	  coeffs[i / 8] |= pol(0, i) << iLower;
-	}
-
       rom2_t<bbytes> rom2;
       rom_k_O<bbytes> rom2_output(arr);
-      rom2(rom2_output, coeffs, sizeof(coeffs));
+      rom2(rom2_output, key.bits, sizeof(key.bits));
     }
   else
     {
-      memset(arr, 0, bbytes);
-
-      for (size_t i = 0; i < bbytes * 8; i++)
-	{
-	  size_t iLower = i & 7;
-	  arr[i / 8] |= pol(0, i) << iLower;
-	}
+      memcpy(arr, key.bits, bbytes);
     }
 }
 
@@ -60,18 +46,20 @@ Springer International Publishing
 @tparam P NFL Polynomial type
 @tparam rbytes Size of symmetric cipher key
 @tparam bbytes Size of output of random oracle
+@tparam cipher_policy_t Cipher policy of sym_enc_t
 */
-template<typename P, size_t rbytes, size_t bbytes>
+template<typename P, size_t rbytes, size_t bbytes,
+	 template<size_t, size_t, size_t> class cipher_policy_t = sym_enc_default_t>
 struct alice_ot_t
 {
   /** Symmetric-key encryption engine */
-  sym_enc_t<rbytes, rbytes, bbytes> sym_enc;
+  sym_enc_t<rbytes, rbytes, bbytes, cipher_policy_t> sym_enc;
   /** Type of symmetric key cipher */
-  typedef typename sym_enc_t<rbytes, rbytes, bbytes>::cipher_t cipher_t;
+  typedef typename sym_enc_t<rbytes, rbytes, bbytes, cipher_policy_t>::cipher_t cipher_t;
 
   /**@{*/
   /** Used for RLWE sampling */
-  P sR, eR, eR1;
+  P sR, eR1;
   /**@}*/
   /** Polynomial output of random oracle such that p0 + p1 = h */
   P h;
@@ -79,7 +67,8 @@ struct alice_ot_t
   int b;
   /**@{*/
   /** Used for reconciliation with Sender's RLWE sample */
-  P kR, skR;
+  P kR;
+  typename ke_t<P>::key_t skR;
   /**@}*/
   /**@{*/
   /** Used to compute challenge response */
@@ -103,8 +92,14 @@ struct alice_ot_t
 
   /** Type of polynomial coefficients */
   using value_t = typename P::value_type;
+  /** Packed hint signal type */
+  using signal_t = typename ke_t<P>::signal_t;
+  /** Packed shared key type */
+  using key_t = typename ke_t<P>::key_t;
   /** Gaussian Noise Sampler */
   nfl::FastGaussianNoise<uint8_t, value_t, 2> *g_prng;
+  /** PRNG context (nullptr: default context of the calling thread) */
+  nfl::prng_ctx_t *ctx;
 
   /**@{*/
   /** Auxiliary structures for the implementation of Random Oracles */
@@ -120,9 +115,11 @@ struct alice_ot_t
 
   /** Constructor of Alice
 
-      @param _g_prng Gaussian Noise sampler */
-  alice_ot_t(nfl::FastGaussianNoise<uint8_t, value_t, 2> *_g_prng)
-    : g_prng(_g_prng),
+      @param _g_prng Gaussian Noise sampler
+      @param _ctx PRNG context, defaults to the context of the calling thread */
+  alice_ot_t(nfl::FastGaussianNoise<uint8_t, value_t, 2> *_g_prng,
+             nfl::prng_ctx_t *_ctx = nullptr)
+    : g_prng(_g_prng), ctx(_ctx),
       rom1_output(h),
       rom2_output(bskR),
       rom3_output0(bxb),
@@ -138,17 +135,44 @@ struct alice_ot_t
       @param sid Session ID
       @param m Common polynomial */
   void msg1(P &p0, uint8_t *r_sid, int b1, uint32_t sid, const P &m)
+  {
+    rlwe_sample_t<P> sample;
+    sample.sample(m, g_prng, prng_ctx(ctx));
+    msg1_online(p0, r_sid, b1, sid, sample);
+  }
+
+  /** Implements first Alice message in [BDGM19] with a sample from a
+      precomputation pool
+
+      @param p0 Return Alice RLWE sample for "channel 0"
+      @param r_sid Concatenation of Session ID and random value of size 'rbytes'
+      @param b1 Chosen OT channel
+      @param sid Session ID
+      @param pool Pool of samples for the common polynomial */
+  void msg1_online(P &p0, uint8_t *r_sid, int b1, uint32_t sid, rlwe_pool_t<P> &pool)
+  {
+    rlwe_sample_t<P> sample;
+    pool.pop(sample, g_prng, prng_ctx(ctx));
+    msg1_online(p0, r_sid, b1, sid, sample);
+  }
+
+  /** Implements first Alice message in [BDGM19] with a precomputed sample
+
+      @param p0 Return Alice RLWE sample for "channel 0"
+      @param r_sid Concatenation of Session ID and random value of size 'rbytes'
+      @param b1 Chosen OT channel
+      @param sid Session ID
+      @param sample RLWE sample for the common polynomial */
+  void msg1_online(P &p0, uint8_t *r_sid, int b1, uint32_t sid,
+		   const rlwe_sample_t<P> &sample)
   {
     b = b1;
-    sR = nfl::gaussian<uint8_t, value_t, 2>(g_prng);
-    eR = nfl::gaussian<uint8_t, value_t, 2>(g_prng, 2);
-    eR1 = nfl::gaussian<uint8_t, value_t, 2>(g_prng, 2);
-    sR.ntt_pow_phi();
-    eR.ntt_pow_phi();
-    p0 = m * sR + eR;
+    sR = sample.s;
+    eR1 = sample.e1;
+    p0 = sample.p;
 
     memcpy(&r_sid[0], &sid, sizeof(sid));
-    nfl::fastrandombytes(&r_sid[sizeof(sid)], rbytes);
+    nfl::fastrandombytes(prng_ctx(ctx), &r_sid[sizeof(sid)], rbytes);
 
     if (b == 1) {
         rom1(rom1_output, r_sid, rbytes + sizeof(uint32_t));
@@ -169,7 +193,7 @@ struct alice_ot_t
       @param u1 Part of the challenge
       @return Returns true when all checks are successful */
   bool msg2(uint8_t ch[rbytes],
-	    uint32_t sid, const P &pS, const P &signal0, const P &signal1,
+	    uint32_t sid, const P &pS, const signal_t &signal0, const signal_t &signal1,
 	    const cipher_t &a0, const cipher_t &a1,
 	    const uint8_t u0[2*rbytes + bbytes], const uint8_t u1[2*rbytes + bbytes])
   {
@@ -186,17 +210,11 @@ struct alice_ot_t
 	ke_t<P>::mod2(skR, kR, signal1);
       }
 
-    uint8_t rom2_inputj[sizeof(sid) + CEILING(P::degree, 8)];
+    uint8_t rom2_inputj[sizeof(sid) + sizeof(skR.bits)];
     memcpy(&rom2_inputj[0], &sid, sizeof(sid));
-    memset(&rom2_inputj[sizeof(sid)], 0, CEILING(P::degree, 8));
-    for (size_t i = 0; i < P::degree; i++)
-      {
-	rom2_inputj[sizeof(sid) + (i>>3)] =
-	  rom2_inputj[sizeof(sid) + (i>>3)] |
-	  (skR(0, i) << (i & 7));
-      }
+    memcpy(&rom2_inputj[sizeof(sid)], skR.bits, sizeof(skR.bits));
 
-    rom2(rom2_output, rom2_inputj, sizeof(sid) + CEILING(P::degree, 8));
+    rom2(rom2_output, rom2_inputj, sizeof(rom2_inputj));
 
     if (b == 0)
       {
@@ -243,19 +261,6 @@ struct alice_ot_t
 	  }
       }
 
-    if (b == 0)
-      {
-	sym_enc.SEnc(abb, xbb, ybb, bskRbb);
-	if (memcmp(abb.buf, a1.buf, sizeof(abb.buf)) != 0)
-	  return false;
-      }
-    else
-      {
-	sym_enc.SEnc(abb, xbb, ybb, bskRbb);
-	if (memcmp(abb.buf, a0.buf, sizeof(abb.buf)) != 0)
-	  return false;
-      }
-
     memcpy(&rom3_inputj[0], &sid, sizeof(sid));
     memcpy(&rom3_inputj[sizeof(sid)], xbb, rbytes);
     rom3(rom3_output1, rom3_inputj, sizeof(sid) + rbytes);
@@ -294,18 +299,16 @@ struct alice_ot_t
     if (memcmp(xb1, xb, rbytes) != 0) return false;
     if (memcmp(bskRb, bskR, bbytes) != 0) return false;
 
-    if (b == 0)
-      {
-	sym_enc.SEnc(ab, xb, yb, bskRb);
-	if (memcmp(ab.buf, a0.buf, sizeof(ab.buf)) != 0)
-	  return false;
-      }
-    else
-      {
-	sym_enc.SEnc(ab, xb, yb, bskRb);
-	if (memcmp(ab.buf, a1.buf, sizeof(ab.buf)) != 0)
-	  return false;
-      }
+    // Both re-encryptions are independent, so they share the AES lanes
+    cipher_t *abs[2] = {&ab, &abb};
+    const uint8_t *xs[2] = {xb, xbb}, *ys[2] = {yb, ybb}, *keys[2] = {bskRb, bskRbb};
+    sym_enc.SEnc_many(abs, xs, ys, keys, 2);
+
+    const cipher_t &a_b = (b == 0) ? a0 : a1;
+    const cipher_t &a_bb = (b == 0) ? a1 : a0;
+    if (memcmp(abb.buf, a_bb.buf, sizeof(abb.buf)) != 0 ||
+	memcmp(ab.buf, a_b.buf, sizeof(ab.buf)) != 0)
+      return false;
 
     rom_k_O<rbytes> rom4_output(ch);
 
@@ -361,13 +364,15 @@ Springer International Publishing
 @tparam P NFL Polynomial type
 @tparam rbytes Size of symmetric cipher key
 @tparam bbytes Size of output of random oracle
+@tparam cipher_policy_t Cipher policy of sym_enc_t
 */
-template<typename P, size_t rbytes, size_t bbytes>
+template<typename P, size_t rbytes, size_t bbytes,
+	 template<size_t, size_t, size_t> class cipher_policy_t = sym_enc_default_t>
 struct bob_ot_t
 {
   /**@{*/
   /** Used for RLWE sampling */
-  P sS, eS, eS1;
+  P sS, eS1;
   /**@}*/
   /** Polynomial output of random oracle such that p0 + p1 = h */
   P h;
@@ -380,12 +385,12 @@ struct bob_ot_t
   /**@}*/
   /**@{*/
   /** Hint signals */
-  P signal0, signal1;
+  typename ke_t<P>::signal_t signal0, signal1;
   /**@}*/
 
   /**@{*/
   /** Used to produce challenge */
-  P skS0, skS1;
+  typename ke_t<P>::key_t skS0, skS1;
   uint8_t w0[rbytes], w1[rbytes];
   uint8_t z0[rbytes], z1[rbytes];
   uint8_t bskS0[bbytes], bskS1[bbytes];
@@ -396,8 +401,14 @@ struct bob_ot_t
 
   /** Polynomial coefficient type */
   using value_t = typename P::value_type;
+  /** Packed hint signal type */
+  using signal_t = typename ke_t<P>::signal_t;
+  /** Packed shared key type */
+  using key_t = typename ke_t<P>::key_t;
   /** Gaussian Noise Sampler */
   nfl::FastGaussianNoise<uint8_t, value_t, 2> *g_prng;
+  /** PRNG context (nullptr: default context of the calling thread) */
+  nfl::prng_ctx_t *ctx;
 
   /**@{*/
   /** Auxiliary structures for the implementation of Random Oracles */
@@ -414,15 +425,17 @@ struct bob_ot_t
   /**@}*/
 
   /** Symmetric-key encryption engine */
-  sym_enc_t<rbytes, rbytes, bbytes> sym_enc;
+  sym_enc_t<rbytes, rbytes, bbytes, cipher_policy_t> sym_enc;
   /** Type of symmetric key cipher */
-  typedef typename sym_enc_t<rbytes, rbytes, bbytes>::cipher_t cipher_t;
+  typedef typename sym_enc_t<rbytes, rbytes, bbytes, cipher_policy_t>::cipher_t cipher_t;
 
   /** Constructor of Bob
 
-      @param _g_prng Gaussian Noise sampler */
-  bob_ot_t(nfl::FastGaussianNoise<uint8_t, value_t, 2> *_g_prng)
-    : g_prng(_g_prng),
+      @param _g_prng Gaussian Noise sampler
+      @param _ctx PRNG context, defaults to the context of the calling thread */
+  bob_ot_t(nfl::FastGaussianNoise<uint8_t, value_t, 2> *_g_prng,
+           nfl::prng_ctx_t *_ctx = nullptr)
+    : g_prng(_g_prng), ctx(_ctx),
       rom1_output(h),
       rom2_output0(bskS0),
       rom2_output1(bskS1),
@@ -445,18 +458,64 @@ struct bob_ot_t
       @param p0 Alice RLWE sample for "channel 0"
       @param r_sid Concatenation of Session ID and random value of size 'rbytes'
       @param m Common polynomial */
-  void msg1(P &pS, P &signal0, P &signal1,
+  void msg1(P &pS, signal_t &signal0, signal_t &signal1,
 	    uint8_t u0[2*rbytes + bbytes], uint8_t u1[2*rbytes + bbytes],
 	    cipher_t &a0, cipher_t &a1,
 	    uint32_t sid,
 	    const P &p0, const uint8_t *r_sid, const P &m)
   {
-    sS = nfl::gaussian<uint8_t, value_t, 2>(g_prng);
-    eS = nfl::gaussian<uint8_t, value_t, 2>(g_prng, 2);
-    eS1 = nfl::gaussian<uint8_t, value_t, 2>(g_prng, 2);
-    sS.ntt_pow_phi();
-    eS.ntt_pow_phi();
-    pS = m * sS + eS;
+    rlwe_sample_t<P> sample;
+    sample.sample(m, g_prng, prng_ctx(ctx));
+    msg1_online(pS, signal0, signal1, u0, u1, a0, a1, sid, p0, r_sid, sample);
+  }
+
+  /** Implements first Bob message in [BDGM19] with a sample from a
+      precomputation pool
+
+      @param pS Bob's RLWE sample
+      @param signal0 Outputted hint signal for "channel 0"
+      @param signal1 Outputted hint signal for "channel 1"
+      @param u0 Part of challenge
+      @param u1 Part of challenge
+      @param a0 Part of challenge
+      @param a1 Part of challenge
+      @param sid Session ID
+      @param p0 Alice RLWE sample for "channel 0"
+      @param r_sid Concatenation of Session ID and random value of size 'rbytes'
+      @param pool Pool of samples for the common polynomial */
+  void msg1_online(P &pS, signal_t &signal0, signal_t &signal1,
+		   uint8_t u0[2*rbytes + bbytes], uint8_t u1[2*rbytes + bbytes],
+		   cipher_t &a0, cipher_t &a1,
+		   uint32_t sid,
+		   const P &p0, const uint8_t *r_sid, rlwe_pool_t<P> &pool)
+  {
+    rlwe_sample_t<P> sample;
+    pool.pop(sample, g_prng, prng_ctx(ctx));
+    msg1_online(pS, signal0, signal1, u0, u1, a0, a1, sid, p0, r_sid, sample);
+  }
+
+  /** Implements first Bob message in [BDGM19] with a precomputed sample
+
+      @param pS Bob's RLWE sample
+      @param signal0 Outputted hint signal for "channel 0"
+      @param signal1 Outputted hint signal for "channel 1"
+      @param u0 Part of challenge
+      @param u1 Part of challenge
+      @param a0 Part of challenge
+      @param a1 Part of challenge
+      @param sid Session ID
+      @param p0 Alice RLWE sample for "channel 0"
+      @param r_sid Concatenation of Session ID and random value of size 'rbytes'
+      @param sample RLWE sample for the common polynomial */
+  void msg1_online(P &pS, signal_t &signal0, signal_t &signal1,
+		   uint8_t u0[2*rbytes + bbytes], uint8_t u1[2*rbytes + bbytes],
+		   cipher_t &a0, cipher_t &a1,
+		   uint32_t sid,
+		   const P &p0, const uint8_t *r_sid, const rlwe_sample_t<P> &sample)
+  {
+    sS = sample.s;
+    eS1 = sample.e1;
+    pS = sample.p;
 
     rom1(rom1_output, r_sid, rbytes + sizeof(uint32_t));
     p1 = p0 + h;
@@ -469,36 +528,33 @@ struct bob_ot_t
     kS1.invntt_pow_invphi();
     kS1 = kS1 + eS1;
 
-    ke_t<P>::signal(signal0, kS0, ke_t<P>::random_bit());
-    ke_t<P>::signal(signal1, kS1, ke_t<P>::random_bit());
+    ke_t<P>::signal(signal0, kS0, ke_t<P>::random_bit(prng_ctx(ctx)));
+    ke_t<P>::signal(signal1, kS1, ke_t<P>::random_bit(prng_ctx(ctx)));
 
     ke_t<P>::mod2(skS0, kS0, signal0);
     ke_t<P>::mod2(skS1, kS1, signal1);
 
-    nfl::fastrandombytes(&w0[0], rbytes);
-    nfl::fastrandombytes(&w1[0], rbytes);
-    nfl::fastrandombytes(&z0[0], rbytes);
-    nfl::fastrandombytes(&z1[0], rbytes);
+    nfl::fastrandombytes(prng_ctx(ctx), &w0[0], rbytes);
+    nfl::fastrandombytes(prng_ctx(ctx), &w1[0], rbytes);
+    nfl::fastrandombytes(prng_ctx(ctx), &z0[0], rbytes);
+    nfl::fastrandombytes(prng_ctx(ctx), &z1[0], rbytes);
 
     auto hash_concat = [&] (rom_k_O<bbytes> &out,
-			    P &skSj) -> void
+			    const key_t &skSj) -> void
       {
-	uint8_t rom2_inputj[sizeof(sid) + CEILING(P::degree, 8)];
+	uint8_t rom2_inputj[sizeof(sid) + sizeof(skSj.bits)];
 	memcpy(&rom2_inputj[0], &sid, sizeof(sid));
-	memset(&rom2_inputj[sizeof(sid)], 0, CEILING(P::degree, 8));
-	for (size_t i = 0; i < P::degree; i++)
-	  {
-	    rom2_inputj[sizeof(sid) + (i>>3)] = rom2_inputj[sizeof(sid) + (i>>3)] | (skSj(0, i) << (i & 7));
-	  }
+	memcpy(&rom2_inputj[sizeof(sid)], skSj.bits, sizeof(skSj.bits));
 
-	rom2(out, rom2_inputj, sizeof(sid) + CEILING(P::degree, 8));
+	rom2(out, rom2_inputj, sizeof(rom2_inputj));
       };
 
     hash_concat(rom2_output0, skS0);
     hash_concat(rom2_output1, skS1);
 
-    sym_enc.SEnc(a0, w0, z0, bskS0);
-    sym_enc.SEnc(a1, w1, z1, bskS1);
+    cipher_t *as[2] = {&a0, &a1};
+    const uint8_t *ws[2] = {w0, w1}, *zs[2] = {z0, z1}, *keys[2] = {bskS0, bskS1};
+    sym_enc.SEnc_many(as, ws, zs, keys, 2);
 
     auto hash_concat_2 = [&] (rom_k_O<2*rbytes + bbytes> &out,
 			      uint8_t wi[rbytes])
@@ -558,11 +614,12 @@ struct bob_ot_t
     convPtoArray<P, bbytes>(k1, skS1);
 
     uint8_t z0[rbytes], z1[rbytes];
-    nfl::fastrandombytes(&z0[0], rbytes);
-    nfl::fastrandombytes(&z1[0], rbytes);
+    nfl::fastrandombytes(prng_ctx(ctx), &z0[0], rbytes);
+    nfl::fastrandombytes(prng_ctx(ctx), &z1[0], rbytes);
 
-    sym_enc.SEnc(c0, msg0, z0, k0);
-    sym_enc.SEnc(c1, msg1, z1, k1);
+    cipher_t *cs[2] = {&c0, &c1};
+    const uint8_t *msgs[2] = {msg0, msg1}, *zs[2] = {z0, z1}, *keys[2] = {k0, k1};
+    sym_enc.SEnc_many(cs, msgs, zs, keys, 2);
 
     return true;
   }
@@ -12,27 +12,42 @@
 #include "symenc.hpp"
 #include "macros.hpp"
 #include "rlweot.hpp"
+#include "rlwe_pool.hpp"
 
 /** Outputs a random bit using NFL random byte generator
 
+    @param ctx PRNG context
     @return Random bit */
-int random_bit()
+int random_bit(nfl::prng_ctx_t &ctx = nfl::default_prng_ctx())
 {
   uint8_t b;
-  nfl::fastrandombytes(&b, 1);
+  nfl::fastrandombytes(ctx, &b, 1);
   return b & 1;
 }
 
-/** Produces a hash of the inputted polynomial
+/** Produces a hash of the inputted packed binary polynomial
 
-    @param pol Inputted polynomial
+    @param pol Inputted packed binary polynomial
     @param out Hash of the polynomial
-    @tparam P NFL Polynomial type
+    @tparam degree Polynomial degree
 */
-template<typename P>
-void hash_polynomial(P &pol, uint8_t* out)
+template<size_t degree>
+void hash_polynomial(const poly_bits_t<degree> &pol, uint8_t* out)
 {
-  blake3(out, (const uint8_t*)pol.get_coeffs(), pol.get_coeffs_size_bytes());
+  blake3(out, pol.bits, sizeof(pol.bits));
+}
+
+/** Queues a hash of the inputted packed binary polynomial
+
+    @param pol Inputted packed binary polynomial, kept until hashes is flushed
+    @param out Hash of the polynomial, written when hashes is flushed
+    @param hashes Queue of hashes
+    @tparam degree Polynomial degree
+*/
+template<size_t degree>
+void hash_polynomial(const poly_bits_t<degree> &pol, uint8_t* out, blake3_many_t &hashes)
+{
+  hashes.add(out, pol.bits, sizeof(pol.bits));
 }
 
 /** Implements Alice of the Proposed ROT
@@ -47,7 +62,7 @@ struct alice_rot_t
 {
   /**@{*/
   /** Used for RLWE sampling */
-  P sR, eR, eR1;
+  P sR, eR1;
   /**@}*/
   /** Polynomial output of random oracle such that p0 + p1 = h */
   P h;
@@ -55,13 +70,20 @@ struct alice_rot_t
   int b1;
   /**@{*/
   /** Used for reconciliation with Sender's RLWE sample */
-  P kR, skR;
+  P kR;
+  typename ke_t<P>::key_t skR;
   /**@}*/
 
   /** Type of polynomial coefficients */
   using value_t = typename P::value_type;
+  /** Packed hint signal type */
+  using signal_t = typename ke_t<P>::signal_t;
+  /** Packed shared key type */
+  using key_t = typename ke_t<P>::key_t;
   /** Gaussian Noise Sampler */
   nfl::FastGaussianNoise<uint8_t, value_t, 2>* g_prng;
+  /** PRNG context (nullptr: default context of the calling thread) */
+  nfl::prng_ctx_t *ctx;
   static_assert(HASHSIZE == 32); //since we are using Blake3
 
   /**@{*/
@@ -82,9 +104,11 @@ struct alice_rot_t
 
   /** Constructor of Alice
 
-      @param _g_prng Gaussian Noise sampler */
-  alice_rot_t(nfl::FastGaussianNoise<uint8_t, value_t, 2> *_g_prng)
-    : g_prng(_g_prng),
+      @param _g_prng Gaussian Noise sampler
+      @param _ctx PRNG context, defaults to the context of the calling thread */
+  alice_rot_t(nfl::FastGaussianNoise<uint8_t, value_t, 2> *_g_prng,
+              nfl::prng_ctx_t *_ctx = nullptr)
+    : g_prng(_g_prng), ctx(_ctx),
       rom1_output(h)
   {
   }
@@ -101,23 +125,57 @@ struct alice_rot_t
 	    uint8_t hS0[HASHSIZE], uint8_t hS1[HASHSIZE],
 	    uint32_t sid, const P &m)
   {
-    b1 = random_bit();
+    rlwe_sample_t<P> sample;
+    sample.sample(m, g_prng, prng_ctx(ctx));
+    msg1_online(p0, r_sid, hS0, hS1, sid, sample);
+  }
 
-    sR = nfl::gaussian<uint8_t, value_t, 2>(g_prng);
-    eR = nfl::gaussian<uint8_t, value_t, 2>(g_prng, 2);
-    eR1 = nfl::gaussian<uint8_t, value_t, 2>(g_prng, 2);
-    sR.ntt_pow_phi();
-    eR.ntt_pow_phi();
-    p0 = m * sR + eR;
+  /** Implements first Alice message in proposed ROT with a sample from a
+      precomputation pool
+
+      @param p0 Return Alice RLWE sample for "channel 0"
+      @param r_sid Concatenation of Session ID and random value of size 'rbytes'
+      @param hS0 Commitment to mask of channel 0
+      @param hS1 Commitment to mask of channel 1
+      @param sid Session ID
+      @param pool Pool of samples for the common polynomial */
+  void msg1_online(P &p0, uint8_t *r_sid,
+		   uint8_t hS0[HASHSIZE], uint8_t hS1[HASHSIZE],
+		   uint32_t sid, rlwe_pool_t<P> &pool)
+  {
+    rlwe_sample_t<P> sample;
+    pool.pop(sample, g_prng, prng_ctx(ctx));
+    msg1_online(p0, r_sid, hS0, hS1, sid, sample);
+  }
+
+  /** Implements first Alice message in proposed ROT with a precomputed sample
+
+      @param p0 Return Alice RLWE sample for "channel 0"
+      @param r_sid Concatenation of Session ID and random value of size 'rbytes'
+      @param hS0 Commitment to mask of channel 0
+      @param hS1 Commitment to mask of channel 1
+      @param sid Session ID
+      @param sample RLWE sample for the common polynomial */
+  void msg1_online(P &p0, uint8_t *r_sid,
+		   uint8_t hS0[HASHSIZE], uint8_t hS1[HASHSIZE],
+		   uint32_t sid, const rlwe_sample_t<P> &sample)
+  {
+    b1 = random_bit(prng_ctx(ctx));
+
+    sR = sample.s;
+    eR1 = sample.e1;
+    p0 = sample.p;
 
     memcpy(&r_sid[0], &sid, sizeof(sid));
-    nfl::fastrandombytes(&r_sid[sizeof(sid)], rbytes);
+    nfl::fastrandombytes(prng_ctx(ctx), &r_sid[sizeof(sid)], rbytes);
 
-    nfl::fastrandombytes(&S0[0], sizeof(S0));
-    nfl::fastrandombytes(&S1[0], sizeof(S1));
+    nfl::fastrandombytes(prng_ctx(ctx), &S0[0], sizeof(S0));
+    nfl::fastrandombytes(prng_ctx(ctx), &S1[0], sizeof(S1));
 
-    blake3(&hS0[0], &S0[0], sizeof(S0));
-    blake3(&hS1[0], &S1[0], sizeof(S1));
+    blake3_many_t hashes;
+    hashes.add(&hS0[0], &S0[0], sizeof(S0));
+    hashes.add(&hS1[0], &S1[0], sizeof(S1));
+    hashes.flush();
 
     if (b1 == 1)
       {
@@ -143,7 +201,7 @@ struct alice_rot_t
   bool msg2(uint8_t Mb[HASHSIZE],
 	    int &b,
 	    uint8_t bS0[bbytes], uint8_t bS1[bbytes],
-	    uint32_t sid, const P &pS, const P &signal0, const P &signal1,
+	    uint32_t sid, const P &pS, const signal_t &signal0, const signal_t &signal1,
             const uint8_t ha0[HASHSIZE], const uint8_t ha1[HASHSIZE],
             const uint8_t u[bbytes])
   {
@@ -214,7 +272,7 @@ struct bob_rot_t
 
   /**@{*/
   /** Used for RLWE sampling */
-  P sS, eS, eS1;
+  P sS, eS1;
   /**@}*/
   /** Polynomial output of random oracle such that p0 + p1 = h */
   P h;
@@ -226,12 +284,12 @@ struct bob_rot_t
   /**@}*/
   /**@{*/
   /** Hint signals */
-  P signal0, signal1;
+  typename ke_t<P>::signal_t signal0, signal1;
   /**@}*/
 
   /**@{*/
   /** Keys shared under base KE */
-  P skS0, skS1;
+  typename ke_t<P>::key_t skS0, skS1;
   /**@}*/
   /** Random flipping of channels */
   int a1;
@@ -249,8 +307,14 @@ struct bob_rot_t
 
   /** Coefficient type */
   using value_t = typename P::value_type;
+  /** Packed hint signal type */
+  using signal_t = typename ke_t<P>::signal_t;
+  /** Packed shared key type */
+  using key_t = typename ke_t<P>::key_t;
   /** Gaussian noise sampler */
   nfl::FastGaussianNoise<uint8_t, value_t, 2>* g_prng;
+  /** PRNG context (nullptr: default context of the calling thread) */
+  nfl::prng_ctx_t *ctx;
 
   /**@{*/
   /** Auxiliary structures for the implementation of Random Oracles */
@@ -265,9 +329,11 @@ struct bob_rot_t
 
   /** Constructor of Bob
 
-      @param _g_prng Gaussian Noise sampler */
-  bob_rot_t(nfl::FastGaussianNoise<uint8_t, value_t, 2> *_g_prng)
-    : g_prng(_g_prng),
+      @param _g_prng Gaussian Noise sampler
+      @param _ctx PRNG context, defaults to the context of the calling thread */
+  bob_rot_t(nfl::FastGaussianNoise<uint8_t, value_t, 2> *_g_prng,
+            nfl::prng_ctx_t *_ctx = nullptr)
+    : g_prng(_g_prng), ctx(_ctx),
       rom1_output(h),
       romhS0b_output(hS0b),
       romhS1b_output(hS1b)
@@ -288,23 +354,75 @@ struct bob_rot_t
       @param p0 Alice RLWE sample for "channel 0"
       @param r_sid Concatenation of Session ID and random value of size 'rbytes'
       @param m Common polynomial */
-  void msg1(P &pS, P &signal0, P &signal1,
+  void msg1(P &pS, signal_t &signal0, signal_t &signal1,
 	    uint8_t au[bbytes],
             uint8_t hma0[HASHSIZE], uint8_t hma1[HASHSIZE],
             uint32_t sid,
 	    const uint8_t hS0a[HASHSIZE],
 	    const uint8_t hS1a[HASHSIZE],
             const P &p0, const uint8_t *r_sid, const P &m)
+  {
+    rlwe_sample_t<P> sample;
+    sample.sample(m, g_prng, prng_ctx(ctx));
+    msg1_online(pS, signal0, signal1, au, hma0, hma1, sid, hS0a, hS1a, p0, r_sid, sample);
+  }
+
+  /** Implements first Bob message in proposed OT with a sample from a
+      precomputation pool
+
+      @param pS Bob's RLWE sample
+      @param signal0 Outputted hint signal for "channel 0"
+      @param signal1 Outputted hint signal for "channel 1"
+      @param au Random mask
+      @param hma0 Commitment to shared secret under one of the KE channels
+      @param hma1 Commitment to shared secret under one of the KE channels
+      @param sid Session ID
+      @param hS0a Commitment to Alice's random mask 0
+      @param hS1a Commitment to Alice's random mask 1
+      @param p0 Alice RLWE sample for "channel 0"
+      @param r_sid Concatenation of Session ID and random value of size 'rbytes'
+      @param pool Pool of samples for the common polynomial */
+  void msg1_online(P &pS, signal_t &signal0, signal_t &signal1,
+		   uint8_t au[bbytes],
+		   uint8_t hma0[HASHSIZE], uint8_t hma1[HASHSIZE],
+		   uint32_t sid,
+		   const uint8_t hS0a[HASHSIZE],
+		   const uint8_t hS1a[HASHSIZE],
+		   const P &p0, const uint8_t *r_sid, rlwe_pool_t<P> &pool)
+  {
+    rlwe_sample_t<P> sample;
+    pool.pop(sample, g_prng, prng_ctx(ctx));
+    msg1_online(pS, signal0, signal1, au, hma0, hma1, sid, hS0a, hS1a, p0, r_sid, sample);
+  }
+
+  /** Implements first Bob message in proposed OT with a precomputed sample
+
+      @param pS Bob's RLWE sample
+      @param signal0 Outputted hint signal for "channel 0"
+      @param signal1 Outputted hint signal for "channel 1"
+      @param au Random mask
+      @param hma0 Commitment to shared secret under one of the KE channels
+      @param hma1 Commitment to shared secret under one of the KE channels
+      @param sid Session ID
+      @param hS0a Commitment to Alice's random mask 0
+      @param hS1a Commitment to Alice's random mask 1
+      @param p0 Alice RLWE sample for "channel 0"
+      @param r_sid Concatenation of Session ID and random value of size 'rbytes'
+      @param sample RLWE sample for the common polynomial */
+  void msg1_online(P &pS, signal_t &signal0, signal_t &signal1,
+		   uint8_t au[bbytes],
+		   uint8_t hma0[HASHSIZE], uint8_t hma1[HASHSIZE],
+		   uint32_t /* sid */,
+		   const uint8_t hS0a[HASHSIZE],
+		   const uint8_t hS1a[HASHSIZE],
+		   const P &p0, const uint8_t *r_sid, const rlwe_sample_t<P> &sample)
   {
     memcpy(&hS0[0], &hS0a[0], sizeof(hS0));
     memcpy(&hS1[0], &hS1a[0], sizeof(hS1));
 
-    sS = nfl::gaussian<uint8_t, value_t, 2>(g_prng);
-    eS = nfl::gaussian<uint8_t, value_t, 2>(g_prng, 2);
-    eS1 = nfl::gaussian<uint8_t, value_t, 2>(g_prng, 2);
-    sS.ntt_pow_phi();
-    eS.ntt_pow_phi();
-    pS = m * sS + eS;
+    sS = sample.s;
+    eS1 = sample.e1;
+    pS = sample.p;
 
     rom1(rom1_output, r_sid, rbytes + sizeof(uint32_t));
     p1 = p0 + h;
@@ -317,33 +435,27 @@ struct bob_rot_t
     kS1.invntt_pow_invphi();
     kS1 = kS1 + eS1;
 
-    ke_t<P>::signal(signal0, kS0, ke_t<P>::random_bit());
-    ke_t<P>::signal(signal1, kS1, ke_t<P>::random_bit());
+    ke_t<P>::signal(signal0, kS0, ke_t<P>::random_bit(prng_ctx(ctx)));
+    ke_t<P>::signal(signal1, kS1, ke_t<P>::random_bit(prng_ctx(ctx)));
 
     ke_t<P>::mod2(skS0, kS0, signal0);
     ke_t<P>::mod2(skS1, kS1, signal1);
 
-    a1 = random_bit();
+    a1 = random_bit(prng_ctx(ctx));
 
-    nfl::fastrandombytes(&u[0], sizeof(u));
+    nfl::fastrandombytes(prng_ctx(ctx), &u[0], sizeof(u));
 
     memcpy(au, u, bbytes);
 
+    blake3_many_t hashes;
     if (a1 == 0) {
-      uint8_t romMa0_output[HASHSIZE];
-      uint8_t romMa1_output[HASHSIZE];
-      hash_polynomial(skS0, romMa0_output);
-      hash_polynomial(skS1, romMa1_output);
-      memcpy(hma0, romMa0_output, HASHSIZE * sizeof(uint8_t));
-      memcpy(hma1, romMa1_output, HASHSIZE * sizeof(uint8_t));
+      hash_polynomial(skS0, hma0, hashes);
+      hash_polynomial(skS1, hma1, hashes);
     } else {
-      uint8_t romMa0_output[HASHSIZE];
-      uint8_t romMa1_output[HASHSIZE];
-      hash_polynomial(skS0, romMa0_output);
-      hash_polynomial(skS1, romMa1_output);
-      memcpy(hma1, romMa0_output, HASHSIZE * sizeof(uint8_t));
-      memcpy(hma0, romMa1_output, HASHSIZE * sizeof(uint8_t));
+      hash_polynomial(skS0, hma1, hashes);
+      hash_polynomial(skS1, hma0, hashes);
     }
+    hashes.flush();
   }
 
   /** Implements second Bob message in proposed ROT
@@ -359,8 +471,10 @@ struct bob_rot_t
 	    uint32_t sid,
 	    const uint8_t S0[bbytes], const uint8_t S1[bbytes])
   {
-    blake3(&hS0b[0], &S0[0], bbytes);
-    blake3(&hS1b[0], &S1[0], bbytes);
+    blake3_many_t hashes;
+    hashes.add(&hS0b[0], &S0[0], bbytes);
+    hashes.add(&hS1b[0], &S1[0], bbytes);
+    hashes.flush();
 
     if ((memcmp(hS0b, hS0, bbytes) != 0) ||
 	(memcmp(hS1b, hS1, bbytes) != 0))
@@ -398,8 +512,9 @@ struct bob_rot_t
 	  }
       }
 
-    blake3(msg0, &msg0_sid[0], sizeof(msg0_sid));
-    blake3(msg1, &msg1_sid[0], sizeof(msg1_sid));
+    hashes.add(msg0, &msg0_sid[0], sizeof(msg0_sid));
+    hashes.add(msg1, &msg1_sid[0], sizeof(msg1_sid));
+    hashes.flush();
 
     return true;
   }
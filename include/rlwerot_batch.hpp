@@ -0,0 +1,506 @@
+/**
+@file
+*/
+#ifndef __RLWEROT_BATCH_HPP__
+#define __RLWEROT_BATCH_HPP__
+#include <vector>
+#include <new>
+#include <cstring>
+#include "rlwerot.hpp"
+
+/** Implements Alice of the Proposed ROT for a batch of N sessions.
+
+    Each stage of the protocol (sampling, NTTs, reconciliation,
+    hashing) runs as a pass over the whole batch, instead of running
+    N independent alice_rot_t objects one after the other. The NTTs
+    go through nfl::poly_batch when that vectorises them better.
+
+    @tparam P NFL Polynomial type
+    @tparam rbytes Size of random value r
+    @tparam bbytes Size of random masks
+    @tparam HASHSIZE Size of random oracle
+    @tparam N Number of ROT sessions in the batch
+*/
+template<typename P, size_t rbytes, size_t bbytes, size_t HASHSIZE, size_t N>
+struct alice_rot_batch_t
+{
+  static_assert(HASHSIZE == 32); //since we are using Blake3
+  static_assert(N > 0);
+
+  /** Type of polynomial coefficients */
+  using value_t = typename P::value_type;
+  /** Packed hint signal type */
+  using signal_t = typename ke_t<P>::signal_t;
+  /** Packed shared key type */
+  using key_t = typename ke_t<P>::key_t;
+  /** Aligned storage for the polynomials of the batch */
+  using poly_vector_t = std::vector<P, nfl::aligned_allocator<P, 64>>;
+
+  /**@{*/
+  /** Used for RLWE sampling */
+  poly_vector_t sR, eR, eR1;
+  /**@}*/
+  /** Polynomial output of random oracle such that p0 + p1 = h */
+  P h;
+  /** Random OT channel of each session */
+  int b1[N];
+  /**@{*/
+  /** Used for reconciliation with Sender's RLWE samples */
+  poly_vector_t kR;
+  key_t skR[N];
+  /**@}*/
+  /** True for the sessions whose checks succeeded in msg2 */
+  bool valid[N];
+
+  /** Gaussian Noise Sampler */
+  nfl::FastGaussianNoise<uint8_t, value_t, 2>* g_prng;
+  /** PRNG context (nullptr: default context of the calling thread) */
+  nfl::prng_ctx_t *ctx;
+
+  /**@{*/
+  /** Auxiliary structures for the implementation of Random Oracles */
+  rom1_t<P> rom1;
+  rom_P_O<P> rom1_output;
+
+  uint8_t S0[N][bbytes];
+  uint8_t S1[N][bbytes];
+  uint8_t hMc[N][HASHSIZE];
+  /**@}*/
+
+  /** Constructor of Alice
+
+      @param _g_prng Gaussian Noise sampler
+      @param _ctx PRNG context, defaults to the context of the calling thread */
+  alice_rot_batch_t(nfl::FastGaussianNoise<uint8_t, value_t, 2> *_g_prng,
+                    nfl::prng_ctx_t *_ctx = nullptr)
+    : sR(N), eR(N), eR1(N),
+      kR(N),
+      g_prng(_g_prng), ctx(_ctx),
+      rom1_output(h)
+  {
+  }
+
+  /** Batches hold polynomials by value and are usually heap allocated:
+      make sure operator new honours their alignment
+
+      @param size Size of the object
+      @return Pointer to aligned storage */
+  static void *operator new(size_t size)
+  {
+    void *ptr = nfl::aligned_malloc(size, 64);
+    if (ptr == nullptr) throw std::bad_alloc();
+    return ptr;
+  }
+
+  /** Releases storage obtained from operator new
+
+      @param ptr Pointer to the object */
+  static void operator delete(void *ptr)
+  {
+    nfl::aligned_free(ptr);
+  }
+
+  /** Implements first Alice message in proposed ROT for every session
+
+      @param p0 Returns Alice RLWE samples for "channel 0" (N polynomials)
+      @param r_sid Concatenations of Session ID and random value of size 'rbytes'
+      @param hS0 Commitments to masks of channel 0
+      @param hS1 Commitments to masks of channel 1
+      @param sid Session IDs
+      @param m Common polynomial */
+  void msg1(P *p0, uint8_t (*r_sid)[sizeof(uint32_t) + rbytes],
+	    uint8_t (*hS0)[HASHSIZE], uint8_t (*hS1)[HASHSIZE],
+	    const uint32_t *sid, const P &m)
+  {
+    uint8_t bits[N];
+    nfl::fastrandombytes(prng_ctx(ctx), bits, sizeof(bits));
+    for (size_t i = 0; i < N; i++)
+      b1[i] = bits[i] & 1;
+
+    for (size_t i = 0; i < N; i++)
+      {
+	sR[i] = nfl::gaussian<uint8_t, value_t, 2>(g_prng, 1, &prng_ctx(ctx));
+	eR[i] = nfl::gaussian<uint8_t, value_t, 2>(g_prng, 2, &prng_ctx(ctx));
+	eR1[i] = nfl::gaussian<uint8_t, value_t, 2>(g_prng, 2, &prng_ctx(ctx));
+      }
+
+    nfl::batch_ntt_pow_phi(sR.data(), N);
+    nfl::batch_ntt_pow_phi(eR.data(), N);
+
+    for (size_t i = 0; i < N; i++)
+      p0[i] = m * sR[i] + eR[i];
+
+    for (size_t i = 0; i < N; i++)
+      {
+	memcpy(&r_sid[i][0], &sid[i], sizeof(uint32_t));
+	nfl::fastrandombytes(prng_ctx(ctx), &r_sid[i][sizeof(uint32_t)], rbytes);
+      }
+
+    nfl::fastrandombytes(prng_ctx(ctx), &S0[0][0], sizeof(S0));
+    nfl::fastrandombytes(prng_ctx(ctx), &S1[0][0], sizeof(S1));
+
+    blake3_many_t hashes;
+    for (size_t i = 0; i < N; i++)
+      {
+	hashes.add(&hS0[i][0], &S0[i][0], bbytes);
+	hashes.add(&hS1[i][0], &S1[i][0], bbytes);
+      }
+    hashes.flush();
+
+    for (size_t i = 0; i < N; i++)
+      {
+	if (b1[i] == 1)
+	  {
+	    rom1(rom1_output, r_sid[i], rbytes + sizeof(uint32_t));
+	    p0[i] = p0[i] - h;
+	  }
+      }
+  }
+
+  /** Implements second Alice message in proposed ROT for every session.
+      Sessions whose commitments do not match have valid[i] == false and
+      b[i] == -1.
+
+      @param Mb Outputted messages
+      @param b Outputted channels
+      @param bS0 Masks for channel 0, zeroed for rejected sessions
+      @param bS1 Masks for channel 1, zeroed for rejected sessions
+      @param sid Session IDs
+      @param pS Sender's RLWE samples
+      @param signal0 Hint signals for key exchange in channel 0
+      @param signal1 Hint signals for key exchange in channel 1
+      @param ha0 Commitments to key in channel 0 of KE
+      @param ha1 Commitments to key in channel 1 of KE
+      @param u Sender's masks
+      @return Returns true when all checks of all sessions are successful */
+  bool msg2(uint8_t (*Mb)[HASHSIZE],
+	    int *b,
+	    uint8_t (*bS0)[bbytes], uint8_t (*bS1)[bbytes],
+	    const uint32_t *sid, const P *pS,
+	    const signal_t *signal0, const signal_t *signal1,
+	    const uint8_t (*ha0)[HASHSIZE], const uint8_t (*ha1)[HASHSIZE],
+	    const uint8_t (*u)[bbytes])
+  {
+    for (size_t i = 0; i < N; i++)
+      kR[i] = pS[i] * sR[i];
+
+    nfl::batch_invntt_pow_invphi(kR.data(), N);
+
+    for (size_t i = 0; i < N; i++)
+      {
+	kR[i] = kR[i] + eR1[i];
+	ke_t<P>::mod2(skR[i], kR[i], b1[i] == 0 ? signal0[i] : signal1[i]);
+      }
+
+    blake3_many_t hashes;
+    for (size_t i = 0; i < N; i++)
+      hash_polynomial(skR[i], hMc[i], hashes);
+    hashes.flush();
+
+    bool success = true;
+    constexpr size_t sid_size = sizeof(uint32_t);
+    std::vector<uint8_t> Mb_sid_buf(N * (sid_size + bbytes));
+
+    for (size_t i = 0; i < N; i++)
+      {
+	valid[i] = true;
+	if (memcmp(ha0[i], hMc[i], HASHSIZE) == 0) {
+	  b[i] = 0;
+	} else if (memcmp(ha1[i], hMc[i], HASHSIZE) == 0) {
+	  b[i] = 1;
+	} else {
+	  b[i] = -1;
+	  valid[i] = false;
+	  success = false;
+	  continue;
+	}
+
+	uint8_t *Mb_sid = &Mb_sid_buf[i * (sid_size + bbytes)];
+	memcpy(&Mb_sid[0], &sid[i], sid_size);
+	convPtoArray<P, bbytes>(&Mb_sid[sid_size], skR[i]);
+
+	const uint8_t *S = (b1[i] == 0) ? S0[i] : S1[i];
+	for (size_t j = 0; j < bbytes; j++)
+	  {
+	    Mb_sid[sid_size + j] ^= S[j] ^ u[i][j];
+	  }
+
+	hashes.add(Mb[i], &Mb_sid[0], sid_size + bbytes);
+      }
+    hashes.flush();
+
+    // Like alice_rot_t::msg2, the masks of a rejected session are not
+    // opened: its rows are zeroed
+    for (size_t i = 0; i < N; i++)
+      {
+	if (valid[i]) {
+	  memcpy(bS0[i], S0[i], bbytes);
+	  memcpy(bS1[i], S1[i], bbytes);
+	} else {
+	  memset(bS0[i], 0, bbytes);
+	  memset(bS1[i], 0, bbytes);
+	}
+      }
+    return success;
+  }
+};
+
+/** Implements Bob of the Proposed ROT for a batch of N sessions.
+
+    Each stage of the protocol (sampling, NTTs, reconciliation,
+    hashing) runs as a pass over the whole batch, instead of running
+    N independent bob_rot_t objects one after the other. The NTTs
+    go through nfl::poly_batch when that vectorises them better.
+
+    @tparam P NFL Polynomial type
+    @tparam rbytes Size of random value r
+    @tparam bbytes Size of random masks
+    @tparam HASHSIZE Size of random oracle
+    @tparam N Number of ROT sessions in the batch
+*/
+template<typename P, size_t rbytes, size_t bbytes, size_t HASHSIZE, size_t N>
+struct bob_rot_batch_t
+{
+  static_assert(HASHSIZE == 32); //since we are using BLAKE
+  static_assert(N > 0);
+
+  /** Coefficient type */
+  using value_t = typename P::value_type;
+  /** Packed hint signal type */
+  using signal_t = typename ke_t<P>::signal_t;
+  /** Packed shared key type */
+  using key_t = typename ke_t<P>::key_t;
+  /** Aligned storage for the polynomials of the batch */
+  using poly_vector_t = std::vector<P, nfl::aligned_allocator<P, 64>>;
+
+  /**@{*/
+  /** Used for RLWE sampling */
+  poly_vector_t sS, eS, eS1;
+  /**@}*/
+  /** Polynomial output of random oracle such that p0 + p1 = h */
+  P h;
+  /** p1 corresponding to Alice's RLWE sample on channel 1 */
+  P p1;
+  /**@{*/
+  /** Used for RLWE key exchange in channel 0,1 */
+  poly_vector_t kS0, kS1;
+  /**@}*/
+  /**@{*/
+  /** Keys shared under base KE */
+  key_t skS0[N], skS1[N];
+  /**@}*/
+  /** Random flipping of channels of each session */
+  int a1[N];
+  /** True for the sessions whose openings succeeded in msg2 */
+  bool valid[N];
+
+  /**@{*/
+  /** Commitments to receiver's masks */
+  uint8_t hS0[N][HASHSIZE];
+  uint8_t hS1[N][HASHSIZE];
+  /**@}*/
+
+  /** Random masks */
+  uint8_t u[N][bbytes];
+
+  /** Gaussian noise sampler */
+  nfl::FastGaussianNoise<uint8_t, value_t, 2>* g_prng;
+  /** PRNG context (nullptr: default context of the calling thread) */
+  nfl::prng_ctx_t *ctx;
+
+  /**@{*/
+  /** Auxiliary structures for the implementation of Random Oracles */
+  rom1_t<P> rom1;
+  rom_P_O<P> rom1_output;
+  /**@}*/
+
+  /** Constructor of Bob
+
+      @param _g_prng Gaussian Noise sampler
+      @param _ctx PRNG context, defaults to the context of the calling thread */
+  bob_rot_batch_t(nfl::FastGaussianNoise<uint8_t, value_t, 2> *_g_prng,
+                  nfl::prng_ctx_t *_ctx = nullptr)
+    : sS(N), eS(N), eS1(N),
+      kS0(N), kS1(N),
+      g_prng(_g_prng), ctx(_ctx),
+      rom1_output(h)
+  {
+  }
+
+  /** Batches hold polynomials by value and are usually heap allocated:
+      make sure operator new honours their alignment
+
+      @param size Size of the object
+      @return Pointer to aligned storage */
+  static void *operator new(size_t size)
+  {
+    void *ptr = nfl::aligned_malloc(size, 64);
+    if (ptr == nullptr) throw std::bad_alloc();
+    return ptr;
+  }
+
+  /** Releases storage obtained from operator new
+
+      @param ptr Pointer to the object */
+  static void operator delete(void *ptr)
+  {
+    nfl::aligned_free(ptr);
+  }
+
+  /** Implements first Bob message in proposed ROT for every session
+
+      @param pS Bob's RLWE samples
+      @param signal0 Outputted hint signals for "channel 0"
+      @param signal1 Outputted hint signals for "channel 1"
+      @param au Random masks
+      @param hma0 Commitments to shared secret under one of the KE channels
+      @param hma1 Commitments to shared secret under one of the KE channels
+      @param sid Session IDs
+      @param hS0a Commitments to Alice's random masks 0
+      @param hS1a Commitments to Alice's random masks 1
+      @param p0 Alice RLWE samples for "channel 0"
+      @param r_sid Concatenations of Session ID and random value of size 'rbytes'
+      @param m Common polynomial */
+  void msg1(P *pS, signal_t *signal0, signal_t *signal1,
+	    uint8_t (*au)[bbytes],
+	    uint8_t (*hma0)[HASHSIZE], uint8_t (*hma1)[HASHSIZE],
+	    const uint32_t * /* sid */,
+	    const uint8_t (*hS0a)[HASHSIZE],
+	    const uint8_t (*hS1a)[HASHSIZE],
+	    const P *p0, const uint8_t (*r_sid)[sizeof(uint32_t) + rbytes],
+	    const P &m)
+  {
+    memcpy(&hS0[0][0], &hS0a[0][0], sizeof(hS0));
+    memcpy(&hS1[0][0], &hS1a[0][0], sizeof(hS1));
+
+    for (size_t i = 0; i < N; i++)
+      {
+	sS[i] = nfl::gaussian<uint8_t, value_t, 2>(g_prng, 1, &prng_ctx(ctx));
+	eS[i] = nfl::gaussian<uint8_t, value_t, 2>(g_prng, 2, &prng_ctx(ctx));
+	eS1[i] = nfl::gaussian<uint8_t, value_t, 2>(g_prng, 2, &prng_ctx(ctx));
+      }
+
+    nfl::batch_ntt_pow_phi(sS.data(), N);
+    nfl::batch_ntt_pow_phi(eS.data(), N);
+
+    for (size_t i = 0; i < N; i++)
+      pS[i] = m * sS[i] + eS[i];
+
+    for (size_t i = 0; i < N; i++)
+      {
+	rom1(rom1_output, r_sid[i], rbytes + sizeof(uint32_t));
+	p1 = p0[i] + h;
+
+	kS0[i] = p0[i] * sS[i];
+	kS1[i] = p1 * sS[i];
+      }
+
+    nfl::batch_invntt_pow_invphi(kS0.data(), N);
+    nfl::batch_invntt_pow_invphi(kS1.data(), N);
+
+    uint8_t bits[2 * N];
+    nfl::fastrandombytes(prng_ctx(ctx), bits, sizeof(bits));
+
+    for (size_t i = 0; i < N; i++)
+      {
+	kS0[i] = kS0[i] + eS1[i];
+	kS1[i] = kS1[i] + eS1[i];
+
+	ke_t<P>::signal(signal0[i], kS0[i], bits[2 * i]);
+	ke_t<P>::signal(signal1[i], kS1[i], bits[2 * i + 1]);
+
+	ke_t<P>::mod2(skS0[i], kS0[i], signal0[i]);
+	ke_t<P>::mod2(skS1[i], kS1[i], signal1[i]);
+      }
+
+    nfl::fastrandombytes(prng_ctx(ctx), bits, N);
+    for (size_t i = 0; i < N; i++)
+      a1[i] = bits[i] & 1;
+
+    nfl::fastrandombytes(prng_ctx(ctx), &u[0][0], sizeof(u));
+    memcpy(&au[0][0], &u[0][0], sizeof(u));
+
+    blake3_many_t hashes;
+    for (size_t i = 0; i < N; i++)
+      {
+	if (a1[i] == 0) {
+	  hash_polynomial(skS0[i], hma0[i], hashes);
+	  hash_polynomial(skS1[i], hma1[i], hashes);
+	} else {
+	  hash_polynomial(skS0[i], hma1[i], hashes);
+	  hash_polynomial(skS1[i], hma0[i], hashes);
+	}
+      }
+    hashes.flush();
+  }
+
+  /** Implements second Bob message in proposed ROT for every session.
+      Sessions whose masks do not open the commitments have
+      valid[i] == false.
+
+      @param msg0 Returned messages in channel 0
+      @param msg1 Returned messages in channel 1
+      @param sid Session IDs
+      @param S0 Alice's masks 0
+      @param S1 Alice's masks 1
+      @return Returns true if opening of masks is successful for all sessions
+  */
+  bool msg2(uint8_t (*msg0)[HASHSIZE], uint8_t (*msg1)[HASHSIZE],
+	    const uint32_t *sid,
+	    const uint8_t (*S0)[bbytes], const uint8_t (*S1)[bbytes])
+  {
+    std::vector<uint8_t> hSb(2 * N * HASHSIZE);
+    blake3_many_t hashes;
+    bool success = true;
+
+    for (size_t i = 0; i < N; i++)
+      {
+	hashes.add(&hSb[2 * i * HASHSIZE], &S0[i][0], bbytes);
+	hashes.add(&hSb[(2 * i + 1) * HASHSIZE], &S1[i][0], bbytes);
+      }
+    hashes.flush();
+
+    for (size_t i = 0; i < N; i++)
+      {
+	valid[i] = (memcmp(&hSb[2 * i * HASHSIZE], hS0[i], HASHSIZE) == 0) &&
+	  (memcmp(&hSb[(2 * i + 1) * HASHSIZE], hS1[i], HASHSIZE) == 0);
+	success = success && valid[i];
+      }
+
+    constexpr size_t sid_size = sizeof(uint32_t);
+    std::vector<uint8_t> msg_sid_buf(2 * N * (sid_size + bbytes));
+
+    for (size_t i = 0; i < N; i++)
+      {
+	if (!valid[i])
+	  continue;
+
+	uint8_t *msg0_sid = &msg_sid_buf[2 * i * (sid_size + bbytes)];
+	uint8_t *msg1_sid = msg0_sid + sid_size + bbytes;
+	memcpy(&msg0_sid[0], &sid[i], sid_size);
+	memcpy(&msg1_sid[0], &sid[i], sid_size);
+
+	const key_t &sk0 = (a1[i] == 0) ? skS0[i] : skS1[i];
+	const key_t &sk1 = (a1[i] == 0) ? skS1[i] : skS0[i];
+	const uint8_t *T0 = (a1[i] == 0) ? S0[i] : S1[i];
+	const uint8_t *T1 = (a1[i] == 0) ? S1[i] : S0[i];
+
+	convPtoArray<P, bbytes>(&msg0_sid[sid_size], sk0);
+	convPtoArray<P, bbytes>(&msg1_sid[sid_size], sk1);
+
+	for (size_t j = 0; j < bbytes; j++)
+	  {
+	    msg0_sid[j + sid_size] ^= T0[j] ^ u[i][j];
+	    msg1_sid[j + sid_size] ^= T1[j] ^ u[i][j];
+	  }
+
+	hashes.add(msg0[i], &msg0_sid[0], sid_size + bbytes);
+	hashes.add(msg1[i], &msg1_sid[0], sid_size + bbytes);
+      }
+    hashes.flush();
+
+    return success;
+  }
+};
+
+#endif
@@ -5,6 +5,20 @@
 #define __ROMS_HPP__
 #include "blake3.h"
 #include <algorithm>
+#include <cstring>
+#include <type_traits>
+#include "poly_codec.hpp"
+#if defined(NTT_SSE) && !defined(NTT_AVX2) && !defined(NTT_AVX512)
+#include <immintrin.h>
+#endif
+
+// Internal header of the Blake3 submodule, for blake3_hash_many (the
+// multi-input compression of whole chunks, dispatched at runtime to the
+// SSE4.1/AVX2/AVX-512/NEON kernels), the IV, the domain flags and the
+// message schedule
+extern "C" {
+#include "blake3_impl.h"
+}
 
 /** Provides an interface to Blake3
 
@@ -20,6 +34,258 @@ void blake3(uint8_t *out, const uint8_t *in, size_t len)
   blake3_hasher_finalize(&hasher, out, BLAKE3_OUT_LEN);
 }
 
+/** Vector of 32-bit words, one per independent Blake3 compression */
+#if defined(NTT_AVX512)
+struct blake3_lanes_t
+{
+  /** Number of lanes */
+  static constexpr size_t lanes = 16;
+  /** Vector type */
+  using v_t = __m512i;
+
+  static v_t load(const uint32_t *p) { return _mm512_load_si512((const void *)p); }
+  static void store(uint32_t *p, v_t x) { _mm512_store_si512((void *)p, x); }
+  static v_t set1(uint32_t x) { return _mm512_set1_epi32(x); }
+  static v_t add(v_t a, v_t b) { return _mm512_add_epi32(a, b); }
+  static v_t xor_(v_t a, v_t b) { return _mm512_xor_si512(a, b); }
+  template<int c> static v_t rotr(v_t a) { return _mm512_ror_epi32(a, c); }
+};
+#elif defined(NTT_AVX2)
+struct blake3_lanes_t
+{
+  /** Number of lanes */
+  static constexpr size_t lanes = 8;
+  /** Vector type */
+  using v_t = __m256i;
+
+  static v_t load(const uint32_t *p) { return _mm256_load_si256((const __m256i *)p); }
+  static void store(uint32_t *p, v_t x) { _mm256_store_si256((__m256i *)p, x); }
+  static v_t set1(uint32_t x) { return _mm256_set1_epi32(x); }
+  static v_t add(v_t a, v_t b) { return _mm256_add_epi32(a, b); }
+  static v_t xor_(v_t a, v_t b) { return _mm256_xor_si256(a, b); }
+  template<int c> static v_t rotr(v_t a)
+  {
+    return _mm256_or_si256(_mm256_srli_epi32(a, c), _mm256_slli_epi32(a, 32 - c));
+  }
+};
+#elif defined(NTT_SSE)
+struct blake3_lanes_t
+{
+  /** Number of lanes */
+  static constexpr size_t lanes = 4;
+  /** Vector type */
+  using v_t = __m128i;
+
+  static v_t load(const uint32_t *p) { return _mm_load_si128((const __m128i *)p); }
+  static void store(uint32_t *p, v_t x) { _mm_store_si128((__m128i *)p, x); }
+  static v_t set1(uint32_t x) { return _mm_set1_epi32(x); }
+  static v_t add(v_t a, v_t b) { return _mm_add_epi32(a, b); }
+  static v_t xor_(v_t a, v_t b) { return _mm_xor_si128(a, b); }
+  template<int c> static v_t rotr(v_t a)
+  {
+    return _mm_or_si128(_mm_srli_epi32(a, c), _mm_slli_epi32(a, 32 - c));
+  }
+};
+#else
+struct blake3_lanes_t
+{
+  /** Number of lanes */
+  static constexpr size_t lanes = 1;
+  /** Vector type */
+  using v_t = uint32_t;
+
+  static v_t load(const uint32_t *p) { return *p; }
+  static void store(uint32_t *p, v_t x) { *p = x; }
+  static v_t set1(uint32_t x) { return x; }
+  static v_t add(v_t a, v_t b) { return a + b; }
+  static v_t xor_(v_t a, v_t b) { return a ^ b; }
+  template<int c> static v_t rotr(v_t a) { return (a >> c) | (a << (32 - c)); }
+};
+#endif
+
+/** Batched Blake3 of short independent inputs, e.g. the commitments and
+    output messages of several ROT sessions. Inputs are queued by add() and
+    hashed by flush(), up to 16 at a time: inputs made of whole blocks go
+    through the hash_many kernels of Blake3, the others through a
+    compression of blake3_lanes_t::lanes inputs at a time, since hash_many
+    only handles full blocks.
+
+    Outputs are only written by flush(), or by add() when the queue is full
+    or the input has another number of blocks than the queued ones. Inputs
+    must stay valid until then.
+*/
+struct blake3_many_t
+{
+  /** Size of the queue */
+  static constexpr size_t MAX_LANES = 16;
+
+  /**@{*/
+  /** Queued inputs, lengths and outputs */
+  const uint8_t *in[MAX_LANES];
+  size_t len[MAX_LANES];
+  uint8_t *out[MAX_LANES];
+  /**@}*/
+  /** Number of queued inputs */
+  size_t n;
+  /** Number of blocks of every queued input */
+  size_t blocks;
+
+  /** Builds an empty queue */
+  blake3_many_t()
+    : n(0), blocks(0)
+  {
+  }
+
+  /** @return Blake3 initialisation vector */
+  static const uint32_t *iv()
+  {
+    return IV;
+  }
+
+  /** Queues a hash, computed on the spot when in spans several chunks
+
+      @param _out Outputted hash, written at the next flush
+      @param _in Inputted string
+      @param _len Lenght of in */
+  void add(uint8_t *_out, const uint8_t *_in, size_t _len)
+  {
+    if (_len > BLAKE3_CHUNK_LEN)
+      {
+	blake3(_out, _in, _len);
+	return;
+      }
+
+    size_t b = (_len == 0) ? 1 : CEILING(_len, BLAKE3_BLOCK_LEN);
+    if (n > 0 && b != blocks)
+      flush();
+
+    blocks = b;
+    in[n] = _in;
+    len[n] = _len;
+    out[n] = _out;
+    if (++n == MAX_LANES)
+      flush();
+  }
+
+  /** Hashes the queued inputs */
+  void flush()
+  {
+    // A lone input is cheaper hashed on its own than in a batch of lanes
+    if (n == 1)
+      {
+	blake3(out[0], in[0], len[0]);
+	n = 0;
+	return;
+      }
+
+    bool full_blocks = true;
+    for (size_t i = 0; i < n; i++)
+      full_blocks = full_blocks && len[i] == blocks * BLAKE3_BLOCK_LEN;
+
+    if (full_blocks)
+      {
+	uint8_t cvs[MAX_LANES * BLAKE3_OUT_LEN];
+	blake3_hash_many(in, n, blocks, iv(), 0, false, 0, CHUNK_START, CHUNK_END | ROOT, cvs);
+	for (size_t i = 0; i < n; i++)
+	  memcpy(out[i], &cvs[i * BLAKE3_OUT_LEN], BLAKE3_OUT_LEN);
+      }
+    else
+      {
+	constexpr size_t L = blake3_lanes_t::lanes;
+	for (size_t i = 0; i < n; i += L)
+	  compress_lanes(i, std::min(n - i, L));
+      }
+    n = 0;
+  }
+
+  /** Blake3 G function on every lane */
+  static void g(blake3_lanes_t::v_t *s, size_t a, size_t b, size_t c, size_t d,
+		blake3_lanes_t::v_t x, blake3_lanes_t::v_t y)
+  {
+    using V = blake3_lanes_t;
+    s[a] = V::add(V::add(s[a], s[b]), x);
+    s[d] = V::rotr<16>(V::xor_(s[d], s[a]));
+    s[c] = V::add(s[c], s[d]);
+    s[b] = V::rotr<12>(V::xor_(s[b], s[c]));
+    s[a] = V::add(V::add(s[a], s[b]), y);
+    s[d] = V::rotr<8>(V::xor_(s[d], s[a]));
+    s[c] = V::add(s[c], s[d]);
+    s[b] = V::rotr<7>(V::xor_(s[b], s[c]));
+  }
+
+  /** Hashes queued inputs first to first + count - 1 with one compression
+      per block over all lanes. Unused lanes hash zeroes.
+
+      @param first First queued input
+      @param count Number of inputs, at most blake3_lanes_t::lanes */
+  void compress_lanes(size_t first, size_t count)
+  {
+    using V = blake3_lanes_t;
+    constexpr size_t L = V::lanes;
+
+    // Words of the lanes are transposed so that vector w holds word w of
+    // every lane
+    alignas(64) uint32_t words[16][L];
+    alignas(64) uint32_t block_len[L];
+    alignas(64) uint32_t h[8][L];
+    V::v_t cv[8], m[16], s[16];
+
+    for (size_t w = 0; w < 8; w++)
+      cv[w] = V::set1(iv()[w]);
+
+    for (size_t blk = 0; blk < blocks; blk++)
+      {
+	uint8_t flags = (blk == 0 ? CHUNK_START : 0) | (blk + 1 == blocks ? CHUNK_END | ROOT : 0);
+
+	for (size_t l = 0; l < L; l++)
+	  {
+	    uint32_t tmp[16] = {0};
+	    size_t off = blk * BLAKE3_BLOCK_LEN;
+	    size_t bytes = (l < count) ? std::min(len[first + l] - off, (size_t)BLAKE3_BLOCK_LEN) : 0;
+
+	    if (bytes > 0)
+	      memcpy(tmp, in[first + l] + off, bytes);
+	    for (size_t w = 0; w < 16; w++)
+	      words[w][l] = tmp[w];
+	    block_len[l] = bytes;
+	  }
+
+	for (size_t w = 0; w < 16; w++)
+	  m[w] = V::load(words[w]);
+	for (size_t w = 0; w < 8; w++)
+	  s[w] = cv[w];
+	for (size_t w = 0; w < 4; w++)
+	  s[8 + w] = V::set1(iv()[w]);
+	s[12] = V::set1(0);
+	s[13] = V::set1(0);
+	s[14] = V::load(block_len);
+	s[15] = V::set1(flags);
+
+	for (size_t r = 0; r < 7; r++)
+	  {
+	    const uint8_t *sc = MSG_SCHEDULE[r];
+	    g(s, 0, 4, 8, 12, m[sc[0]], m[sc[1]]);
+	    g(s, 1, 5, 9, 13, m[sc[2]], m[sc[3]]);
+	    g(s, 2, 6, 10, 14, m[sc[4]], m[sc[5]]);
+	    g(s, 3, 7, 11, 15, m[sc[6]], m[sc[7]]);
+	    g(s, 0, 5, 10, 15, m[sc[8]], m[sc[9]]);
+	    g(s, 1, 6, 11, 12, m[sc[10]], m[sc[11]]);
+	    g(s, 2, 7, 8, 13, m[sc[12]], m[sc[13]]);
+	    g(s, 3, 4, 9, 14, m[sc[14]], m[sc[15]]);
+	  }
+
+	for (size_t w = 0; w < 8; w++)
+	  cv[w] = V::xor_(s[w], s[w + 8]);
+      }
+
+    for (size_t w = 0; w < 8; w++)
+      V::store(h[w], cv[w]);
+    for (size_t l = 0; l < count; l++)
+      for (size_t w = 0; w < 8; w++)
+	memcpy(&out[first + l][4 * w], &h[w][l], sizeof(uint32_t));
+  }
+};
+
 /** Implements a Random Oracle. T provides functionality
     to handle internal buffer such as selecting valid outputs.
     O wraps the output buffer
@@ -112,102 +378,175 @@ struct rom_P_O
   }
 };
 
-/** To be used as T for rom_t with P as co-domain
+/** Compaction table for rejection sampling: entry m lists the bytes of the
+    16-bit lanes set in the 8-bit mask m, in order, as 16-byte shuffle
+    indices */
+struct rej_lut_t
+{
+  /** Shuffle indices */
+  uint8_t idx[256][16];
+  /** Number of lanes set in each mask */
+  uint8_t count[256];
+
+  /** Builds the table */
+  rej_lut_t()
+  {
+    for (size_t m = 0; m < 256; m++)
+      {
+	size_t k = 0;
+	memset(idx[m], 0, sizeof(idx[m]));
+	for (size_t i = 0; i < 8; i++)
+	  {
+	    if ((m >> i) & 1)
+	      {
+		idx[m][2 * k] = 2 * i;
+		idx[m][2 * k + 1] = 2 * i + 1;
+		k++;
+	      }
+	  }
+	count[m] = k;
+      }
+  }
+};
+
+/** Shared compaction table
+
+    @return Compaction table */
+inline const rej_lut_t &rej_lut()
+{
+  static const rej_lut_t lut;
+  return lut;
+}
+
+#if defined(NTT_AVX2) || defined(NTT_AVX512)
+/** Rejection sampling of 16 words of 14 bits: stores the words smaller than
+    q to out, in order
+
+    @param out Outputted coefficients, 16 of which must be writable
+    @param in 28 bytes, 32 of which must be readable
+    @param q Modulus
+    @param lut Compaction table
+    @return Number of accepted words
+*/
+inline size_t rej14_block(uint16_t *out, const uint8_t *in, uint16_t q, const rej_lut_t &lut)
+{
+  __m256i v = unpack14_vec(in);
+  __m256i ok = _mm256_cmpgt_epi16(_mm256_set1_epi16(q), v);
+
+  // One bit per lane: bits 0-7 for the low half, 16-23 for the high half
+  uint32_t m = _mm256_movemask_epi8(_mm256_packs_epi16(ok, _mm256_setzero_si256()));
+  uint32_t m0 = m & 0xFF, m1 = (m >> 16) & 0xFF;
+
+  __m128i lo = _mm_shuffle_epi8(_mm256_castsi256_si128(v),
+				_mm_loadu_si128((const __m128i *)lut.idx[m0]));
+  __m128i hi = _mm_shuffle_epi8(_mm256_extracti128_si256(v, 1),
+				_mm_loadu_si128((const __m128i *)lut.idx[m1]));
+  _mm_storeu_si128((__m128i *)out, lo);
+  _mm_storeu_si128((__m128i *)(out + lut.count[m0]), hi);
+
+  return lut.count[m0] + lut.count[m1];
+}
+#endif
+
+/** Random oracle with polynomials as co-domain. The input is absorbed once
+    and the BLAKE3 XOF output is read as a stream of nbits-bit little endian
+    words, the words smaller than the modulus being the coefficients.
 
     @tparam P NFL Polynomial type
 */
 template<typename P>
-struct rom_P_T
+struct rom_xof_P_t
 {
-  /** Indicates how many polynomial coefficients
-      the output of a single Blake3 iteration can fill */
-  static constexpr size_t N = 256 / P::nbits;
   /** Type of polynomial coefficient */
-  typedef typename P::value_type value_t;
-
-  /** Pointer to internal rom_t array */
-  uint8_t *a;
-  /** Holds intermediate hashes, computed as HASH(a || j) */
-  uint8_t a1[32];
-  /** Holds hash-output split into coefficient-size words */
-  value_t state[N];
-  /** j is used as part of the iterative hashing process
-      (namely to compute HASH(a || j) */
-  int j;
-  /** Counts how many words have been outputted. When k reaches
-      N, j is incremented and a1/state are recomputed */
-  int k;
+  using value_t = typename P::value_type;
+  /** Bits per candidate word */
+  static constexpr size_t nbits = P::nbits;
+  /** Candidate words per XOF read */
+  static constexpr size_t NCAND = 512;
+  /** Bytes per XOF read (whole 64-byte XOF blocks) */
+  static constexpr size_t BUFBYTES = NCAND * nbits / 8;
+  /** Bit accumulator of the portable sampler */
+  using acc_t = typename poly_codec_t<P>::acc_t;
+
+#ifdef PACK14_BLOCK
+  /** Whether the SIMD sampler applies to P */
+  using simd_t = std::integral_constant<bool, std::is_same<value_t, uint16_t>::value && nbits == 14>;
+#else
+  using simd_t = std::false_type;
+#endif
 
-  /** Initializes pointer to internal rom_t array
+  /** XOF output, followed by the slack read by the SIMD sampler */
+  uint8_t buf[BUFBYTES + 4];
 
-      @param b Internal rom_t array */
-  rom_P_T(uint8_t *b)
-    : a(b)
-  {
-  }
+  /** Produces random oracle in polynomial wrapped by b from data
 
-  /** Reinitializes counter j and starts ROMing process */
-  void restart()
-  {
-    j = 0;
-    refresh();
-  }
-
-  /** Computes state <- SplitIntoCoeffSizeWords(HASH(a || j)) and
-      increments j
+      @param b Outputted value
+      @param data ROM input
+      @param len Lenght of ROM input
   */
-  void refresh()
+  void operator()(rom_P_O<P> &b, const uint8_t *data, size_t len)
   {
-    a[32] = j;
-    blake3(a1, a, 33);
-
-    for (size_t i = 0; i < N; i++) {
-        state[i] = 0;
-        size_t offset = i * P::nbits;
-        for (size_t l = 0; l < P::nbits; l++) {
-            size_t nword = (offset + l) >> 3;
-            size_t nshift = (offset + l) & 7;
-            typename P::value_type bit = (a1[nword] >> nshift) & 1;
-            state[i] = state[i] | (bit << l);
-        }
-    }
-
-    j++;
-    k = 0;
+    blake3_hasher hasher;
+    blake3_hasher_init(&hasher);
+    blake3_hasher_update(&hasher, data, len);
+
+    value_t *out = &b.pol(0, 0);
+    size_t n = 0;
+    for (uint64_t seek = 0; n < P::degree; seek += BUFBYTES)
+      {
+	blake3_hasher_finalize_seek(&hasher, seek, buf, BUFBYTES);
+	n += sample(&out[n], P::degree - n, buf, NCAND, simd_t());
+      }
+    b.j = P::degree;
   }
 
-  /** Returns true when no more words can be outputted without calling
-      refresh again
+  /**@{*/
+  /** Rejection sampling of candidate words
 
-      @return True when all words in state have been consumed */
-  bool empty()
+      @param out Outputted coefficients
+      @param max Maximum number of outputted coefficients
+      @param in Packed candidate words
+      @param ncand Number of candidate words
+      @return Number of outputted coefficients */
+  static size_t sample(value_t *out, size_t max, const uint8_t *in, size_t ncand, std::false_type)
   {
-    return k == N;
+    const acc_t mask = ((acc_t)1 << nbits) - 1;
+    const value_t q = P::get_modulus(0);
+    acc_t acc = 0;
+    size_t nacc = 0, j = 0, n = 0;
+
+    for (size_t i = 0; i < ncand && n < max; i++)
+      {
+	for (; nacc < nbits; nacc += 8)
+	  acc |= (acc_t)in[j++] << nacc;
+	value_t v = (value_t)(acc & mask);
+	acc >>= nbits;
+	nacc -= nbits;
+	if (v < q)
+	  out[n++] = v;
+      }
+    return n;
   }
 
-  /** Returns next coefficient-size word produced
-
-      @return ROM coefficient-size word */
-  value_t next()
+#ifdef PACK14_BLOCK
+  static size_t sample(value_t *out, size_t max, const uint8_t *in, size_t ncand, std::true_type)
   {
-    return state[k++];
-  }
+    const rej_lut_t &lut = rej_lut();
+    size_t n = 0, i = 0;
 
-  /** Returns true when v is a valid coefficient
-      (non-negative valid < p)
+    // The kernel may write a whole block of coefficients
+    for (; i < ncand && n + PACK14_BLOCK <= max; i += PACK14_BLOCK)
+      n += rej14_block(&out[n], &in[i * 14 / 8], P::get_modulus(0), lut);
 
-      @param v Tested value
-      @return True when v < p
-  */
-  bool filter(value_t v)
-  {
-    return v < P::get_modulus(0);
+    return n + sample(&out[n], max - n, &in[i * 14 / 8], ncand - i, std::false_type());
   }
+#endif
+  /**@}*/
 };
 
 /** Random oracle to output polynomials */
 template<typename P>
-using rom1_t = rom_t<rom_P_O<P>, rom_P_T<P>>;
+using rom1_t = rom_xof_P_t<P>;
 
 /** Used as O in rom_t when output is an array
 
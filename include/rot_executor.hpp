@@ -0,0 +1,431 @@
+/**
+@file
+
+Multi-core execution of independent (R)OT sessions.
+
+A fixed pool of worker threads runs the sessions of a contiguous range of
+session IDs. Each worker owns its Gaussian sampler, PRNG context and
+common polynomial cache, so that sessions never share sampling state, and
+idle workers steal pending chunks of sessions from the busy ones.
+rot_session_t and ot_session_t run both parties of one session
+in-process, e.g. to measure the per-core throughput.
+*/
+#ifndef __ROT_EXECUTOR_HPP__
+#define __ROT_EXECUTOR_HPP__
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <cstring>
+#include "rlweot.hpp"
+#include "rlwerot.hpp"
+#include "common_poly.hpp"
+
+/** State owned by each worker of rot_executor_t. Sessions run by a worker
+    only use its own sampler, PRNG context and common polynomial cache.
+
+    @tparam P NFL Polynomial type
+*/
+template<typename P>
+struct rot_worker_t
+{
+  /** Type of polynomial coefficients */
+  using value_t = typename P::value_type;
+
+  /** Index of the worker */
+  size_t id;
+  /** Gaussian Noise sampler of the worker */
+  std::unique_ptr<nfl::FastGaussianNoise<uint8_t, value_t, 2>> g_prng;
+  /** PRNG context of the worker */
+  nfl::prng_ctx_t ctx;
+  /** Common polynomials expanded by the worker */
+  common_poly_cache_t<P> cache;
+
+  /**@{*/
+  /** Statistics of the last call to rot_executor_t::run */
+  size_t sessions, failures, steals;
+  double busy;
+  /**@}*/
+
+  /** Constructor of a worker
+
+      @param _id Index of the worker
+      @param sigma Standard deviation of the Gaussian Noise sampler
+      @param security Security parameter of the Gaussian Noise sampler */
+  rot_worker_t(size_t _id, double sigma, unsigned security)
+    : id(_id),
+      g_prng(new nfl::FastGaussianNoise<uint8_t, value_t, 2>(sigma, security, P::degree)),
+      sessions(0), failures(0), steals(0), busy(0)
+  {
+  }
+};
+
+/** Runs independent (R)OT sessions on a pool of threads with work stealing.
+
+    run() splits the sessions in chunks which are dealt round-robin to
+    per-worker queues. Workers consume their own queue from the front and,
+    once empty, steal chunks from the back of the other queues.
+
+    @tparam P NFL Polynomial type
+*/
+template<typename P>
+struct rot_executor_t
+{
+  /** Worker type */
+  using worker_t = rot_worker_t<P>;
+  /** A session: returns true when it succeeded */
+  using task_t = std::function<bool(worker_t &, uint32_t)>;
+
+  /** Range of session IDs */
+  struct range_t
+  {
+    /** First session ID */
+    uint32_t first;
+    /** Number of sessions */
+    uint32_t count;
+  };
+
+  /** Queue of ranges owned by one worker */
+  struct queue_t
+  {
+    /** Protects q */
+    std::mutex m;
+    /** Pending ranges */
+    std::deque<range_t> q;
+  };
+
+  /**@{*/
+  /** Workers' state, queues and threads */
+  std::vector<std::unique_ptr<worker_t>> workers;
+  std::vector<std::unique_ptr<queue_t>> queues;
+  std::vector<std::thread> threads;
+  /**@}*/
+
+  /**@{*/
+  /** Synchronisation between run() and the workers */
+  std::mutex m;
+  std::condition_variable cv_work, cv_done;
+  const task_t *task;
+  uint64_t generation;
+  size_t active;
+  bool stop;
+  std::atomic<size_t> pending;
+  /**@}*/
+
+  /** Wall-clock time of the last call to run, in seconds */
+  double wall;
+
+  /** Constructor of the executor. Builds one sampler per worker.
+
+      @param nthreads Number of worker threads
+      @param sigma Standard deviation of the Gaussian Noise samplers
+      @param security Security parameter of the Gaussian Noise samplers */
+  rot_executor_t(size_t nthreads, double sigma, unsigned security = 138)
+    : task(nullptr), generation(0), active(0), stop(false), pending(0), wall(0)
+  {
+    if (nthreads == 0)
+      nthreads = 1;
+
+    for (size_t i = 0; i < nthreads; i++)
+      {
+	workers.emplace_back(new worker_t(i, sigma, security));
+	queues.emplace_back(new queue_t);
+      }
+
+    for (size_t i = 0; i < nthreads; i++)
+      threads.emplace_back(&rot_executor_t::work, this, i);
+  }
+
+  /** Stops and joins the workers */
+  ~rot_executor_t()
+  {
+    {
+      std::lock_guard<std::mutex> lock(m);
+      stop = true;
+    }
+    cv_work.notify_all();
+
+    for (size_t i = 0; i < threads.size(); i++)
+      threads[i].join();
+  }
+
+  /** Number of workers
+
+      @return Number of workers */
+  size_t size() const
+  {
+    return workers.size();
+  }
+
+  /** Runs sessions first_sid, ..., first_sid + count - 1 and waits for
+      their completion. Per-worker statistics are reset.
+
+      @param first_sid Session ID of the first session
+      @param count Number of sessions
+      @param t Session to be run
+      @param chunk Number of sessions per scheduled range
+      @return Number of failed sessions
+      @throw std::out_of_range when the last session ID exceeds 2^32 - 1 */
+  size_t run(uint32_t first_sid, size_t count, const task_t &t, size_t chunk = 8)
+  {
+    if (count > (uint64_t)UINT32_MAX + 1 - first_sid)
+      throw std::out_of_range("rot_executor_t: session IDs beyond 2^32 - 1");
+    if (chunk == 0)
+      chunk = 1;
+    else if (chunk > UINT32_MAX)
+      chunk = UINT32_MAX;
+
+    size_t nchunks = 0;
+    for (size_t i = 0; i < workers.size(); i++)
+      {
+	workers[i]->sessions = workers[i]->failures = workers[i]->steals = 0;
+	workers[i]->busy = 0;
+      }
+
+    for (size_t done = 0; done < count; done += chunk, nchunks++)
+      {
+	range_t r;
+	r.first = first_sid + done;
+	r.count = (count - done < chunk) ? count - done : chunk;
+
+	std::lock_guard<std::mutex> lock(queues[nchunks % queues.size()]->m);
+	queues[nchunks % queues.size()]->q.push_back(r);
+      }
+
+    auto start = std::chrono::steady_clock::now();
+    {
+      std::unique_lock<std::mutex> lock(m);
+      pending = nchunks;
+      task = &t;
+      generation++;
+      cv_work.notify_all();
+
+      cv_done.wait(lock, [this] { return pending == 0 && active == 0; });
+      task = nullptr;
+    }
+    wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    size_t failures = 0;
+    for (size_t i = 0; i < workers.size(); i++)
+      failures += workers[i]->failures;
+    return failures;
+  }
+
+  /** Total number of sessions per second of the last run
+
+      @return Sessions per second */
+  double throughput() const
+  {
+    size_t sessions = 0;
+    for (size_t i = 0; i < workers.size(); i++)
+      sessions += workers[i]->sessions;
+    return wall > 0 ? sessions / wall : 0;
+  }
+
+  /** Writes per-worker (i.e. per-core) throughput of the last run
+
+      @param os Output stream */
+  void report(std::ostream &os) const
+  {
+    for (size_t i = 0; i < workers.size(); i++)
+      {
+	const worker_t &w = *workers[i];
+	os << "worker " << w.id << ": " << w.sessions << " sessions, "
+	   << (w.busy > 0 ? w.sessions / w.busy : 0) << " sessions/s, "
+	   << w.steals << " steals, " << w.failures << " failures" << std::endl;
+      }
+    os << "total: " << throughput() << " sessions/s" << std::endl;
+  }
+
+  /** Pops a range from the worker's own queue, or steals one
+
+      @param id Index of the worker
+      @param r Returned range
+      @param stolen Set to true when r was stolen
+      @return False when all queues are empty */
+  bool next_range(size_t id, range_t &r, bool &stolen)
+  {
+    for (size_t k = 0; k < queues.size(); k++)
+      {
+	queue_t &qu = *queues[(id + k) % queues.size()];
+	std::lock_guard<std::mutex> lock(qu.m);
+	if (qu.q.empty())
+	  continue;
+
+	if (k == 0)
+	  {
+	    r = qu.q.front();
+	    qu.q.pop_front();
+	  }
+	else
+	  {
+	    r = qu.q.back();
+	    qu.q.pop_back();
+	  }
+	stolen = (k != 0);
+	return true;
+      }
+    return false;
+  }
+
+  /** Worker thread main loop
+
+      @param id Index of the worker */
+  void work(size_t id)
+  {
+    worker_t &w = *workers[id];
+    uint64_t seen = 0;
+
+    for (;;)
+      {
+	const task_t *t;
+	{
+	  std::unique_lock<std::mutex> lock(m);
+	  cv_work.wait(lock, [&] { return stop || generation != seen; });
+	  if (stop)
+	    return;
+	  seen = generation;
+	  if (task == nullptr)
+	    continue;
+	  t = task;
+	  active++;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	range_t r;
+	bool stolen;
+	while (next_range(id, r, stolen))
+	  {
+	    if (stolen)
+	      w.steals++;
+	    for (uint32_t k = 0; k < r.count; k++)
+	      {
+		if (!(*t)(w, r.first + k))
+		  w.failures++;
+		w.sessions++;
+	      }
+	    pending--;
+	  }
+	w.busy += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	{
+	  std::lock_guard<std::mutex> lock(m);
+	  active--;
+	}
+	cv_done.notify_all();
+      }
+  }
+};
+
+/** Runs one proposed ROT session, both parties in-process, on a worker
+
+    @tparam P NFL Polynomial type
+    @tparam rbytes Size of random value r
+    @tparam bbytes Size of random masks
+    @tparam HASHSIZE Size of random oracle
+*/
+template<typename P, size_t rbytes, size_t bbytes, size_t HASHSIZE>
+struct rot_session_t
+{
+  /** Seed of the common polynomial */
+  uint8_t seed[COMMON_POLY_SEEDBYTES];
+
+  /** Constructor of the session
+
+      @param _seed Seed of the common polynomial */
+  rot_session_t(const uint8_t _seed[COMMON_POLY_SEEDBYTES])
+  {
+    memcpy(seed, _seed, sizeof(seed));
+  }
+
+  /** Runs the session
+
+      @param w Worker running the session
+      @param sid Session ID
+      @return True when both parties agree on the message of channel b */
+  bool operator()(rot_worker_t<P> &w, uint32_t sid) const
+  {
+    alice_rot_t<P, rbytes, bbytes, HASHSIZE> alice(w.g_prng.get(), &w.ctx);
+    bob_rot_t<P, rbytes, bbytes, HASHSIZE> bob(w.g_prng.get(), &w.ctx);
+    const P &m = w.cache.get(seed);
+    P p0, pS;
+    typename ke_t<P>::signal_t signal0, signal1;
+    uint8_t r_sid[sizeof(uint32_t) + rbytes];
+    uint8_t hS0[HASHSIZE], hS1[HASHSIZE], hma0[HASHSIZE], hma1[HASHSIZE];
+    uint8_t u[bbytes], S0[bbytes], S1[bbytes];
+    uint8_t msg0[HASHSIZE], msg1[HASHSIZE], msgb[HASHSIZE];
+    int b;
+
+    alice.msg1(p0, r_sid, hS0, hS1, sid, m);
+    bob.msg1(pS, signal0, signal1, u, hma0, hma1, sid, hS0, hS1, p0, r_sid, m);
+
+    if (!alice.msg2(msgb, b, S0, S1, sid, pS, signal0, signal1, hma0, hma1, u) ||
+	!bob.msg2(msg0, msg1, sid, S0, S1))
+      return false;
+
+    return memcmp(msgb, (b == 0) ? msg0 : msg1, HASHSIZE) == 0;
+  }
+};
+
+/** Runs one [BDGM19] OT session, both parties in-process, on a worker
+
+    @tparam P NFL Polynomial type
+    @tparam rbytes Size of random value r
+    @tparam bbytes Size of random masks
+*/
+template<typename P, size_t rbytes, size_t bbytes>
+struct ot_session_t
+{
+  /** Seed of the common polynomial */
+  uint8_t seed[COMMON_POLY_SEEDBYTES];
+
+  /** Constructor of the session
+
+      @param _seed Seed of the common polynomial */
+  ot_session_t(const uint8_t _seed[COMMON_POLY_SEEDBYTES])
+  {
+    memcpy(seed, _seed, sizeof(seed));
+  }
+
+  /** Runs the session
+
+      @param w Worker running the session
+      @param sid Session ID
+      @return True when the receiver gets the message of its choice */
+  bool operator()(rot_worker_t<P> &w, uint32_t sid) const
+  {
+    typedef typename sym_enc_t<rbytes, rbytes, bbytes>::cipher_t cipher_t;
+    alice_ot_t<P, rbytes, bbytes> alice(w.g_prng.get(), &w.ctx);
+    bob_ot_t<P, rbytes, bbytes> bob(w.g_prng.get(), &w.ctx);
+    const P &m = w.cache.get(seed);
+    P p0, pS;
+    typename ke_t<P>::signal_t signal0, signal1;
+    uint8_t r_sid[sizeof(uint32_t) + rbytes];
+    uint8_t u0[2*rbytes + bbytes], u1[2*rbytes + bbytes], ch[rbytes];
+    uint8_t msg0[rbytes], msg1[rbytes], msgb[rbytes];
+    cipher_t a0, a1, c0, c1;
+    int b = sid & 1;
+
+    nfl::fastrandombytes(w.ctx, msg0, rbytes);
+    nfl::fastrandombytes(w.ctx, msg1, rbytes);
+
+    alice.msg1(p0, r_sid, b, sid, m);
+    bob.msg1(pS, signal0, signal1, u0, u1, a0, a1, sid, p0, r_sid, m);
+
+    if (!alice.msg2(ch, sid, pS, signal0, signal1, a0, a1, u0, u1) ||
+	!bob.msg2(c0, c1, ch, msg0, msg1))
+      return false;
+
+    alice.msg3(msgb, c0, c1);
+    return memcmp(msgb, (b == 0) ? msg0 : msg1, rbytes) == 0;
+  }
+};
+
+#endif
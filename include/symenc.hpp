@@ -4,26 +4,115 @@
 #ifndef __SYMENC_HPP__
 #define __SYMENC_HPP__
 #include "macros.hpp"
-#include <openssl/aes.h>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <openssl/evp.h>
+#include "blake3.h"
+#if defined(__AES__)
+#include <wmmintrin.h>
+#endif
 
-/** Symmetric-key encryption engine
+/** Frees an OpenSSL cipher context */
+struct evp_cipher_ctx_deleter_t
+{
+  void operator()(EVP_CIPHER_CTX *ctx) const
+  {
+    EVP_CIPHER_CTX_free(ctx);
+  }
+};
+
+/** Owned OpenSSL cipher context */
+using evp_cipher_ctx_ptr_t = std::unique_ptr<EVP_CIPHER_CTX, evp_cipher_ctx_deleter_t>;
+
+#if defined(__AES__)
+/** Next AES-128 round key from the previous one
+
+    @param k Previous round key
+    @param g Output of aeskeygenassist on k
+    @return Next round key */
+inline __m128i aes128_key_step(__m128i k, __m128i g)
+{
+  g = _mm_shuffle_epi32(g, 0xff);
+  k = _mm_xor_si128(k, _mm_slli_si128(k, 4));
+  k = _mm_xor_si128(k, _mm_slli_si128(k, 4));
+  k = _mm_xor_si128(k, _mm_slli_si128(k, 4));
+  return _mm_xor_si128(k, g);
+}
+
+/** Computes round key i of n AES-128 schedules, interleaved
+
+    @param rk Schedules, round keys 0 to i - 1 being set
+    @param n Number of schedules
+    @param i Round
+    @tparam rcon Round constant of round i */
+template<int rcon>
+inline void aes128_key_round(__m128i (*rk)[11], size_t n, size_t i)
+{
+  for (size_t j = 0; j < n; j++)
+    rk[j][i] = aes128_key_step(rk[j][i - 1], _mm_aeskeygenassist_si128(rk[j][i - 1], rcon));
+}
+
+/** Expands n independent AES-128 keys, interleaved
+
+    @param rk Outputted encryption schedules
+    @param key Inputted keys
+    @param n Number of keys */
+inline void aes128_expand_many(__m128i (*rk)[11], const uint8_t *const *key, size_t n)
+{
+  for (size_t j = 0; j < n; j++)
+    rk[j][0] = _mm_loadu_si128((const __m128i *)key[j]);
+
+  aes128_key_round<0x01>(rk, n, 1);
+  aes128_key_round<0x02>(rk, n, 2);
+  aes128_key_round<0x04>(rk, n, 3);
+  aes128_key_round<0x08>(rk, n, 4);
+  aes128_key_round<0x10>(rk, n, 5);
+  aes128_key_round<0x20>(rk, n, 6);
+  aes128_key_round<0x40>(rk, n, 7);
+  aes128_key_round<0x80>(rk, n, 8);
+  aes128_key_round<0x1b>(rk, n, 9);
+  aes128_key_round<0x36>(rk, n, 10);
+}
+#endif
+
+/** AES-CBC cipher policy of sym_enc_t
+
+    With AES-NI and 16-byte keys, messages are encrypted with AES-NI
+    directly, and the _many variants compute the schedules and blocks of
+    independent messages under independent keys interleaved, such as the
+    two ciphertexts of an OT message or those of several sessions.
+    Otherwise messages go one by one through an OpenSSL EVP context per
+    direction, keyed again by every call: the key schedules are not
+    cached across calls.
 
     @tparam pbytes Size of plaintext
     @tparam rbytes Size of random bytes
     @tparam bbytes Size of key
 */
 template<size_t pbytes, size_t rbytes, size_t bbytes>
-struct sym_enc_t
+struct aes_cbc_t
 {
+  static_assert(bbytes == 16 || bbytes == 24 || bbytes == 32, "AES keys are 16, 24 or 32 bytes");
+
   /** Size of IV */
   static constexpr size_t ivbytes = 16;
   /** Effective bytes used by IV */
   static constexpr size_t ivlength = MIN(ivbytes, rbytes);
   /** Size of ciphertext for concatention of plaintext and random bytes */
   static constexpr size_t outbytes = AES_OUTPUT_LENGTH(pbytes);
+  /** Number of AES blocks of a ciphertext */
+  static constexpr size_t nblocks = outbytes / AES_BLOCK_SIZE;
+  /** Number of messages interleaved by the _many variants */
+  static constexpr size_t LANES = 8;
   /** Used to encode/decode plaintext and random bytes */
   uint8_t plain1[outbytes];
 
+  /** EVP contexts, keyed again by every call */
+  evp_cipher_ctx_ptr_t enc_ctx, dec_ctx;
+
   /** Symmetric-key ciphertext type */
   struct cipher_t
   {
@@ -33,6 +122,35 @@ struct sym_enc_t
     uint8_t iv[ivbytes];
   };
 
+  /** @return AES-CBC cipher for bbytes keys */
+  static const EVP_CIPHER *cipher()
+  {
+    return (bbytes == 16) ? EVP_aes_128_cbc() : (bbytes == 24) ? EVP_aes_192_cbc() : EVP_aes_256_cbc();
+  }
+
+  /** Allocates the EVP contexts */
+  aes_cbc_t()
+    : enc_ctx(EVP_CIPHER_CTX_new()), dec_ctx(EVP_CIPHER_CTX_new())
+  {
+    if (!enc_ctx || !dec_ctx ||
+	EVP_EncryptInit_ex(enc_ctx.get(), cipher(), nullptr, nullptr, nullptr) != 1 ||
+	EVP_DecryptInit_ex(dec_ctx.get(), cipher(), nullptr, nullptr, nullptr) != 1)
+      throw std::runtime_error("aes_cbc_t: cannot initialise AES-CBC");
+
+    EVP_CIPHER_CTX_set_padding(enc_ctx.get(), 0);
+    EVP_CIPHER_CTX_set_padding(dec_ctx.get(), 0);
+  }
+
+  /** Builds the IV of a ciphertext from the random bytes
+
+      @param iv Outputted IV
+      @param r Inputted random value */
+  static void make_iv(uint8_t iv[ivbytes], const uint8_t r[rbytes])
+  {
+    memset(&iv[ivlength], 0, ivbytes - ivlength);
+    memcpy(&iv[0], &r[0], ivlength);
+  }
+
   /** Encrypts (in || r) using (key, out.IV) with AES-CBC
 
       @param out Outputted ciphertext
@@ -44,15 +162,8 @@ struct sym_enc_t
 	    const uint8_t r[rbytes],
 	    const uint8_t key[bbytes])
   {
-    memset(&plain1[pbytes], 0, outbytes - pbytes);
-    memcpy(&plain1[0], &in[0], pbytes);
-    uint8_t tmp_iv[ivbytes];
-    memset(&tmp_iv[ivlength], 0, ivbytes - ivlength);
-    memcpy(&tmp_iv[0], &r[0], ivlength);
-    memcpy(&out.iv[0], &tmp_iv[0], ivbytes);
-    AES_KEY openssl_key;
-    AES_set_encrypt_key(key, bbytes * 8, &openssl_key);
-    AES_cbc_encrypt(plain1, out.buf, outbytes, &openssl_key, (unsigned char *)&tmp_iv[0], AES_ENCRYPT);
+    cipher_t *pout = &out;
+    SEnc_lanes(&pout, &in, &r, &key, 1, std::integral_constant<bool, aesni()>());
   }
 
   /** Decrypts in using key with AES-CBC
@@ -64,13 +175,337 @@ struct sym_enc_t
 	    const cipher_t &in,
 	    const uint8_t key[bbytes])
   {
-    AES_KEY openssl_key;
-    AES_set_decrypt_key(key, bbytes * 8, &openssl_key);
-    uint8_t tmp_iv[ivbytes];
-    memcpy(&tmp_iv[0], &in.iv[0], ivbytes);
-    AES_cbc_encrypt(in.buf, plain1, outbytes, &openssl_key, (unsigned char *)&tmp_iv[0], AES_DECRYPT);
+    const cipher_t *pin = &in;
+    SDec_lanes(&out, &pin, &key, 1, std::integral_constant<bool, aesni()>());
+  }
+
+  /**@{*/
+  /** SEnc and SDec through the EVP contexts, throwing std::runtime_error
+      when OpenSSL fails */
+  void SEnc_evp(cipher_t &out,
+		const uint8_t in[pbytes],
+		const uint8_t r[rbytes],
+		const uint8_t key[bbytes])
+  {
+    memset(&plain1[pbytes], 0, outbytes - pbytes);
+    memcpy(&plain1[0], &in[0], pbytes);
+    make_iv(out.iv, r);
+
+    // Keying the context costs as much as the CBC pass on these short
+    // messages. Caching the schedule of the last key is left out on
+    // purpose: it keeps a copy of the key, to be compared in constant time
+    // and wiped
+    int len;
+    if (EVP_EncryptInit_ex(enc_ctx.get(), nullptr, nullptr, key, out.iv) != 1 ||
+	EVP_EncryptUpdate(enc_ctx.get(), out.buf, &len, plain1, outbytes) != 1)
+      throw std::runtime_error("aes_cbc_t: AES-CBC encryption failed");
+  }
+
+  void SDec_evp(uint8_t out[pbytes],
+		const cipher_t &in,
+		const uint8_t key[bbytes])
+  {
+    int len;
+    if (EVP_DecryptInit_ex(dec_ctx.get(), nullptr, nullptr, key, in.iv) != 1 ||
+	EVP_DecryptUpdate(dec_ctx.get(), plain1, &len, in.buf, outbytes) != 1)
+      throw std::runtime_error("aes_cbc_t: AES-CBC decryption failed");
     memcpy(out, plain1, pbytes);
   }
+  /**@}*/
+
+  /** Encrypts n independent messages, (in[i] || r[i]) using
+      (key[i], out[i]->IV) with AES-CBC
+
+      @param out Outputted ciphertexts
+      @param in Inputted plaintexts
+      @param r Inputted random values
+      @param key Inputted keys
+      @param n Number of messages */
+  void SEnc_many(cipher_t *const *out,
+		 const uint8_t *const *in,
+		 const uint8_t *const *r,
+		 const uint8_t *const *key,
+		 size_t n)
+  {
+    for (size_t i = 0; i < n; i += LANES)
+      {
+	size_t m = (n - i < LANES) ? n - i : LANES;
+	SEnc_lanes(&out[i], &in[i], &r[i], &key[i], m, std::integral_constant<bool, aesni()>());
+      }
+  }
+
+  /** Decrypts n independent ciphertexts in[i] using key[i] with AES-CBC
+
+      @param out Outputted plaintexts
+      @param in Inputted ciphertexts
+      @param key Inputted keys
+      @param n Number of ciphertexts */
+  void SDec_many(uint8_t *const *out,
+		 const cipher_t *const *in,
+		 const uint8_t *const *key,
+		 size_t n)
+  {
+    for (size_t i = 0; i < n; i += LANES)
+      {
+	size_t m = (n - i < LANES) ? n - i : LANES;
+	SDec_lanes(&out[i], &in[i], &key[i], m, std::integral_constant<bool, aesni()>());
+      }
+  }
+
+  /** @return Whether the _many variants use the interleaved AES-NI code */
+  static constexpr bool aesni()
+  {
+#if defined(__AES__)
+    return bbytes == 16;
+#else
+    return false;
+#endif
+  }
+
+  /**@{*/
+  /** Up to LANES messages through the EVP contexts */
+  void SEnc_lanes(cipher_t *const *out, const uint8_t *const *in, const uint8_t *const *r,
+		  const uint8_t *const *key, size_t n, std::false_type)
+  {
+    for (size_t j = 0; j < n; j++)
+      SEnc_evp(*out[j], in[j], r[j], key[j]);
+  }
+
+  void SDec_lanes(uint8_t *const *out, const cipher_t *const *in,
+		  const uint8_t *const *key, size_t n, std::false_type)
+  {
+    for (size_t j = 0; j < n; j++)
+      SDec_evp(out[j], *in[j], key[j]);
+  }
+  /**@}*/
+
+#if defined(__AES__)
+  /**@{*/
+  /** Up to LANES messages with AES-NI, the lanes advancing one AES round
+      at a time */
+  void SEnc_lanes(cipher_t *const *out, const uint8_t *const *in, const uint8_t *const *r,
+		  const uint8_t *const *key, size_t n, std::true_type)
+  {
+    __m128i rk[LANES][11], x[LANES];
+    aes128_expand_many(rk, key, n);
+
+    for (size_t j = 0; j < n; j++)
+      {
+	make_iv(out[j]->iv, r[j]);
+	x[j] = _mm_loadu_si128((const __m128i *)out[j]->iv);
+      }
+
+    for (size_t b = 0; b < nblocks; b++)
+      {
+	for (size_t j = 0; j < n; j++)
+	  {
+	    uint8_t block[AES_BLOCK_SIZE] = {0};
+	    size_t off = b * AES_BLOCK_SIZE;
+	    memcpy(block, &in[j][off], std::min((size_t)AES_BLOCK_SIZE, pbytes - off));
+	    x[j] = _mm_xor_si128(x[j], _mm_xor_si128(_mm_loadu_si128((const __m128i *)block), rk[j][0]));
+	  }
+	for (size_t round = 1; round < 10; round++)
+	  for (size_t j = 0; j < n; j++)
+	    x[j] = _mm_aesenc_si128(x[j], rk[j][round]);
+	for (size_t j = 0; j < n; j++)
+	  {
+	    x[j] = _mm_aesenclast_si128(x[j], rk[j][10]);
+	    _mm_storeu_si128((__m128i *)&out[j]->buf[b * AES_BLOCK_SIZE], x[j]);
+	  }
+      }
+  }
+
+  void SDec_lanes(uint8_t *const *out, const cipher_t *const *in,
+		  const uint8_t *const *key, size_t n, std::true_type)
+  {
+    __m128i rk[LANES][11], prev[LANES], x[LANES];
+    aes128_expand_many(rk, key, n);
+
+    // Equivalent inverse cipher: round keys 1 to 9 go through InvMixColumns
+    for (size_t j = 0; j < n; j++)
+      {
+	for (size_t round = 1; round < 10; round++)
+	  rk[j][round] = _mm_aesimc_si128(rk[j][round]);
+	prev[j] = _mm_loadu_si128((const __m128i *)in[j]->iv);
+      }
+
+    for (size_t b = 0; b < nblocks; b++)
+      {
+	__m128i c[LANES];
+	for (size_t j = 0; j < n; j++)
+	  {
+	    c[j] = _mm_loadu_si128((const __m128i *)&in[j]->buf[b * AES_BLOCK_SIZE]);
+	    x[j] = _mm_xor_si128(c[j], rk[j][10]);
+	  }
+	for (size_t round = 9; round > 0; round--)
+	  for (size_t j = 0; j < n; j++)
+	    x[j] = _mm_aesdec_si128(x[j], rk[j][round]);
+	for (size_t j = 0; j < n; j++)
+	  {
+	    uint8_t block[AES_BLOCK_SIZE];
+	    size_t off = b * AES_BLOCK_SIZE;
+	    x[j] = _mm_xor_si128(_mm_aesdeclast_si128(x[j], rk[j][0]), prev[j]);
+	    prev[j] = c[j];
+	    _mm_storeu_si128((__m128i *)block, x[j]);
+	    memcpy(&out[j][off], block, std::min((size_t)AES_BLOCK_SIZE, pbytes - off));
+	  }
+      }
+  }
+  /**@}*/
+#endif
+};
+
+
+/** BLAKE3 stream cipher policy of sym_enc_t, for hosts without AES
+    instructions: constant time, and ciphertexts are as long as plaintexts.
+
+    The keystream is the XOF output of Blake3 keyed with a fixed domain key
+    over (key || r), r being the IV. Absorbing the secret key rather than
+    using it as Blake3 key works for any bbytes, and keeps messages of up to
+    64 bytes with 16-byte keys and IVs to a single compression.
+
+    @tparam pbytes Size of plaintext
+    @tparam rbytes Size of random bytes
+    @tparam bbytes Size of key
+*/
+template<size_t pbytes, size_t rbytes, size_t bbytes>
+struct blake3_stream_t
+{
+  /** Size of IV */
+  static constexpr size_t ivbytes = rbytes;
+  /** Size of ciphertext */
+  static constexpr size_t outbytes = pbytes;
+
+  /** Symmetric-key ciphertext type */
+  struct cipher_t
+  {
+    /** Ciphertext */
+    uint8_t buf[outbytes];
+    /** IV */
+    uint8_t iv[ivbytes];
+  };
+
+  /** @return Blake3 key separating the keystream from other Blake3 uses */
+  static const uint8_t *domain_key()
+  {
+    struct domain_key_t
+    {
+      uint8_t key[BLAKE3_KEY_LEN];
+
+      domain_key_t()
+      {
+	const char context[] = "ROTed blake3_stream_t keystream v1";
+	blake3_hasher hasher;
+	blake3_hasher_init(&hasher);
+	blake3_hasher_update(&hasher, context, sizeof(context) - 1);
+	blake3_hasher_finalize(&hasher, key, sizeof(key));
+      }
+    };
+    static const domain_key_t domain;
+    return domain.key;
+  }
+
+  /** XORs the keystream of (key, iv) with in
+
+      @param out Outputted bytes
+      @param in Inputted bytes
+      @param iv IV
+      @param key Key */
+  static void apply(uint8_t out[pbytes], const uint8_t in[pbytes],
+		    const uint8_t iv[ivbytes], const uint8_t key[bbytes])
+  {
+    uint8_t stream[pbytes];
+    blake3_hasher hasher;
+    blake3_hasher_init_keyed(&hasher, domain_key());
+    blake3_hasher_update(&hasher, key, bbytes);
+    blake3_hasher_update(&hasher, iv, ivbytes);
+    blake3_hasher_finalize(&hasher, stream, pbytes);
+
+    for (size_t i = 0; i < pbytes; i++)
+      out[i] = in[i] ^ stream[i];
+  }
+
+  /** Encrypts in using (key, r)
+
+      @param out Outputted ciphertext
+      @param in Inputted plaintext
+      @param r Inputted random value, used as IV
+      @param key Inputted key */
+  void SEnc(cipher_t &out,
+	    const uint8_t in[pbytes],
+	    const uint8_t r[rbytes],
+	    const uint8_t key[bbytes])
+  {
+    memcpy(out.iv, r, ivbytes);
+    apply(out.buf, in, out.iv, key);
+  }
+
+  /** Decrypts in using key
+
+      @param out Outputted plaintext
+      @param in Inputted ciphertext
+      @param key Inputted key */
+  void SDec(uint8_t out[pbytes],
+	    const cipher_t &in,
+	    const uint8_t key[bbytes])
+  {
+    apply(out, in.buf, in.iv, key);
+  }
+
+  /** Encrypts n independent messages, in[i] using (key[i], r[i])
+
+      @param out Outputted ciphertexts
+      @param in Inputted plaintexts
+      @param r Inputted random values
+      @param key Inputted keys
+      @param n Number of messages */
+  void SEnc_many(cipher_t *const *out,
+		 const uint8_t *const *in,
+		 const uint8_t *const *r,
+		 const uint8_t *const *key,
+		 size_t n)
+  {
+    for (size_t i = 0; i < n; i++)
+      SEnc(*out[i], in[i], r[i], key[i]);
+  }
+
+  /** Decrypts n independent ciphertexts in[i] using key[i]
+
+      @param out Outputted plaintexts
+      @param in Inputted ciphertexts
+      @param key Inputted keys
+      @param n Number of ciphertexts */
+  void SDec_many(uint8_t *const *out,
+		 const cipher_t *const *in,
+		 const uint8_t *const *key,
+		 size_t n)
+  {
+    for (size_t i = 0; i < n; i++)
+      SDec(out[i], *in[i], key[i]);
+  }
 };
 
+#if defined(SYM_ENC_BLAKE3)
+/** Cipher policy of sym_enc_t when none is given */
+template<size_t pbytes, size_t rbytes, size_t bbytes>
+using sym_enc_default_t = blake3_stream_t<pbytes, rbytes, bbytes>;
+#else
+/** Cipher policy of sym_enc_t when none is given */
+template<size_t pbytes, size_t rbytes, size_t bbytes>
+using sym_enc_default_t = aes_cbc_t<pbytes, rbytes, bbytes>;
+#endif
+
+/** Symmetric-key encryption engine
+
+    Cipher policies provide cipher_t, SEnc, SDec, SEnc_many and SDec_many.
+
+    @tparam pbytes Size of plaintext
+    @tparam rbytes Size of random bytes
+    @tparam bbytes Size of key
+    @tparam cipher_policy_t Cipher policy, aes_cbc_t or blake3_stream_t
+*/
+template<size_t pbytes, size_t rbytes, size_t bbytes,
+	 template<size_t, size_t, size_t> class cipher_policy_t = sym_enc_default_t>
+using sym_enc_t = cipher_policy_t<pbytes, rbytes, bbytes>;
+
 #endif
@@ -0,0 +1,543 @@
+/**
+@file
+
+Binary wire format of the messages in comm.hpp and comm_rot.hpp.
+
+Every message is an 8-byte header followed by its payload:
+
+    offset 0  version      (WIRE_VERSION)
+    offset 1  type         (wire_type_t)
+    offset 2  reserved     (2 bytes, zero)
+    offset 4  payload size (32-bit little endian)
+    offset 8  payload
+
+The payload is the concatenation of the message fields in declaration
+order, without padding, so every field sits at a fixed offset. Session IDs
+are 32-bit little endian, all other fields are byte strings (packed
+polynomials, packed signals, hashes, ciphertexts) stored as is. Because of
+this, received buffers can be read in place through wire_view_t and
+messages can be sent with scatter/gather I/O straight from their structs.
+*/
+#ifndef __WIRE_HPP__
+#define __WIRE_HPP__
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+#include <sys/uio.h>
+#include "comm.hpp"
+#include "comm_rot.hpp"
+
+/** Version of the wire format */
+#define WIRE_VERSION 1
+/** Size of the wire header */
+#define WIRE_HEADER_BYTES 8
+
+/** Message types */
+enum wire_type_t : uint8_t
+  {
+    WIRE_OT_MSG_1 = 0x01,
+    WIRE_OT_MSG_2 = 0x02,
+    WIRE_OT_MSG_3 = 0x03,
+    WIRE_OT_MSG_4 = 0x04,
+    WIRE_ROT_MSG_1 = 0x11,
+    WIRE_ROT_MSG_2 = 0x12,
+    WIRE_ROT_MSG_3 = 0x13
+  };
+
+/** Writable byte range (std::span<uint8_t> in C++20) */
+struct byte_span_t
+{
+  /** First byte */
+  uint8_t *data;
+  /** Number of bytes */
+  size_t size;
+
+  /** Constructor of the span
+
+      @param _data First byte
+      @param _size Number of bytes */
+  byte_span_t(uint8_t *_data, size_t _size)
+    : data(_data), size(_size)
+  {
+  }
+};
+
+/** Fixed offsets of a list of fields laid out without padding
+
+    @tparam Fields Field types
+*/
+template<typename... Fields>
+struct wire_layout_t;
+
+template<>
+struct wire_layout_t<>
+{
+  /** Total size */
+  static constexpr size_t bytes = 0;
+
+  /** Offset of a field
+
+      @param i Field index
+      @return Offset of field i */
+  static constexpr size_t offset(size_t /* i */)
+  {
+    return 0;
+  }
+};
+
+template<typename Field, typename... Fields>
+struct wire_layout_t<Field, Fields...>
+{
+  /** Total size */
+  static constexpr size_t bytes = sizeof(Field) + wire_layout_t<Fields...>::bytes;
+
+  /** Offset of a field
+
+      @param i Field index
+      @return Offset of field i */
+  static constexpr size_t offset(size_t i)
+  {
+    return i == 0 ? 0 : sizeof(Field) + wire_layout_t<Fields...>::offset(i - 1);
+  }
+};
+
+/** Describes the wire encoding of a message. Specialisations provide
+    - type: wire_type_t of the message
+    - fields_t: std::tuple of the field types in wire order
+    - visit(v, m): calls v on each field of m in wire order
+
+    @tparam M Message type
+*/
+template<typename M>
+struct wire_traits_t;
+
+/** Wire layout of a message type
+
+    @tparam Tuple std::tuple of the field types
+*/
+template<typename Tuple>
+struct wire_tuple_layout_t;
+
+template<typename... Fields>
+struct wire_tuple_layout_t<std::tuple<Fields...>>
+{
+  /** Layout of the fields */
+  using type = wire_layout_t<Fields...>;
+};
+
+/** Size of the payload of a message
+
+    @tparam M Message type
+*/
+template<typename M>
+struct wire_payload_bytes
+{
+  /** Payload size */
+  static constexpr size_t value = wire_tuple_layout_t<typename wire_traits_t<M>::fields_t>::type::bytes;
+};
+
+/** Size of an encoded message, header included
+
+    @tparam M Message type
+*/
+template<typename M>
+struct wire_bytes
+{
+  /** Encoded size */
+  static constexpr size_t value = WIRE_HEADER_BYTES + wire_payload_bytes<M>::value;
+};
+
+/** Stores a 32-bit integer in little endian
+
+    @param out Outputted 4 bytes
+    @param x Integer */
+inline void wire_store_u32(uint8_t out[4], uint32_t x)
+{
+  out[0] = (uint8_t)x;
+  out[1] = (uint8_t)(x >> 8);
+  out[2] = (uint8_t)(x >> 16);
+  out[3] = (uint8_t)(x >> 24);
+}
+
+/** Loads a 32-bit little endian integer
+
+    @param in 4 bytes
+    @return Integer */
+inline uint32_t wire_load_u32(const uint8_t in[4])
+{
+  return (uint32_t)in[0] | ((uint32_t)in[1] << 8) |
+    ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+/** Writes the wire header of a message
+
+    @tparam M Message type
+    @param out Outputted WIRE_HEADER_BYTES bytes */
+template<typename M>
+void wire_store_header(uint8_t out[WIRE_HEADER_BYTES])
+{
+  out[0] = WIRE_VERSION;
+  out[1] = wire_traits_t<M>::type;
+  out[2] = out[3] = 0;
+  wire_store_u32(&out[4], wire_payload_bytes<M>::value);
+}
+
+/** Size of a whole message from its header, to frame a byte stream
+
+    @param header WIRE_HEADER_BYTES received bytes
+    @return Size of the message, header included, or 0 for an unsupported version */
+inline size_t wire_message_bytes(const uint8_t header[WIRE_HEADER_BYTES])
+{
+  if (header[0] != WIRE_VERSION)
+    return 0;
+  return WIRE_HEADER_BYTES + (size_t)wire_load_u32(&header[4]);
+}
+
+/** Checks that a buffer holds a complete message of type M
+
+    @tparam M Message type
+    @param in Received bytes
+    @param len Number of received bytes
+    @return True when version, type and lengths match */
+template<typename M>
+bool wire_check(const uint8_t *in, size_t len)
+{
+  return len >= wire_bytes<M>::value &&
+    in[0] == WIRE_VERSION && in[1] == wire_traits_t<M>::type &&
+    wire_load_u32(&in[4]) == wire_payload_bytes<M>::value;
+}
+
+/** Visitor writing fields to a contiguous buffer */
+struct wire_writer_t
+{
+  /** Next byte to be written */
+  uint8_t *out;
+
+  void operator()(const uint32_t &x)
+  {
+    wire_store_u32(out, x);
+    out += sizeof(x);
+  }
+
+  template<typename F>
+  void operator()(const F &f)
+  {
+    memcpy(out, &f, sizeof(F));
+    out += sizeof(F);
+  }
+};
+
+/** Visitor reading fields from a contiguous buffer */
+struct wire_reader_t
+{
+  /** Next byte to be read */
+  const uint8_t *in;
+
+  void operator()(uint32_t &x)
+  {
+    x = wire_load_u32(in);
+    in += sizeof(x);
+  }
+
+  template<typename F>
+  void operator()(F &f)
+  {
+    memcpy(&f, in, sizeof(F));
+    in += sizeof(F);
+  }
+};
+
+/** Visitor pointing iovecs at the fields, merging adjacent ones */
+struct wire_iov_writer_t
+{
+  /** iovecs */
+  struct iovec *iov;
+  /** Number of used iovecs */
+  size_t n;
+  /** Storage for the encoded session IDs */
+  uint8_t *scratch;
+
+  void push(const void *p, size_t len)
+  {
+    if (n > 0 && (const uint8_t *)iov[n - 1].iov_base + iov[n - 1].iov_len == p)
+      {
+	iov[n - 1].iov_len += len;
+	return;
+      }
+    iov[n].iov_base = const_cast<void *>(p);
+    iov[n].iov_len = len;
+    n++;
+  }
+
+  void operator()(const uint32_t &x)
+  {
+    wire_store_u32(scratch, x);
+    push(scratch, sizeof(x));
+    scratch += sizeof(x);
+  }
+
+  template<typename F>
+  void operator()(const F &f)
+  {
+    push(&f, sizeof(F));
+  }
+};
+
+/** Encodes a message
+
+    @tparam M Message type
+    @param out Output buffer
+    @param m Message
+    @return Number of written bytes, or 0 when out is too small */
+template<typename M>
+size_t encode_into(byte_span_t out, const M &m)
+{
+  if (out.size < wire_bytes<M>::value)
+    return 0;
+
+  wire_store_header<M>(out.data);
+  wire_writer_t w = {out.data + WIRE_HEADER_BYTES};
+  wire_traits_t<M>::visit(w, m);
+
+  return wire_bytes<M>::value;
+}
+
+/** Maximum number of iovecs used by encode_iov for a message
+
+    @tparam M Message type
+*/
+template<typename M>
+struct wire_iov_count
+{
+  /** Header plus one iovec per field */
+  static constexpr size_t value = 1 + std::tuple_size<typename wire_traits_t<M>::fields_t>::value;
+};
+
+/** Size of the scratch space needed by encode_iov */
+#define WIRE_IOV_SCRATCH_BYTES (WIRE_HEADER_BYTES + sizeof(uint32_t))
+
+/** Describes an encoded message as iovecs for writev/sendmsg, without
+    copying the message. Byte fields are referenced in place, so m must
+    outlive the I/O; the header and session ID are written to scratch.
+
+    @tparam M Message type
+    @param iov Outputted iovecs, at least wire_iov_count<M>::value
+    @param scratch WIRE_IOV_SCRATCH_BYTES bytes, must outlive the I/O
+    @param m Message
+    @return Number of used iovecs */
+template<typename M>
+size_t encode_iov(struct iovec *iov, uint8_t scratch[WIRE_IOV_SCRATCH_BYTES], const M &m)
+{
+  wire_store_header<M>(scratch);
+  iov[0].iov_base = scratch;
+  iov[0].iov_len = WIRE_HEADER_BYTES;
+
+  wire_iov_writer_t w = {iov, 1, scratch + WIRE_HEADER_BYTES};
+  wire_traits_t<M>::visit(w, m);
+
+  return w.n;
+}
+
+/** Decodes a message into its struct
+
+    @tparam M Message type
+    @param m Outputted message
+    @param in Received bytes
+    @param len Number of received bytes
+    @return False when the buffer does not hold a message of type M */
+template<typename M>
+bool wire_decode(M &m, const uint8_t *in, size_t len)
+{
+  if (!wire_check<M>(in, len))
+    return false;
+
+  wire_reader_t r = {in + WIRE_HEADER_BYTES};
+  wire_traits_t<M>::visit(r, m);
+  return true;
+}
+
+/** Read-only view of a received message, reading its fields in place
+
+    @tparam M Message type
+*/
+template<typename M>
+struct wire_view_t
+{
+  /** Field types */
+  using fields_t = typename wire_traits_t<M>::fields_t;
+  /** Field layout */
+  using layout_t = typename wire_tuple_layout_t<fields_t>::type;
+  /** Type of field I */
+  template<size_t I>
+  using field_t = typename std::tuple_element<I, fields_t>::type;
+
+  /** Payload of the viewed message */
+  const uint8_t *payload;
+
+  /** Constructor of an empty view */
+  wire_view_t()
+    : payload(nullptr)
+  {
+  }
+
+  /** Points the view at a received buffer
+
+      @param in Received bytes
+      @param len Number of received bytes
+      @return False when the buffer does not hold a message of type M */
+  bool parse(const uint8_t *in, size_t len)
+  {
+    payload = wire_check<M>(in, len) ? in + WIRE_HEADER_BYTES : nullptr;
+    return payload != nullptr;
+  }
+
+  /** Reads a byte field in place
+
+      @tparam I Field index, see wire_traits_t<M>
+      @return Reference into the received buffer */
+  template<size_t I>
+  const field_t<I> &get() const
+  {
+    static_assert(std::alignment_of<field_t<I>>::value == 1, "use sid() for integer fields");
+    return *reinterpret_cast<const field_t<I> *>(payload + layout_t::offset(I));
+  }
+
+  /** Reads the session ID
+
+      @return Session ID */
+  uint32_t sid() const
+  {
+    return wire_load_u32(payload + layout_t::offset(wire_traits_t<M>::SID));
+  }
+};
+
+/** Wire encoding of the first [BDGM19] OT message */
+template<typename P, size_t rbytes>
+struct wire_traits_t<comm_msg_1_t<P, rbytes>>
+{
+  using msg_t = comm_msg_1_t<P, rbytes>;
+  static constexpr uint8_t type = WIRE_OT_MSG_1;
+  /** Field indices */
+  enum { SID, P0, R_SID, SEED };
+  using fields_t = std::tuple<uint32_t, packed_poly_t<P>,
+			      uint8_t[sizeof(uint32_t) + rbytes], uint8_t[COMMON_POLY_SEEDBYTES]>;
+
+  template<typename V, typename Msg>
+  static void visit(V &v, Msg &m)
+  {
+    v(m.sid); v(m.p0); v(m.r_sid); v(m.seed);
+  }
+};
+
+/** Wire encoding of the second [BDGM19] OT message */
+template<typename P, size_t rbytes, size_t bbytes, typename cipher_t>
+struct wire_traits_t<comm_msg_2_t<P, rbytes, bbytes, cipher_t>>
+{
+  using msg_t = comm_msg_2_t<P, rbytes, bbytes, cipher_t>;
+  static constexpr uint8_t type = WIRE_OT_MSG_2;
+  /** Field indices */
+  enum { SID, PS, SIGNAL0, SIGNAL1, A0, A1, U0, U1 };
+  using fields_t = std::tuple<uint32_t, packed_poly_t<P>,
+			      signal_bits_t<P::degree>, signal_bits_t<P::degree>,
+			      cipher_t, cipher_t,
+			      uint8_t[2*rbytes + bbytes], uint8_t[2*rbytes + bbytes]>;
+
+  template<typename V, typename Msg>
+  static void visit(V &v, Msg &m)
+  {
+    v(m.sid); v(m.pS); v(m.signal0); v(m.signal1);
+    v(m.a0); v(m.a1); v(m.u0); v(m.u1);
+  }
+};
+
+/** Wire encoding of the third [BDGM19] OT message */
+template<size_t rbytes>
+struct wire_traits_t<comm_msg_3_t<rbytes>>
+{
+  using msg_t = comm_msg_3_t<rbytes>;
+  static constexpr uint8_t type = WIRE_OT_MSG_3;
+  /** Field indices */
+  enum { CH, SID };
+  using fields_t = std::tuple<uint8_t[rbytes], uint32_t>;
+
+  template<typename V, typename Msg>
+  static void visit(V &v, Msg &m)
+  {
+    v(m.ch); v(m.sid);
+  }
+};
+
+/** Wire encoding of the fourth [BDGM19] OT message */
+template<typename cipher_t>
+struct wire_traits_t<comm_msg_4_t<cipher_t>>
+{
+  using msg_t = comm_msg_4_t<cipher_t>;
+  static constexpr uint8_t type = WIRE_OT_MSG_4;
+  /** Field indices */
+  enum { C0, C1, SID };
+  using fields_t = std::tuple<cipher_t, cipher_t, uint32_t>;
+
+  template<typename V, typename Msg>
+  static void visit(V &v, Msg &m)
+  {
+    v(m.c0); v(m.c1); v(m.sid);
+  }
+};
+
+/** Wire encoding of the first ROT message */
+template<typename P, size_t rbytes, size_t HASHSIZE>
+struct wire_traits_t<comm_rot_msg_1_t<P, rbytes, HASHSIZE>>
+{
+  using msg_t = comm_rot_msg_1_t<P, rbytes, HASHSIZE>;
+  static constexpr uint8_t type = WIRE_ROT_MSG_1;
+  /** Field indices */
+  enum { SID, P0, R_SID, SEED, HS0, HS1 };
+  using fields_t = std::tuple<uint32_t, packed_poly_t<P>,
+			      uint8_t[sizeof(uint32_t) + rbytes], uint8_t[COMMON_POLY_SEEDBYTES],
+			      uint8_t[HASHSIZE], uint8_t[HASHSIZE]>;
+
+  template<typename V, typename Msg>
+  static void visit(V &v, Msg &m)
+  {
+    v(m.sid); v(m.p0); v(m.r_sid); v(m.seed); v(m.hS0); v(m.hS1);
+  }
+};
+
+/** Wire encoding of the second ROT message */
+template<typename P, size_t bbytes, size_t HASHSIZE>
+struct wire_traits_t<comm_rot_msg_2_t<P, bbytes, HASHSIZE>>
+{
+  using msg_t = comm_rot_msg_2_t<P, bbytes, HASHSIZE>;
+  static constexpr uint8_t type = WIRE_ROT_MSG_2;
+  /** Field indices */
+  enum { SID, PS, SIGNAL0, SIGNAL1, U, HMA0, HMA1 };
+  using fields_t = std::tuple<uint32_t, packed_poly_t<P>,
+			      signal_bits_t<P::degree>, signal_bits_t<P::degree>,
+			      uint8_t[bbytes], uint8_t[HASHSIZE], uint8_t[HASHSIZE]>;
+
+  template<typename V, typename Msg>
+  static void visit(V &v, Msg &m)
+  {
+    v(m.sid); v(m.pS); v(m.signal0); v(m.signal1); v(m.u); v(m.hma0); v(m.hma1);
+  }
+};
+
+/** Wire encoding of the third ROT message */
+template<size_t bbytes>
+struct wire_traits_t<comm_rot_msg_3_t<bbytes>>
+{
+  using msg_t = comm_rot_msg_3_t<bbytes>;
+  static constexpr uint8_t type = WIRE_ROT_MSG_3;
+  /** Field indices */
+  enum { S0, S1, SID };
+  using fields_t = std::tuple<uint8_t[bbytes], uint8_t[bbytes], uint32_t>;
+
+  template<typename V, typename Msg>
+  static void visit(V &v, Msg &m)
+  {
+    v(m.S0); v(m.S1); v(m.sid);
+  }
+};
+
+#endif
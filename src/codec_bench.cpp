@@ -0,0 +1,64 @@
+/**
+@file
+
+Throughput benchmark of the compact polynomial codec used in protocol
+messages, against a plain copy of the in-memory polynomial.
+
+Usage: codec_bench [number of polynomials]
+*/
+#include "poly_codec.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#define N 512
+
+int main(int argc, char *argv[])
+{
+  using P = nfl::poly_from_modulus<uint16_t, N, 14>;
+  using codec = poly_codec_t<P>;
+  using poly_vector_t = std::vector<P, nfl::aligned_allocator<P, 64>>;
+  using bench_clock = std::chrono::steady_clock;
+  constexpr size_t npolys = 64;
+
+  size_t total = (argc > 1) ? strtoull(argv[1], nullptr, 10) : (1 << 20);
+  total = (total + npolys - 1) / npolys * npolys;
+
+  nfl::uniform unif;
+  poly_vector_t in(npolys), out(npolys);
+  std::vector<uint8_t> packed(npolys * codec::bytes), raw(npolys * sizeof(P));
+  for (size_t i = 0; i < npolys; i++)
+    in[i] = unif;
+
+  bool success = true;
+  double pack_s = 0, unpack_s = 0, copy_s = 0;
+  for (size_t done = 0; done < total; done += npolys)
+    {
+      auto start = bench_clock::now();
+      for (size_t i = 0; i < npolys; i++)
+        codec::pack(&packed[i * codec::bytes], in[i]);
+      auto mid = bench_clock::now();
+      for (size_t i = 0; i < npolys; i++)
+        success &= codec::unpack(out[i], &packed[i * codec::bytes]);
+      auto end = bench_clock::now();
+      for (size_t i = 0; i < npolys; i++)
+        memcpy(&raw[i * sizeof(P)], &in[i], sizeof(P));
+      auto copy_end = bench_clock::now();
+
+      pack_s += std::chrono::duration<double>(mid - start).count();
+      unpack_s += std::chrono::duration<double>(end - mid).count();
+      copy_s += std::chrono::duration<double>(copy_end - end).count();
+    }
+
+  for (size_t i = 0; i < npolys; i++)
+    success = success && (memcmp(&in[i], &out[i], sizeof(P)) == 0);
+
+  std::cout << "packed size:      " << codec::bytes << " bytes (raw " << sizeof(P) << ")" << std::endl;
+  std::cout << "pack:             " << total / pack_s << " poly/s" << std::endl;
+  std::cout << "unpack:           " << total / unpack_s << " poly/s" << std::endl;
+  std::cout << "raw copy:         " << total / copy_s << " poly/s" << std::endl;
+  std::cout << "correct:          " << (success ? "yes" : "no") << std::endl;
+
+  return success ? 0 : 1;
+}
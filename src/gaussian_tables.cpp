@@ -0,0 +1,86 @@
+/**
+@file
+
+Generator of the lookup tables of the Gaussian sampler, so that processes
+load them (nfl::FastGaussianNoise blob constructor) instead of computing
+them with MPFR at startup. The build runs it with the protocol parameters
+to generate the gaussian_tables.h header used by startup_bench.
+
+Usage: gaussian_tables <output> [sigma] [security] [lookup table depth]
+
+An output ending in .h is written as a header defining the byte array
+gaussian_tables_blob and its size gaussian_tables_size, any other output
+as a raw blob which can be mapped from the file. The defaults are the
+protocol parameters: sigma = sqrt(K/2) with K = 8, 138 bits of security
+and depth 2.
+*/
+#include "nfl.hpp"
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#define N 512
+#define K 8
+
+template<unsigned depth>
+static std::string build_tables(double sigma, unsigned security)
+{
+  using P = nfl::poly_from_modulus<uint16_t, N, 14>;
+  std::ostringstream os;
+  nfl::FastGaussianNoise<uint8_t, P::value_type, depth> g_prng(sigma, security, N);
+  g_prng.save(os);
+  return os.str();
+}
+
+static bool ends_with(const std::string &s, const std::string &suffix)
+{
+  return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc < 2)
+    {
+      std::cerr << "Usage: " << argv[0] << " <output> [sigma] [security] [lookup table depth]" << std::endl;
+      return 1;
+    }
+  const std::string output = argv[1];
+  const double sigma = (argc > 2) ? strtod(argv[2], nullptr) : sqrt((double)K/2.);
+  const unsigned security = (argc > 3) ? strtoul(argv[3], nullptr, 10) : 138;
+  const unsigned depth = (argc > 4) ? strtoul(argv[4], nullptr, 10) : 2;
+
+  if (depth != 1 && depth != 2)
+    {
+      std::cerr << "The lookup table depth must be 1 or 2" << std::endl;
+      return 1;
+    }
+  const std::string blob = (depth == 1) ? build_tables<1>(sigma, security) : build_tables<2>(sigma, security);
+
+  std::ofstream out(output, std::ios::binary);
+  if (ends_with(output, ".h"))
+    {
+      out << "/* Generated by gaussian_tables: sigma = " << std::setprecision(17) << sigma
+	  << ", security = " << security << ", depth = " << depth << " */\n"
+	  << "#ifndef __GAUSSIAN_TABLES_H__\n#define __GAUSSIAN_TABLES_H__\n\n"
+	  << "#include <cstddef>\n\n"
+	  << "alignas(64) static const unsigned char gaussian_tables_blob[] = {";
+      for (size_t i = 0; i < blob.size(); i++)
+	out << ((i % 16) ? " " : "\n  ") << (unsigned)(unsigned char)blob[i] << ",";
+      out << "\n};\n\nstatic const size_t gaussian_tables_size = sizeof(gaussian_tables_blob);\n\n#endif\n";
+    }
+  else
+    out.write(blob.data(), blob.size());
+
+  if (!out)
+    {
+      std::cerr << "Could not write " << output << std::endl;
+      return 1;
+    }
+  std::cout << output << ": " << blob.size() << " bytes of tables" << std::endl;
+
+  return 0;
+}
@@ -32,7 +32,9 @@
  *
  * `include` contains all of the data structures used in order to run the proposed
  * ROTs and OTs. The OT implementation is in rlweot.hpp, and
- * the ROT implementation is in rlwerot.hpp. The random
+ * the ROT implementation is in rlwerot.hpp, with a batched variant running
+ * many ROT sessions per call in rlwerot_batch.hpp. The IKNP OT extension
+ * seeded by the ROT is in otext.hpp. The random
  * oracle implementations are in roms.hpp. All
  * implementations are templated in order to facilitate parameters
  * modifications without sacrificing performance.
@@ -48,12 +50,25 @@
 #include "rlweke.hpp"
 #include "rlweot.hpp"
 #include "rlwerot.hpp"
+#include "rlwerot_batch.hpp"
+#include "otext.hpp"
+#include "common_poly.hpp"
+#include "rot_executor.hpp"
+#include "rlwe_pool.hpp"
+#include "poly_codec.hpp"
+#include "nfl/prng/crypto_stream_chacha20.h"
+#include "nfl/prng/crypto_stream_aes256ctr.h"
+#include <openssl/evp.h>
 #include <cstdlib>
 #include <cstdint>
 #include <algorithm>
 #include "comm.hpp"
 #include "comm_rot.hpp"
+#include "wire.hpp"
 #include <fstream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
 
 #ifndef M_PI
 #define M_PI           3.14159265358979323846
@@ -85,9 +100,12 @@ void comm_test()
   using P = nfl::poly_from_modulus<uint16_t, N, 14>;
   constexpr size_t rbytes = 16;
   constexpr size_t bbytes = 16;
-  nfl::uniform unif;
   typedef typename sym_enc_t<rbytes, rbytes, bbytes>::cipher_t cipher_t;
   nfl::FastGaussianNoise<uint8_t, P::value_type, 2> g_prng(sqrt((double)K/2.), 138, N);
+  common_poly_cache_t<P> alice_cache, bob_cache;
+  uint8_t seed[COMMON_POLY_SEEDBYTES];
+
+  common_poly_cache_t<P>::new_seed(seed);
 
   for (int i = 0; i < numtests; i++)
     {
@@ -95,7 +113,7 @@ void comm_test()
       comm_msg_2_t<P, rbytes, bbytes, cipher_t> msg_2a, msg_2b;
       comm_msg_3_t<rbytes> msg_3a, msg_3b;
       comm_msg_4_t<cipher_t> msg_4a, msg_4b;
-      P m = unif;
+      uint8_t wire[wire_bytes<comm_msg_2_t<P, rbytes, bbytes, cipher_t>>::value];
       alice_ot_t<P, rbytes, bbytes> alice(&g_prng);
       bob_ot_t<P, rbytes, bbytes> bob(&g_prng);
       int b = i & 1;
@@ -108,21 +126,30 @@ void comm_test()
       nfl::fastrandombytes(msg1, rbytes);
 
       bool success = true;
+      P p0, pS;
 
-      alice.msg1(msg_1a.p0, msg_1a.r_sid, b, sid, m);
+      alice.msg1(p0, msg_1a.r_sid, b, sid, alice_cache.get(seed));
+      msg_1a.p0.pack(p0);
       msg_1a.sid = sid;
+      memcpy(msg_1a.seed, seed, sizeof(seed));
 
-      memcpy(&msg_1b, &msg_1a, sizeof(comm_msg_1_t<P, rbytes>));
+      size_t len = encode_into(byte_span_t(wire, sizeof(wire)), msg_1a);
+      success = success && wire_decode(msg_1b, wire, len);
 
-      bob.msg1(msg_2a.pS, msg_2a.signal0, msg_2a.signal1,
+      success = success && msg_1b.p0.unpack(p0);
+      bob.msg1(pS, msg_2a.signal0, msg_2a.signal1,
                msg_2a.u0, msg_2a.u1, msg_2a.a0, msg_2a.a1,
                msg_1b.sid,
-               msg_1b.p0, msg_1b.r_sid, m);
+               p0, msg_1b.r_sid,
+               bob_cache.get(msg_1b.seed));
+      msg_2a.pS.pack(pS);
       msg_2a.sid = msg_1b.sid;
 
-      memcpy(&msg_2b, &msg_2a, sizeof(comm_msg_2_t<P, rbytes, bbytes, cipher_t>));
+      len = encode_into(byte_span_t(wire, sizeof(wire)), msg_2a);
+      success = success && wire_decode(msg_2b, wire, len);
 
-      success = success && alice.msg2(msg_3a.ch, msg_2b.sid, msg_2b.pS,
+      success = success && msg_2b.pS.unpack(pS) &&
+        alice.msg2(msg_3a.ch, msg_2b.sid, pS,
                                       msg_2b.signal0, msg_2b.signal1,
                                       msg_2b.a0, msg_2b.a1,
                                       msg_2b.u0, msg_2b.u1);
@@ -130,14 +157,16 @@ void comm_test()
 
       if (success)
         {
-	  memcpy(&msg_3b, &msg_3a, sizeof(comm_msg_3_t<rbytes>));
+	  len = encode_into(byte_span_t(wire, sizeof(wire)), msg_3a);
+	  success = success && wire_decode(msg_3b, wire, len);
 
           success = success && bob.msg2(msg_4a.c0, msg_4a.c1, msg_3b.ch, msg0, msg1);
           msg_4a.sid = msg_3b.sid;
         }
       if (success)
         {
-	  memcpy(&msg_4b, &msg_4a, sizeof(comm_msg_4_t<cipher_t>));
+	  len = encode_into(byte_span_t(wire, sizeof(wire)), msg_4a);
+	  success = success && wire_decode(msg_4b, wire, len);
 
           alice.msg3(msgb, msg_4b.c0, msg_4b.c1);
         }
@@ -164,9 +193,12 @@ void comm_rotted_test()
   using P = nfl::poly_from_modulus<uint16_t, N, 14>;
   constexpr size_t rbytes = 16;
   constexpr size_t bbytes = 16;
-  nfl::uniform unif;
   typedef typename sym_enc_t<rbytes, rbytes, bbytes>::cipher_t cipher_t;
   nfl::FastGaussianNoise<uint8_t, P::value_type, 2> g_prng(sqrt((double)K/2.), 138, N);
+  common_poly_cache_t<P> alice_cache, bob_cache;
+  uint8_t seed[COMMON_POLY_SEEDBYTES];
+
+  common_poly_cache_t<P>::new_seed(seed);
 
   for (int i = 0; i < numtests; i++)
     {
@@ -193,7 +225,6 @@ void comm_rotted_test()
       comm_msg_2_t<P, rbytes, bbytes, cipher_t> msg_2a, msg_2b;
       comm_msg_3_t<rbytes> msg_3a, msg_3b;
       comm_msg_4_t<cipher_t> msg_4a, msg_4b;
-      P m = unif;
       alice_ot_t<P, rbytes, bbytes> alice(&g_prng);
       bob_ot_t<P, rbytes, bbytes> bob(&g_prng);
       int b = i & 1;
@@ -205,21 +236,28 @@ void comm_rotted_test()
       nfl::fastrandombytes(msg1, rbytes);
 
       bool success = true;
+      P p0, pS;
 
-      alice.msg1(msg_1a.p0, msg_1a.r_sid, b, sid, m);
+      alice.msg1(p0, msg_1a.r_sid, b, sid, alice_cache.get(seed));
+      msg_1a.p0.pack(p0);
       msg_1a.sid = sid;
+      memcpy(msg_1a.seed, seed, sizeof(seed));
 
       memcpy(&msg_1b, &msg_1a, sizeof(comm_msg_1_t<P, rbytes>));
 
-      bob.msg1(msg_2a.pS, msg_2a.signal0, msg_2a.signal1,
+      success = success && msg_1b.p0.unpack(p0);
+      bob.msg1(pS, msg_2a.signal0, msg_2a.signal1,
                msg_2a.u0, msg_2a.u1, msg_2a.a0, msg_2a.a1,
                msg_1b.sid,
-               msg_1b.p0, msg_1b.r_sid, m);
+               p0, msg_1b.r_sid,
+               bob_cache.get(msg_1b.seed));
+      msg_2a.pS.pack(pS);
       msg_2a.sid = msg_1b.sid;
 
       memcpy(&msg_2b, &msg_2a, sizeof(comm_msg_2_t<P, rbytes, bbytes, cipher_t>));
 
-      success = success && alice.msg2(msg_3a.ch, msg_2b.sid, msg_2b.pS,
+      success = success && msg_2b.pS.unpack(pS) &&
+        alice.msg2(msg_3a.ch, msg_2b.sid, pS,
                                       msg_2b.signal0, msg_2b.signal1,
                                       msg_2b.a0, msg_2b.a1,
                                       msg_2b.u0, msg_2b.u1);
@@ -329,48 +367,64 @@ void comm_rot_test()
   constexpr size_t rbytes = 16;
   constexpr size_t bbytes = 16;
   constexpr size_t HASHSIZE = 32;
-  nfl::uniform unif;
   nfl::FastGaussianNoise<uint8_t, P::value_type, 2> g_prng(sqrt((double)K/2.), 138, N);
+  common_poly_cache_t<P> alice_cache, bob_cache;
+  uint8_t seed[COMMON_POLY_SEEDBYTES];
+
+  common_poly_cache_t<P>::new_seed(seed);
 
   for (int i = 0; i < numtests; i++)
     {
-      P m = unif;
       alice_rot_t<P, rbytes, bbytes, HASHSIZE> alice(&g_prng);
       bob_rot_t<P, rbytes, bbytes, HASHSIZE> bob(&g_prng);
       uint32_t sid = i;
       uint8_t msg0[HASHSIZE], msg1[HASHSIZE], msgb[HASHSIZE];
       int b;
 
+      using msg_2_t = comm_rot_msg_2_t<P, bbytes, HASHSIZE>;
+      using msg_2_wire = wire_traits_t<msg_2_t>;
       comm_rot_msg_1_t<P, rbytes, HASHSIZE> msg_1a, msg_1b;
-      comm_rot_msg_2_t<P, bbytes, HASHSIZE> msg_2a, msg_2b;
+      msg_2_t msg_2a;
+      wire_view_t<msg_2_t> msg_2b;
       comm_rot_msg_3_t<bbytes> msg_3a, msg_3b;
+      uint8_t wire[wire_bytes<msg_2_t>::value];
 
       bool success = true;
+      P p0, pS;
 
-      alice.msg1(msg_1a.p0, msg_1a.r_sid, msg_1a.hS0, msg_1a.hS1, sid, m);
+      alice.msg1(p0, msg_1a.r_sid, msg_1a.hS0, msg_1a.hS1, sid, alice_cache.get(seed));
+      msg_1a.p0.pack(p0);
       msg_1a.sid = sid;
+      memcpy(msg_1a.seed, seed, sizeof(seed));
 
-      memcpy(&msg_1b, &msg_1a, sizeof(comm_rot_msg_1_t<P, rbytes, HASHSIZE>));
+      size_t len = encode_into(byte_span_t(wire, sizeof(wire)), msg_1a);
+      success = success && wire_decode(msg_1b, wire, len);
 
-      bob.msg1(msg_2a.pS, msg_2a.signal0, msg_2a.signal1,
+      success = success && msg_1b.p0.unpack(p0);
+      bob.msg1(pS, msg_2a.signal0, msg_2a.signal1,
                msg_2a.u, msg_2a.hma0, msg_2a.hma1,
                msg_1b.sid,
            msg_1b.hS0, msg_1b.hS1,
-               msg_1b.p0, msg_1b.r_sid, m);
+               p0, msg_1b.r_sid,
+               bob_cache.get(msg_1b.seed));
+      msg_2a.pS.pack(pS);
       msg_2a.sid = msg_1b.sid;
 
-      memcpy(&msg_2b, &msg_2a, sizeof(comm_rot_msg_2_t<P, bbytes, HASHSIZE>));
-
-      success = success && alice.msg2(msgb, b, msg_3a.S0, msg_3a.S1,
-                      msg_2b.sid, msg_2b.pS,
-                                      msg_2b.signal0, msg_2b.signal1,
-                                      msg_2b.hma0, msg_2b.hma1,
-                                      msg_2b.u);
-      msg_3a.sid = msg_2b.sid;
+      // Alice reads the second message in place from the received buffer
+      len = encode_into(byte_span_t(wire, sizeof(wire)), msg_2a);
+      success = success && msg_2b.parse(wire, len) &&
+        msg_2b.get<msg_2_wire::PS>().unpack(pS) &&
+        alice.msg2(msgb, b, msg_3a.S0, msg_3a.S1,
+                      msg_2b.sid(), pS,
+                                      msg_2b.get<msg_2_wire::SIGNAL0>(), msg_2b.get<msg_2_wire::SIGNAL1>(),
+                                      msg_2b.get<msg_2_wire::HMA0>(), msg_2b.get<msg_2_wire::HMA1>(),
+                                      msg_2b.get<msg_2_wire::U>());
 
       if (success)
         {
-            memcpy(&msg_3b, &msg_3a, sizeof(comm_rot_msg_3_t<bbytes>));
+            msg_3a.sid = msg_2b.sid();
+            len = encode_into(byte_span_t(wire, sizeof(wire)), msg_3a);
+            success = success && wire_decode(msg_3b, wire, len);
 
 	    success = success && bob.msg2(msg0, msg1, msg_3b.sid, msg_3b.S0, msg_3b.S1);
         }
@@ -389,6 +443,1218 @@ void comm_rot_test()
     }
 }
 
+/** Batched ROT test */
+void comm_rot_batch_test()
+{
+  const size_t numtests = 1000;
+  constexpr size_t batch = 50;
+  using P = nfl::poly_from_modulus<uint16_t, N, 14>;
+  constexpr size_t rbytes = 16;
+  constexpr size_t bbytes = 16;
+  constexpr size_t HASHSIZE = 32;
+  using poly_vector_t = std::vector<P, nfl::aligned_allocator<P, 64>>;
+  using alice_t = alice_rot_batch_t<P, rbytes, bbytes, HASHSIZE, batch>;
+  using bob_t = bob_rot_batch_t<P, rbytes, bbytes, HASHSIZE, batch>;
+  nfl::uniform unif;
+  nfl::FastGaussianNoise<uint8_t, P::value_type, 2> g_prng(sqrt((double)K/2.), 138, N);
+
+  std::unique_ptr<alice_t> alice(new alice_t(&g_prng));
+  std::unique_ptr<bob_t> bob(new bob_t(&g_prng));
+
+  poly_vector_t p0(batch), pS(batch);
+  std::vector<ke_t<P>::signal_t> signal0(batch), signal1(batch);
+  uint32_t sid[batch];
+  uint8_t r_sid[batch][sizeof(uint32_t) + rbytes];
+  uint8_t hS0[batch][HASHSIZE], hS1[batch][HASHSIZE];
+  uint8_t u[batch][bbytes];
+  uint8_t hma0[batch][HASHSIZE], hma1[batch][HASHSIZE];
+  uint8_t S0[batch][bbytes], S1[batch][bbytes];
+  uint8_t msg0[batch][HASHSIZE], msg1[batch][HASHSIZE], msgb[batch][HASHSIZE];
+  int b[batch];
+
+  for (size_t i = 0; i < numtests / batch; i++)
+    {
+      P m = unif;
+
+      for (size_t j = 0; j < batch; j++)
+        sid[j] = i * batch + j;
+
+      alice->msg1(&p0[0], r_sid, hS0, hS1, sid, m);
+      bob->msg1(&pS[0], &signal0[0], &signal1[0], u, hma0, hma1,
+                sid, hS0, hS1, &p0[0], r_sid, m);
+
+      bool success = alice->msg2(msgb, b, S0, S1, sid, &pS[0],
+                                 &signal0[0], &signal1[0], hma0, hma1, u);
+      success = success && bob->msg2(msg0, msg1, sid, S0, S1);
+
+      for (size_t j = 0; j < batch; j++)
+        {
+          if (b[j] == 0)
+            success = success && (memcmp(&msgb[j][0], &msg0[j][0], HASHSIZE) == 0);
+          else
+            success = success && (memcmp(&msgb[j][0], &msg1[j][0], HASHSIZE) == 0);
+        }
+      CU_ASSERT(success);
+    }
+
+  // A session with a bad commitment is rejected without opening its
+  // masks, the other sessions of the batch still complete
+  constexpr size_t bad = 7;
+  P m = unif;
+  alice->msg1(&p0[0], r_sid, hS0, hS1, sid, m);
+  bob->msg1(&pS[0], &signal0[0], &signal1[0], u, hma0, hma1,
+            sid, hS0, hS1, &p0[0], r_sid, m);
+  hma0[bad][0] ^= 1;
+  hma1[bad][0] ^= 1;
+
+  const uint8_t zeros[bbytes] = {0};
+  bool success = !alice->msg2(msgb, b, S0, S1, sid, &pS[0],
+                              &signal0[0], &signal1[0], hma0, hma1, u);
+  success = success && (b[bad] == -1) &&
+    (memcmp(S0[bad], zeros, bbytes) == 0) && (memcmp(S1[bad], zeros, bbytes) == 0);
+  success = success && !bob->msg2(msg0, msg1, sid, S0, S1);
+  for (size_t j = 0; j < batch; j++)
+    {
+      if (j != bad)
+        success = success &&
+          (memcmp(&msgb[j][0], b[j] == 0 ? &msg0[j][0] : &msg1[j][0], HASHSIZE) == 0);
+    }
+  CU_ASSERT(success);
+}
+
+/** OT extension test, seeded by kappa batched ROTs */
+void otext_test()
+{
+  constexpr size_t kappa = 128;
+  constexpr size_t msgbytes = 16;
+  using P = nfl::poly_from_modulus<uint16_t, N, 14>;
+  constexpr size_t rbytes = 16;
+  constexpr size_t bbytes = 16;
+  constexpr size_t HASHSIZE = 32;
+  using poly_vector_t = std::vector<P, nfl::aligned_allocator<P, 64>>;
+  using alice_t = alice_rot_batch_t<P, rbytes, bbytes, HASHSIZE, kappa>;
+  using bob_t = bob_rot_batch_t<P, rbytes, bbytes, HASHSIZE, kappa>;
+  nfl::uniform unif;
+  nfl::FastGaussianNoise<uint8_t, P::value_type, 2> g_prng(sqrt((double)K/2.), 138, N);
+
+  std::unique_ptr<alice_t> alice(new alice_t(&g_prng));
+  std::unique_ptr<bob_t> bob(new bob_t(&g_prng));
+
+  poly_vector_t p0(kappa), pS(kappa);
+  std::vector<ke_t<P>::signal_t> signal0(kappa), signal1(kappa);
+  uint32_t sid[kappa];
+  uint8_t r_sid[kappa][sizeof(uint32_t) + rbytes];
+  uint8_t hS0[kappa][HASHSIZE], hS1[kappa][HASHSIZE];
+  uint8_t u[kappa][bbytes];
+  uint8_t hma0[kappa][HASHSIZE], hma1[kappa][HASHSIZE];
+  uint8_t S0[kappa][bbytes], S1[kappa][bbytes];
+  uint8_t M0[kappa][HASHSIZE], M1[kappa][HASHSIZE], Mb[kappa][HASHSIZE];
+  int b[kappa];
+  P m_pol = unif;
+
+  for (size_t j = 0; j < kappa; j++)
+    sid[j] = j;
+
+  // Base ROTs: the extension sender is Alice, the extension receiver is Bob
+  alice->msg1(&p0[0], r_sid, hS0, hS1, sid, m_pol);
+  bob->msg1(&pS[0], &signal0[0], &signal1[0], u, hma0, hma1,
+            sid, hS0, hS1, &p0[0], r_sid, m_pol);
+  bool success = alice->msg2(Mb, b, S0, S1, sid, &pS[0],
+                             &signal0[0], &signal1[0], hma0, hma1, u);
+  success = success && bob->msg2(M0, M1, sid, S0, S1);
+  CU_ASSERT(success);
+
+  std::unique_ptr<iknp_sender_t<kappa, msgbytes>> sender(new iknp_sender_t<kappa, msgbytes>);
+  std::unique_ptr<iknp_receiver_t<kappa, msgbytes>> receiver(new iknp_receiver_t<kappa, msgbytes>);
+  sender->set_base(b, Mb);
+  receiver->set_base(M0, M1);
+
+  // Whole blocks, partial last blocks and less than a block, in one run
+  // to check that both parties stay in sync across calls
+  for (size_t m : {4096, 1536, 1032, 64, 8, 1024})
+    {
+      std::vector<uint8_t> ucorr(kappa * m / 8), choice(m / 8);
+      std::vector<uint8_t> x0(m * msgbytes), x1(m * msgbytes), xr(m * msgbytes);
+      nfl::fastrandombytes(&choice[0], choice.size());
+
+      success = receiver->extend(&ucorr[0], (uint8_t (*)[msgbytes])&xr[0],
+                                 &choice[0], m);
+      success = success && sender->extend((uint8_t (*)[msgbytes])&x0[0],
+                                          (uint8_t (*)[msgbytes])&x1[0],
+                                          &ucorr[0], m);
+
+      for (size_t j = 0; j < m; j++)
+        {
+          int rj = (choice[j / 8] >> (j & 7)) & 1;
+          const uint8_t *xrj = &xr[j * msgbytes];
+          const uint8_t *x0j = &x0[j * msgbytes];
+          const uint8_t *x1j = &x1[j * msgbytes];
+
+          success = success &&
+            (memcmp(xrj, rj ? x1j : x0j, msgbytes) == 0) &&
+            (memcmp(x0j, x1j, msgbytes) != 0);
+        }
+      CU_ASSERT(success);
+    }
+}
+
+/** Bit-matrix transpose test */
+void transpose_bits_test()
+{
+  constexpr size_t nrows = 136, ncols = 256;
+  uint8_t in[nrows * ncols / 8], out[ncols * nrows / 8], back[nrows * ncols / 8];
+
+  nfl::fastrandombytes(in, sizeof(in));
+  transpose_bits(out, in, nrows, ncols, ncols / 8);
+
+  bool success = true;
+  for (size_t x = 0; x < nrows; x++)
+    for (size_t y = 0; y < ncols; y++)
+      success = success &&
+        (((in[x * ncols / 8 + y / 8] >> (y & 7)) & 1) ==
+         ((out[y * nrows / 8 + x / 8] >> (x & 7)) & 1));
+
+  transpose_bits(back, out, ncols, nrows, nrows / 8);
+  success = success && (memcmp(in, back, sizeof(in)) == 0);
+  CU_ASSERT(success);
+}
+
+/** XOF polynomial ROM test against a bit-by-bit reference */
+void rom1_test()
+{
+  using P = nfl::poly_from_modulus<uint16_t, N, 14>;
+  using rom = rom1_t<P>;
+  const P::value_type q = P::get_modulus(0);
+  bool success = true;
+
+  for (size_t t = 0; t < 64; t++)
+    {
+      uint8_t in[20], stream[4 * rom::BUFBYTES];
+      P h, h2;
+      rom rom1;
+      rom_P_O<P> out(h), out2(h2);
+
+      nfl::fastrandombytes(in, sizeof(in));
+      rom1(out, in, t % sizeof(in));
+
+      blake3_hasher hasher;
+      blake3_hasher_init(&hasher);
+      blake3_hasher_update(&hasher, in, t % sizeof(in));
+      blake3_hasher_finalize(&hasher, stream, sizeof(stream));
+
+      size_t n = 0;
+      for (size_t i = 0; n < N && (i + 1) * 14 <= 8 * sizeof(stream); i++)
+	{
+	  P::value_type v = 0;
+	  for (size_t l = 0; l < 14; l++)
+	    v |= ((stream[(i * 14 + l) / 8] >> ((i * 14 + l) % 8)) & 1) << l;
+	  if (v < q)
+	    success = success && (h(0, n++) == v);
+	}
+      success = success && (n == N) && out.full();
+
+      // Deterministic, and distinct inputs give distinct outputs
+      rom1(out2, in, t % sizeof(in));
+      success = success && pol_equal(h, h2);
+      in[0] ^= 1;
+      rom1(out2, in, sizeof(in));
+      success = success && !pol_equal(h, h2);
+    }
+
+  CU_ASSERT(success);
+}
+
+/** Batched Blake3 test against single Blake3 hashes */
+void blake3_many_test()
+{
+  const size_t lens[] = {0, 1, 16, 20, 20, 63, 64, 64, 64, 65, 128, 128, 200, 1024, 1025, 3000};
+  const size_t nlens = sizeof(lens) / sizeof(lens[0]);
+  const size_t count = 300;
+  std::vector<uint8_t> in(count * 3000);
+  std::vector<uint8_t> out(count * BLAKE3_OUT_LEN), ref(count * BLAKE3_OUT_LEN);
+  std::vector<size_t> len(count);
+  uint8_t r[count];
+  bool success = true;
+
+  nfl::fastrandombytes(&in[0], in.size());
+  nfl::fastrandombytes(r, sizeof(r));
+
+  // Runs of equal lengths, to fill the lanes, mixed with changes of length
+  blake3_many_t hashes;
+  for (size_t i = 0; i < count; i++)
+    {
+      len[i] = (r[i] < 64 || i == 0) ? lens[r[i] % nlens] : len[i - 1];
+      hashes.add(&out[i * BLAKE3_OUT_LEN], &in[i * 3000], len[i]);
+      blake3(&ref[i * BLAKE3_OUT_LEN], &in[i * 3000], len[i]);
+    }
+  hashes.flush();
+  success = success && (hashes.n == 0);
+
+  for (size_t i = 0; i < count; i++)
+    success = success && (memcmp(&out[i * BLAKE3_OUT_LEN], &ref[i * BLAKE3_OUT_LEN], BLAKE3_OUT_LEN) == 0);
+
+  CU_ASSERT(success);
+}
+
+/** AES-CBC engine test: AES-NI or EVP, single and interleaved, against
+    the EVP contexts */
+template<size_t pbytes, size_t bbytes>
+bool sym_enc_many_check()
+{
+  using enc_t = aes_cbc_t<pbytes, 16, bbytes>;
+  using cipher_t = typename enc_t::cipher_t;
+  const size_t n = 11;
+  enc_t enc, enc_many;
+  uint8_t in[n][pbytes], r[n][16], key[n][bbytes], out[n][pbytes], out_many[n][pbytes];
+  cipher_t c[n], c_one[n], c_many[n];
+  cipher_t *pc[n];
+  const cipher_t *pcc[n];
+  const uint8_t *pin[n], *pr[n], *pkey[n];
+  uint8_t *pout[n];
+  bool success = true;
+
+  nfl::fastrandombytes(&in[0][0], sizeof(in));
+  nfl::fastrandombytes(&r[0][0], sizeof(r));
+  nfl::fastrandombytes(&key[0][0], sizeof(key));
+  // A repeated key, as between sessions sharing one
+  memcpy(key[1], key[0], bbytes);
+
+  for (size_t i = 0; i < n; i++)
+    {
+      enc.SEnc_evp(c[i], in[i], r[i], key[i]);
+      enc_many.SEnc(c_one[i], in[i], r[i], key[i]);
+      pc[i] = &c_many[i];
+      pcc[i] = &c[i];
+      pin[i] = in[i];
+      pr[i] = r[i];
+      pkey[i] = key[i];
+      pout[i] = out_many[i];
+    }
+  enc_many.SEnc_many(pc, pin, pr, pkey, n);
+  enc_many.SDec_many(pout, pcc, pkey, n);
+
+  for (size_t i = 0; i < n; i++)
+    {
+      enc.SDec_evp(out[i], c[i], key[i]);
+      success = success && (memcmp(&c[i], &c_many[i], sizeof(cipher_t)) == 0);
+      success = success && (memcmp(&c[i], &c_one[i], sizeof(cipher_t)) == 0);
+      success = success && (memcmp(out[i], in[i], pbytes) == 0);
+      success = success && (memcmp(out_many[i], in[i], pbytes) == 0);
+    }
+  return success;
+}
+
+void sym_enc_test()
+{
+  // SP 800-38A F.2.1, CBC-AES128.Encrypt, first block
+  const uint8_t key[16] = {0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+			   0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c};
+  const uint8_t iv[16] = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+			  0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f};
+  const uint8_t plain[16] = {0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96,
+			     0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a};
+  const uint8_t expected[16] = {0x76, 0x49, 0xab, 0xac, 0x81, 0x19, 0xb2, 0x46,
+				0xce, 0xe9, 0x8e, 0x9b, 0x12, 0xe9, 0x19, 0x7d};
+  aes_cbc_t<16, 16, 16> enc;
+  aes_cbc_t<16, 16, 16>::cipher_t c;
+  bool success = true;
+
+  for (size_t t = 0; t < 2; t++)
+    {
+      enc.SEnc(c, plain, iv, key);
+      success = success && (memcmp(c.buf, expected, sizeof(expected)) == 0);
+      enc.SEnc_evp(c, plain, iv, key);
+      success = success && (memcmp(c.buf, expected, sizeof(expected)) == 0);
+    }
+
+  success = success && sym_enc_many_check<16, 16>();
+  success = success && sym_enc_many_check<20, 16>();
+  success = success && sym_enc_many_check<48, 16>();
+  success = success && sym_enc_many_check<16, 32>();
+
+  CU_ASSERT(success);
+}
+
+/** BLAKE3 stream cipher policy test, alone and in OT sessions */
+void blake3_stream_test()
+{
+  using P = nfl::poly_from_modulus<uint16_t, N, 14>;
+  constexpr size_t rbytes = 16;
+  constexpr size_t bbytes = 16;
+  using enc_t = sym_enc_t<20, rbytes, bbytes, blake3_stream_t>;
+  using cipher_t = enc_t::cipher_t;
+  nfl::FastGaussianNoise<uint8_t, P::value_type, 2> g_prng(sqrt((double)K/2.), 138, N);
+  common_poly_cache_t<P> cache;
+  uint8_t seed[COMMON_POLY_SEEDBYTES];
+  bool success = sizeof(cipher_t().buf) == 20;
+
+  enc_t enc;
+  uint8_t in[2][20], r[2][rbytes], key[2][bbytes], out[20], out_many[2][20];
+  cipher_t c, c_many[2];
+  nfl::fastrandombytes(&in[0][0], sizeof(in));
+  nfl::fastrandombytes(&r[0][0], sizeof(r));
+  nfl::fastrandombytes(&key[0][0], sizeof(key));
+
+  // Keystream is the keyed XOF of key || r
+  uint8_t stream[20];
+  blake3_hasher hasher;
+  blake3_hasher_init_keyed(&hasher, enc_t::domain_key());
+  blake3_hasher_update(&hasher, key[0], bbytes);
+  blake3_hasher_update(&hasher, r[0], rbytes);
+  blake3_hasher_finalize(&hasher, stream, sizeof(stream));
+
+  enc.SEnc(c, in[0], r[0], key[0]);
+  for (size_t i = 0; i < sizeof(stream); i++)
+    success = success && (c.buf[i] == (in[0][i] ^ stream[i]));
+  enc.SDec(out, c, key[0]);
+  success = success && (memcmp(out, in[0], sizeof(out)) == 0);
+  enc.SDec(out, c, key[1]);
+  success = success && (memcmp(out, in[0], sizeof(out)) != 0);
+
+  cipher_t *pc[2] = {&c_many[0], &c_many[1]};
+  const cipher_t *pcc[2] = {&c_many[0], &c_many[1]};
+  const uint8_t *pin[2] = {in[0], in[1]}, *pr[2] = {r[0], r[1]}, *pkey[2] = {key[0], key[1]};
+  uint8_t *pout[2] = {out_many[0], out_many[1]};
+  enc.SEnc_many(pc, pin, pr, pkey, 2);
+  enc.SDec_many(pout, pcc, pkey, 2);
+  success = success && (memcmp(&c_many[0], &c, sizeof(c)) == 0) &&
+    (memcmp(out_many, in, sizeof(in)) == 0);
+
+  common_poly_cache_t<P>::new_seed(seed);
+  const P &m = cache.get(seed);
+  for (int i = 0; i < 16; i++)
+    {
+      alice_ot_t<P, rbytes, bbytes, blake3_stream_t> alice(&g_prng);
+      bob_ot_t<P, rbytes, bbytes, blake3_stream_t> bob(&g_prng);
+      typename bob_ot_t<P, rbytes, bbytes, blake3_stream_t>::cipher_t a0, a1, c0, c1;
+      typename ke_t<P>::signal_t signal0, signal1;
+      uint8_t r_sid[sizeof(uint32_t) + rbytes], u0[2*rbytes + bbytes], u1[2*rbytes + bbytes];
+      uint8_t ch[rbytes], msg0[rbytes], msg1[rbytes], msgb[rbytes];
+      int b = i & 1;
+      P p0, pS;
+
+      nfl::fastrandombytes(msg0, rbytes);
+      nfl::fastrandombytes(msg1, rbytes);
+
+      alice.msg1(p0, r_sid, b, i, m);
+      bob.msg1(pS, signal0, signal1, u0, u1, a0, a1, i, p0, r_sid, m);
+      success = success && alice.msg2(ch, i, pS, signal0, signal1, a0, a1, u0, u1) &&
+	bob.msg2(c0, c1, ch, msg0, msg1);
+      alice.msg3(msgb, c0, c1);
+      success = success && (memcmp(msgb, b ? msg1 : msg0, rbytes) == 0);
+    }
+
+  CU_ASSERT(success);
+}
+
+/** Common polynomial expansion and cache test */
+void common_poly_test()
+{
+  using P = nfl::poly_from_modulus<uint16_t, N, 14>;
+  constexpr size_t capacity = 4;
+  common_poly_cache_t<P> cache(capacity);
+  uint8_t seeds[capacity + 1][COMMON_POLY_SEEDBYTES];
+  P expected;
+  bool success = true;
+
+  for (size_t i = 0; i <= capacity; i++)
+    common_poly_cache_t<P>::new_seed(seeds[i]);
+
+  for (size_t i = 0; i < capacity; i++)
+    {
+      const P &m = cache.get(seeds[i]);
+      expand_common_poly<P>(expected, seeds[i]);
+      success = success && pol_equal(m, expected);
+
+      for (size_t j = 0; j < P::degree; j++)
+        success = success && (m(0, j) < P::get_modulus(0));
+    }
+  success = success && (cache.misses == capacity) && (cache.hits == 0);
+
+  // Cache hits return the memoised polynomial
+  for (size_t i = 0; i < capacity; i++)
+    {
+      expand_common_poly<P>(expected, seeds[i]);
+      success = success && pol_equal(cache.get(seeds[i]), expected);
+    }
+  success = success && (cache.misses == capacity) && (cache.hits == capacity);
+
+  // A new seed evicts the oldest entry
+  expand_common_poly<P>(expected, seeds[capacity]);
+  success = success && pol_equal(cache.get(seeds[capacity]), expected);
+  success = success && !pol_equal(cache.get(seeds[1]), expected);
+  success = success && (cache.misses == capacity + 1) && (cache.hits == capacity + 1);
+  cache.get(seeds[0]);
+  success = success && (cache.misses == capacity + 2);
+
+  CU_ASSERT(success);
+}
+
+/** Explicit PRNG context test */
+void prng_ctx_test()
+{
+  using P = nfl::poly_from_modulus<uint16_t, N, 14>;
+  constexpr size_t rbytes = 16;
+  constexpr size_t bbytes = 16;
+  constexpr size_t HASHSIZE = 32;
+  nfl::FastGaussianNoise<uint8_t, P::value_type, 2> g_prng(sqrt((double)K/2.), 138, N);
+  uint8_t key[nfl::prng_ctx_t::KEYBYTES];
+  uint8_t seed[COMMON_POLY_SEEDBYTES];
+  uint8_t out0[64], out1[64];
+  bool success = true;
+
+  nfl::fastrandombytes(key, sizeof(key));
+  common_poly_cache_t<P>::new_seed(seed);
+  common_poly_cache_t<P> cache;
+  const P &m = cache.get(seed);
+
+  // Equally seeded contexts produce the same stream
+  nfl::prng_ctx_t ctx0, ctx1;
+  ctx0.seed(key);
+  ctx1.seed(key);
+  nfl::fastrandombytes(ctx0, out0, sizeof(out0));
+  nfl::fastrandombytes(ctx1, out1, sizeof(out1));
+  success = success && (memcmp(out0, out1, sizeof(out0)) == 0);
+  nfl::fastrandombytes(ctx0, out0, sizeof(out0));
+  success = success && (memcmp(out0, out1, sizeof(out0)) != 0);
+
+  // and the same noise, across refills of their uniform buffers
+  ctx0.seed(key);
+  ctx1.seed(key);
+  for (size_t i = 0; i < 16; i++)
+    {
+      P e0 = nfl::gaussian<uint8_t, P::value_type, 2>(&g_prng, 2, &ctx0);
+      P e1 = nfl::gaussian<uint8_t, P::value_type, 2>(&g_prng, 2, &ctx1);
+      success = success && pol_equal(e0, e1);
+    }
+
+  // Protocol structures only draw from their own context
+  ctx0.seed(key);
+  ctx1.seed(key);
+  alice_rot_t<P, rbytes, bbytes, HASHSIZE> alice0(&g_prng, &ctx0);
+  alice_rot_t<P, rbytes, bbytes, HASHSIZE> alice1(&g_prng, &ctx1);
+  comm_rot_msg_1_t<P, rbytes, HASHSIZE> msg_1a, msg_1b;
+  P p0a, p0b;
+
+  alice0.msg1(p0a, msg_1a.r_sid, msg_1a.hS0, msg_1a.hS1, 0, m);
+  nfl::fastrandombytes(out0, sizeof(out0));
+  alice1.msg1(p0b, msg_1b.r_sid, msg_1b.hS0, msg_1b.hS1, 0, m);
+
+  success = success && pol_equal(p0a, p0b) &&
+    (memcmp(msg_1a.r_sid, msg_1b.r_sid, sizeof(msg_1a.r_sid)) == 0) &&
+    (memcmp(msg_1a.hS0, msg_1b.hS0, HASHSIZE) == 0);
+
+  CU_ASSERT(success);
+}
+
+/** Keystream of an OpenSSL stream cipher */
+static void openssl_keystream(const EVP_CIPHER *cipher, const uint8_t *key, const uint8_t *iv,
+			      uint8_t *out, int len)
+{
+  evp_cipher_ctx_ptr_t ctx(EVP_CIPHER_CTX_new());
+  int outlen;
+  memset(out, 0, len);
+  if (EVP_EncryptInit_ex(ctx.get(), cipher, nullptr, key, iv) != 1 ||
+      EVP_EncryptUpdate(ctx.get(), out, &outlen, out, len) != 1)
+    throw std::runtime_error("openssl_keystream: EVP encryption failed");
+}
+
+/** PRNG stream cipher backends test */
+void prng_backend_test()
+{
+  // ChaCha20 test vector: all-zero key and nonce, block 0
+  static const uint8_t chacha20_kat[64] = {
+    0x76, 0xb8, 0xe0, 0xad, 0xa0, 0xf1, 0x3d, 0x90, 0x40, 0x5d, 0x6a, 0xe5, 0x53, 0x86, 0xbd, 0x28,
+    0xbd, 0xd2, 0x19, 0xb8, 0xa0, 0x8d, 0xed, 0x1a, 0xa8, 0x36, 0xef, 0xcc, 0x8b, 0x77, 0x0d, 0xc7,
+    0xda, 0x41, 0x59, 0x7c, 0x51, 0x57, 0x48, 0x8d, 0x77, 0x24, 0xe0, 0x3f, 0xb8, 0xd8, 0x4a, 0x37,
+    0x6a, 0x43, 0xb8, 0xf4, 0x15, 0x18, 0xa1, 0x1c, 0xc3, 0x87, 0xb6, 0x69, 0xb2, 0xee, 0x65, 0x86
+  };
+  constexpr size_t len = 3 * nfl::prng_ctx_t::BUFFERBYTES / 2;
+  uint8_t key[nfl::prng_ctx_t::KEYBYTES] = {0};
+  uint8_t nonce[nfl::prng_ctx_t::NONCEBYTES] = {0};
+  uint8_t iv[16];
+  std::vector<uint8_t> out0(len), out1(len);
+  bool success = true;
+
+  nfl_crypto_stream_chacha20(&out0[0], sizeof(chacha20_kat), nonce, key);
+  success = success && (memcmp(&out0[0], chacha20_kat, sizeof(chacha20_kat)) == 0);
+
+  // Every length, including the partial batches of the vector versions,
+  // against OpenSSL
+  nfl::fastrandombytes(key, sizeof(key));
+  nfl::fastrandombytes(nonce, sizeof(nonce));
+  for (size_t l = 0; l <= 1100; l += 11)
+    {
+      nfl_crypto_stream_chacha20(&out0[0], l, nonce, key);
+      memset(iv, 0, 8);
+      memcpy(iv + 8, nonce, 8);
+      openssl_keystream(EVP_chacha20(), key, iv, &out1[0], l);
+      success = success && (memcmp(&out0[0], &out1[0], l) == 0);
+#ifdef NFL_HAVE_AES256CTR
+      nfl_crypto_stream_aes256ctr(&out0[0], l, nonce, key);
+      memcpy(iv, nonce, 8);
+      memset(iv + 8, 0, 8);
+      openssl_keystream(EVP_aes_256_ctr(), key, iv, &out1[0], l);
+      success = success && (memcmp(&out0[0], &out1[0], l) == 0);
+#endif
+    }
+
+  // Small requests served from the buffered keystream continue one another
+  // the same way whatever their sizes, and the first buffer is the stream
+  // of a single request of its size
+  nfl::prng_ctx_t ctx0, ctx1, ctx2;
+  ctx0.seed(key);
+  ctx1.seed(key);
+  ctx2.seed(key);
+  for (size_t i = 0; i < len; i++)
+    nfl::fastrandombytes(ctx0, &out0[i], 1);
+  for (size_t i = 0, l = 1; i < len; i += l, l = l * 3 % 97 + 1)
+    nfl::fastrandombytes(ctx1, &out1[i], std::min(l, len - i));
+  success = success && (out0 == out1);
+  nfl::fastrandombytes(ctx2, &out1[0], nfl::prng_ctx_t::BUFFERBYTES);
+  success = success && (memcmp(&out0[0], &out1[0], nfl::prng_ctx_t::BUFFERBYTES) == 0);
+
+  success = success && (strlen(nfl::fastrandombytes_backend()) > 0);
+
+  CU_ASSERT(success);
+}
+
+/** Work-stealing session executor test */
+void rot_executor_test()
+{
+  const size_t numtests = 200;
+  using P = nfl::poly_from_modulus<uint16_t, N, 14>;
+  constexpr size_t rbytes = 16;
+  constexpr size_t bbytes = 16;
+  constexpr size_t HASHSIZE = 32;
+  rot_executor_t<P> executor(4, sqrt((double)K/2.));
+  uint8_t seed[COMMON_POLY_SEEDBYTES];
+  bool success = true;
+
+  common_poly_cache_t<P>::new_seed(seed);
+
+  success = success &&
+    (executor.run(0, numtests, rot_session_t<P, rbytes, bbytes, HASHSIZE>(seed), 7) == 0);
+
+  size_t sessions = 0;
+  for (size_t i = 0; i < executor.size(); i++)
+    sessions += executor.workers[i]->sessions;
+  success = success && (sessions == numtests);
+
+  success = success &&
+    (executor.run(numtests, numtests / 2, ot_session_t<P, rbytes, bbytes>(seed)) == 0);
+
+  sessions = 0;
+  for (size_t i = 0; i < executor.size(); i++)
+    sessions += executor.workers[i]->sessions;
+  success = success && (sessions == numtests / 2);
+
+  // The last session ID is 2^32 - 1 at most
+  success = success &&
+    (executor.run(UINT32_MAX - 9, 10, ot_session_t<P, rbytes, bbytes>(seed), 3) == 0);
+
+  sessions = 0;
+  for (size_t i = 0; i < executor.size(); i++)
+    sessions += executor.workers[i]->sessions;
+  success = success && (sessions == 10);
+
+  bool rejected = false;
+  try { executor.run(UINT32_MAX - 9, 11, ot_session_t<P, rbytes, bbytes>(seed)); }
+  catch (const std::out_of_range &) { rejected = true; }
+  success = success && rejected;
+
+  CU_ASSERT(success);
+}
+
+/** Precomputed RLWE sample pool test */
+void rlwe_pool_test()
+{
+  const size_t numtests = 200;
+  using P = nfl::poly_from_modulus<uint16_t, N, 14>;
+  constexpr size_t rbytes = 16;
+  constexpr size_t bbytes = 16;
+  constexpr size_t HASHSIZE = 32;
+  typedef typename sym_enc_t<rbytes, rbytes, bbytes>::cipher_t cipher_t;
+  using signal_t = ke_t<P>::signal_t;
+  nfl::FastGaussianNoise<uint8_t, P::value_type, 2> g_prng(sqrt((double)K/2.), 138, N);
+  common_poly_cache_t<P> cache;
+  uint8_t seed[COMMON_POLY_SEEDBYTES];
+  bool success = true;
+
+  common_poly_cache_t<P>::new_seed(seed);
+  const P &m = cache.get(seed);
+  rlwe_pool_t<P> alice_pool(m, sqrt((double)K/2.), 138, 16);
+
+  // The producer fills the ring and stops
+  alice_pool.wait_idle();
+  success = success && (alice_pool.capacity() == 16) && (alice_pool.size() == 16);
+
+  // Bob's pool has no producer thread, and a seeded PRNG so that its
+  // samples can be recomputed
+  uint8_t key[nfl::prng_ctx_t::KEYBYTES];
+  nfl::FastGaussianNoise<uint8_t, P::value_type, 2> ref_g_prng(sqrt((double)K/2.), 138, N);
+  nfl::prng_ctx_t ref_ctx;
+  rlwe_pool_t<P>::sample_t ref;
+  rlwe_pool_t<P> bob_pool(m, sqrt((double)K/2.), 138, 16, false);
+
+  nfl::fastrandombytes(key, sizeof(key));
+  bob_pool.ctx.seed(key);
+  ref_ctx.seed(key);
+
+  for (size_t i = 0; i < numtests; i++)
+    {
+      alice_rot_t<P, rbytes, bbytes, HASHSIZE> alice(&g_prng);
+      bob_rot_t<P, rbytes, bbytes, HASHSIZE> bob(&g_prng);
+      uint8_t r_sid[sizeof(uint32_t) + rbytes], hS0[HASHSIZE], hS1[HASHSIZE];
+      uint8_t u[bbytes], hma0[HASHSIZE], hma1[HASHSIZE], S0[bbytes], S1[bbytes];
+      uint8_t msg0[HASHSIZE], msg1[HASHSIZE], msgb[HASHSIZE];
+      signal_t signal0, signal1;
+      P p0, pS;
+      int b;
+
+      // Bob is served from the ring for the first 16 sessions out of 32,
+      // and computes his samples himself for the other ones
+      if (i % 32 == 0)
+	bob_pool.refill();
+
+      alice.msg1_online(p0, r_sid, hS0, hS1, i, alice_pool);
+      bob.msg1_online(pS, signal0, signal1, u, hma0, hma1, i, hS0, hS1, p0, r_sid, bob_pool);
+      success = success &&
+	alice.msg2(msgb, b, S0, S1, i, pS, signal0, signal1, hma0, hma1, u) &&
+	bob.msg2(msg0, msg1, i, S0, S1) &&
+	(memcmp(msgb, b ? msg1 : msg0, HASHSIZE) == 0);
+
+      // Samples served from the ring are the ones of the seeded PRNG, in order
+      if (i % 32 < 16)
+	{
+	  ref.sample(m, &ref_g_prng, ref_ctx);
+	  success = success && (memcmp(&pS, &ref.p, sizeof(P)) == 0);
+	}
+    }
+
+  success = success && (bob_pool.hits == 104) && (bob_pool.misses == 96) &&
+    (bob_pool.size() == 8);
+
+  for (size_t i = 0; i < numtests; i++)
+    {
+      alice_ot_t<P, rbytes, bbytes> alice(&g_prng);
+      bob_ot_t<P, rbytes, bbytes> bob(&g_prng);
+      uint8_t r_sid[sizeof(uint32_t) + rbytes], ch[rbytes];
+      uint8_t u0[2*rbytes + bbytes], u1[2*rbytes + bbytes];
+      uint8_t msg0[rbytes], msg1[rbytes], msgb[rbytes];
+      cipher_t a0, a1, c0, c1;
+      signal_t signal0, signal1;
+      P p0, pS;
+      int b = i & 1;
+
+      nfl::fastrandombytes(msg0, rbytes);
+      nfl::fastrandombytes(msg1, rbytes);
+
+      // Topping up between sessions keeps Bob's ring from running dry
+      bob_pool.refill();
+
+      alice.msg1_online(p0, r_sid, b, i, alice_pool);
+      bob.msg1_online(pS, signal0, signal1, u0, u1, a0, a1, i, p0, r_sid, bob_pool);
+      success = success &&
+	alice.msg2(ch, i, pS, signal0, signal1, a0, a1, u0, u1) &&
+	bob.msg2(c0, c1, ch, msg0, msg1);
+      if (success)
+	alice.msg3(msgb, c0, c1);
+      success = success && (memcmp(msgb, b ? msg1 : msg0, rbytes) == 0);
+    }
+
+  success = success && (alice_pool.hits + alice_pool.misses == 2 * numtests) &&
+    (bob_pool.hits == 104 + numtests) && (bob_pool.misses == 96);
+
+  // Without producer thread the ring is only filled by refill()
+  rlwe_pool_t<P> fg_pool(m, sqrt((double)K/2.), 138, 4, false);
+  rlwe_pool_t<P>::sample_t sample;
+  fg_pool.pop(sample, &g_prng, nfl::default_prng_ctx());
+  success = success && (fg_pool.misses == 1) && (fg_pool.size() == 0);
+  fg_pool.refill();
+  success = success && (fg_pool.size() == 4) && fg_pool.try_pop(sample) &&
+    (fg_pool.size() == 3);
+
+  CU_ASSERT(success);
+}
+
+/** Hint signal and robust extractor test against the scalar [DXL12] definitions */
+void reconcile_test()
+{
+  using P = nfl::poly_from_modulus<uint16_t, N, 14>;
+  using ke = ke_t<P>;
+  using signed_value_t = P::signed_value_type;
+  nfl::uniform unif;
+  bool success = (sizeof(ke::signal_t) == N / 8) && (sizeof(ke::key_t) == N / 8);
+
+  for (int t = 0; t < 64; t++)
+    {
+      P k = unif;
+      ke::signal_t sig;
+      ke::key_t sk;
+      unsigned char r = t & 1;
+
+      // Coefficients around the thresholds
+      const P::value_type edges[] = {0, 1, ke::qov4 - 1, ke::qov4, ke::qov4 + 1,
+				     ke::qp1ov4 + 1, ke::qov2 - 1, ke::qov2, ke::qov2 + 1,
+				     ke::q - ke::qp1ov4 - 1, ke::q - ke::qov4 - 1,
+				     ke::q - ke::qov4, ke::q - 1};
+      for (size_t i = 0; i < sizeof(edges)/sizeof(edges[0]); i++)
+	k(0, (t * 13 + i) % N) = edges[i];
+
+      ke::signal(sig, k, r);
+      ke::mod2(sk, k, sig);
+
+      for (size_t i = 0; i < N; i++)
+	{
+	  signed_value_t bound = r ? ke::qp1ov4 : ke::qov4;
+	  signed_value_t ki = (k(0, i) <= ke::qov2 ? k(0, i) :
+			       (signed_value_t)k(0, i) - ke::q);
+	  P::value_type sigi = (ki < -bound || ki > bound) ? 1 : 0;
+
+	  P::value_type y = (k(0, i) + (sigi ? ke::qov2 : 0)) % ke::q;
+	  signed_value_t yi = (y <= ke::qov2 ? y : (signed_value_t)y - ke::q);
+
+	  success = success && (sig(i) == sigi) && (sk(i) == (yi & 1));
+	}
+    }
+
+  CU_ASSERT(success);
+}
+
+/** Pointwise products of uint16_t polynomials against the division */
+void mulmod_test()
+{
+  using P = nfl::poly<uint16_t, N, 2>;
+  nfl::uniform unif;
+  bool success = true;
+
+  for (int t = 0; t < 16; t++)
+    {
+      P a = unif, b = unif, c = unif, ab, abc;
+
+      for (size_t cm = 0; cm < P::nmoduli; cm++)
+	{
+	  a(cm, t) = 0;
+	  a(cm, N - 1 - t) = b(cm, N - 1 - t) = P::get_modulus(cm) - 1;
+	}
+
+      ab = a * b;
+      abc = a * b + c;
+      for (size_t cm = 0; cm < P::nmoduli; cm++)
+	for (size_t i = 0; i < N; i++)
+	  {
+	    uint32_t p = P::get_modulus(cm);
+	    uint32_t prod = (uint32_t)a(cm, i) * b(cm, i) % p;
+	    success = success && (ab(cm, i) == prod) && (abc(cm, i) == (prod + c(cm, i)) % p);
+	  }
+    }
+
+  CU_ASSERT(success);
+}
+
+/** Inverse NTT check on every modulus of P: round trip, and negacyclic
+    product against the schoolbook product
+
+    @tparam P NFL Polynomial type
+    @return True when both match */
+template<class P>
+bool inv_ntt_check()
+{
+  using value_t = typename P::value_type;
+  using wide_t = typename nfl::params<value_t>::greater_value_type;
+  constexpr size_t n = P::degree;
+  nfl::uniform unif;
+  P a = unif, b = unif, c, d;
+  bool success = true;
+
+  for (size_t cm = 0; cm < P::nmoduli; cm++)
+    a(cm, 0) = b(cm, n - 1) = P::get_modulus(cm) - 1;
+  c = a;
+  d = b;
+  c.ntt_pow_phi();
+  d.ntt_pow_phi();
+  c = c * d;
+  c.invntt_pow_invphi();
+  d.invntt_pow_invphi();
+
+  for (size_t cm = 0; cm < P::nmoduli; cm++)
+    {
+      const wide_t p = P::get_modulus(cm);
+      for (size_t k = 0; k < n; k++)
+	{
+	  wide_t s = 0;
+	  for (size_t i = 0; i < n; i++)
+	    {
+	      wide_t prod = (wide_t)a(cm, i) * b(cm, (k + n - i) % n) % p;
+	      s = (i <= k) ? (s + prod) % p : (s + p - prod) % p;
+	    }
+	  success = success && (c(cm, k) == s) && (d(cm, k) == b(cm, k));
+	}
+    }
+  return success;
+}
+
+/** Gentleman-Sande inverse NTT test over the word sizes, the degrees and
+    the numbers of moduli, off the register kernels of 512 uint16_t
+    coefficients */
+void inv_ntt_test()
+{
+  bool success = true;
+
+  success = success && inv_ntt_check<nfl::poly_from_modulus<uint16_t, 256, 14>>();
+  success = success && inv_ntt_check<nfl::poly_from_modulus<uint16_t, 128, 14>>();
+  success = success && inv_ntt_check<nfl::poly_from_modulus<uint32_t, 256, 30>>();
+  success = success && inv_ntt_check<nfl::poly_from_modulus<uint32_t, 1024, 60>>();
+  success = success && inv_ntt_check<nfl::poly_from_modulus<uint64_t, 128, 62>>();
+  success = success && inv_ntt_check<nfl::poly_from_modulus<uint64_t, 512, 124>>();
+
+  CU_ASSERT(success);
+}
+
+/** NTT test: products mod X**N + 1 against the schoolbook product, and
+    round trips */
+void ntt_test()
+{
+  using P = nfl::poly_from_modulus<uint16_t, N, 14>;
+  nfl::uniform unif;
+  bool success = true;
+
+  for (int t = 0; t < 4; t++)
+    {
+      P a = unif, b = unif, c, d;
+      uint32_t p = P::get_modulus(0);
+
+      a(0, t) = b(0, N - 1 - t) = p - 1;
+      c = a;
+      d = b;
+      c.ntt_pow_phi();
+      d.ntt_pow_phi();
+      c = c * d;
+      c.invntt_pow_invphi();
+      d.invntt_pow_invphi();
+
+      for (size_t k = 0; k < N; k++)
+	{
+	  uint32_t s = 0;
+	  for (size_t i = 0; i < N; i++)
+	    {
+	      uint32_t prod = (uint32_t)a(0, i) * b(0, (k + N - i) % N) % p;
+	      s = (i <= k) ? (s + prod) % p : (s + p - prod) % p;
+	    }
+	  success = success && (c(0, k) == s) && (d(0, k) == b(0, k));
+	}
+    }
+
+  CU_ASSERT(success);
+}
+
+/** Transposed batch test: every lane matches the same operations on
+    nfl::poly */
+void poly_batch_test()
+{
+  using P = nfl::poly_from_modulus<uint16_t, N, 14>;
+  constexpr size_t lanes = 16;
+  using B = nfl::poly_batch<P::value_type, N, lanes>;
+  using poly_vector_t = std::vector<P, nfl::aligned_allocator<P, 64>>;
+  using batch_vector_t = std::vector<B, nfl::aligned_allocator<B, 64>>;
+  nfl::uniform unif;
+  nfl::FastGaussianNoise<uint8_t, P::value_type, 2> g_prng(sqrt((double)K/2.), 138, N);
+  bool success = true;
+
+  poly_vector_t a(lanes), b(lanes), r(lanes);
+  batch_vector_t x(3);
+  for (size_t l = 0; l < lanes; l++)
+    {
+      a[l] = unif;
+      b[l] = unif;
+      x[0].set(l, a[l]);
+      x[1].set(l, b[l]);
+    }
+
+  auto check = [&](const B &y, const poly_vector_t &ref) {
+    y.get(r.data(), lanes);
+    for (size_t l = 0; l < lanes; l++)
+      success = success && (r[l] == ref[l]);
+  };
+
+  x[0].ntt_pow_phi();
+  x[1].ntt_pow_phi();
+  for (size_t l = 0; l < lanes; l++)
+    {
+      a[l].ntt_pow_phi();
+      b[l].ntt_pow_phi();
+    }
+  check(x[0], a);
+
+  x[0] *= x[1];
+  x[0] += x[1];
+  x[0] -= x[0];
+  x[0] += x[1];
+  x[0] *= b[0];
+  x[2].muladd(a[0], x[0], x[1]);
+  P m = a[0];
+  for (size_t l = 0; l < lanes; l++)
+    a[l] = m * (b[l] * b[0]) + b[l];
+  check(x[2], a);
+
+  x[2].invntt_pow_invphi();
+  for (size_t l = 0; l < lanes; l++)
+    a[l].invntt_pow_invphi();
+  check(x[2], a);
+
+  // NTTs of a number of polynomials which is not a multiple of the lanes
+  poly_vector_t c(lanes + 4);
+  for (auto &p : c)
+    p = unif;
+  poly_vector_t d = c;
+  nfl::batch_ntt<lanes>(c.data(), c.size(), false);
+  for (auto &p : d)
+    p.ntt_pow_phi();
+  for (size_t i = 0; i < c.size(); i++)
+    success = success && (c[i] == d[i]);
+  nfl::batch_ntt<lanes>(c.data(), c.size(), true);
+  for (auto &p : d)
+    p.invntt_pow_invphi();
+  for (size_t i = 0; i < c.size(); i++)
+    success = success && (c[i] == d[i]);
+
+  // Gaussian noise, centered and amplified like nfl::poly's
+  x[0] = nfl::gaussian<uint8_t, P::value_type, 2>(&g_prng, 2);
+  for (size_t i = 0; i < N; i++)
+    for (size_t l = 0; l < lanes; l++)
+      {
+	P::value_type v = x[0](i, l), p = P::get_modulus(0);
+	success = success && (v < p) && (v % 2 == 0 || (p - v) % 2 == 0) &&
+	  (v < 256 || p - v < 256);
+      }
+
+  CU_ASSERT(success);
+}
+
+/** Lazily reduced expression template test */
+void lazy_reduction_test()
+{
+  using P = nfl::poly_from_modulus<uint16_t, N, 14>;
+  nfl::uniform unif;
+  P a = unif, b = unif, c = unif, d = unif, r;
+  const uint32_t p = P::get_modulus(0);
+  bool success = true;
+
+  // Largest coefficients, so that the unreduced sums reach their bounds
+  a(0, 0) = b(0, 0) = c(0, 0) = d(0, 0) = p - 1;
+
+  auto check = [&](uint32_t (*ref)(uint32_t, uint32_t, uint32_t, uint32_t, uint32_t)) {
+    for (size_t i = 0; i < N; i++)
+      success = success && (r(0, i) == ref(a(0, i), b(0, i), c(0, i), d(0, i), p));
+  };
+
+  r = a + b + c + d;
+  check([](uint32_t a, uint32_t b, uint32_t c, uint32_t d, uint32_t p) { return (a + b + c + d) % p; });
+  r = (a + b) - (c + d);
+  check([](uint32_t a, uint32_t b, uint32_t c, uint32_t d, uint32_t p) { return (a + b + 2 * p - c - d) % p; });
+  r = (a + b) * c;
+  check([](uint32_t a, uint32_t b, uint32_t c, uint32_t, uint32_t p) { return (a + b) % p * c % p; });
+  r = a * b + c + d;
+  check([](uint32_t a, uint32_t b, uint32_t c, uint32_t d, uint32_t p) { return (a * b + c + d) % p; });
+  r = a * b - c;
+  check([](uint32_t a, uint32_t b, uint32_t c, uint32_t, uint32_t p) { return (a * b % p + p - c) % p; });
+  r = (a + b + c) + (d - a - b);
+  check([](uint32_t, uint32_t, uint32_t c, uint32_t d, uint32_t p) { return (c + d) % p; });
+
+  CU_ASSERT(success);
+}
+
+/** Centered binomial sampler test */
+void cbd_test()
+{
+  using P = nfl::poly_from_modulus<uint16_t, N, 14>;
+  constexpr size_t rounds = 64;
+  uint8_t key[nfl::prng_ctx_t::KEYBYTES];
+  const int p = P::get_modulus(0);
+  double sum = 0, sum2 = 0;
+  bool success = true;
+
+  // Equally seeded contexts sample the same polynomials
+  nfl::fastrandombytes(key, sizeof(key));
+  nfl::prng_ctx_t ctx0, ctx1;
+  ctx0.seed(key);
+  ctx1.seed(key);
+  P a = nfl::cbd<K>(1, &ctx0), b = nfl::cbd<K>(1, &ctx1);
+  success = success && pol_equal(a, b);
+
+  // Amplified samples in [-2K, 2K], of variance K/2 before amplification
+  for (size_t r = 0; r < rounds; r++)
+    {
+      a = nfl::cbd<K>(2, &ctx0);
+      for (size_t i = 0; i < N; i++)
+	{
+	  int v = a(0, i) < p / 2 ? a(0, i) : a(0, i) - p;
+	  success = success && (v % 2 == 0) && (v >= -2 * K) && (v <= 2 * K);
+	  sum += v / 2;
+	  sum2 += (v / 2) * (v / 2);
+	}
+    }
+  sum /= rounds * N;
+  sum2 = sum2 / (rounds * N) - sum * sum;
+  success = success && (fabs(sum) < 0.1) && (fabs(sum2 - K / 2.) < 0.2);
+
+  CU_ASSERT(success);
+}
+
+/** Persisted Gaussian sampler tables test */
+void gaussian_tables_test()
+{
+  using P = nfl::poly_from_modulus<uint16_t, N, 14>;
+  using sampler_t = nfl::FastGaussianNoise<uint8_t, P::value_type, 2>;
+  uint8_t key[nfl::prng_ctx_t::KEYBYTES];
+  bool success = true;
+
+  sampler_t built(sqrt((double)K/2.), 138, N);
+  std::ostringstream os;
+  built.save(os);
+  const std::string blob = os.str();
+  sampler_t loaded(blob.data(), blob.size());
+
+  // The loaded tables draw the same noise
+  nfl::fastrandombytes(key, sizeof(key));
+  nfl::prng_ctx_t ctx0, ctx1;
+  ctx0.seed(key);
+  ctx1.seed(key);
+  for (size_t i = 0; i < 16; i++)
+    {
+      P e0 = nfl::gaussian<uint8_t, P::value_type, 2>(&built, 2, &ctx0);
+      P e1 = nfl::gaussian<uint8_t, P::value_type, 2>(&loaded, 2, &ctx1);
+      success = success && pol_equal(e0, e1);
+    }
+
+  // Truncated blobs and blobs of other samplers are rejected
+  bool rejected = false;
+  try { sampler_t truncated(blob.data(), blob.size() - 1); }
+  catch (const std::runtime_error &) { rejected = true; }
+  success = success && rejected;
+  rejected = false;
+  try { nfl::FastGaussianNoise<uint8_t, P::value_type, 1> other(blob.data(), blob.size()); }
+  catch (const std::runtime_error &) { rejected = true; }
+  success = success && rejected;
+
+  // So are trailing bytes and corrupted headers: a word precision which
+  // does not match the bit precision, and a number of barriers whose
+  // barrier matrix would overflow 32 bits
+  rejected = false;
+  try { sampler_t trailing((blob + '\0').data(), blob.size() + 1); }
+  catch (const std::runtime_error &) { rejected = true; }
+  success = success && rejected;
+  for (size_t field : {6, 7})
+    {
+      std::string corrupted = blob;
+      uint32_t value = 0xFFFFFFFF;
+      memcpy(&corrupted[8 + 4 * field], &value, sizeof(value));
+      rejected = false;
+      try { sampler_t bad(corrupted.data(), corrupted.size()); }
+      catch (const std::runtime_error &) { rejected = true; }
+      success = success && rejected;
+    }
+
+  CU_ASSERT(success);
+}
+
+/** 14-bit polynomial codec test */
+void poly_codec_test()
+{
+  using P = nfl::poly_from_modulus<uint16_t, N, 14>;
+  using codec = poly_codec_t<P>;
+  nfl::uniform unif;
+  bool success = (codec::bytes == N * 14 / 8);
+
+  for (size_t i = 0; i < 100; i++)
+    {
+      P p = unif, q;
+      uint8_t packed[codec::bytes], packed_ref[codec::bytes];
+
+      p(0, 0) = 0;
+      p(0, N - 1) = P::get_modulus(0) - 1;
+
+      // SIMD and portable implementations agree
+      codec::pack(packed, p);
+      codec::pack(packed_ref, p, std::false_type());
+      success = success && (memcmp(packed, packed_ref, codec::bytes) == 0);
+
+      success = success && codec::unpack(q, packed) && pol_equal(p, q);
+      q = 0;
+      success = success && codec::unpack(q, packed, std::false_type()) && pol_equal(p, q);
+
+      // Unreduced coefficients are rejected
+      for (size_t bit = (i % N) * 14; bit < (i % N + 1) * 14; bit++)
+	packed[bit / 8] |= 1 << (bit % 8);
+      success = success && !codec::unpack(q, packed) &&
+	!codec::unpack(q, packed, std::false_type());
+    }
+
+  CU_ASSERT(success);
+}
+
+/** Wire format test */
+void wire_test()
+{
+  using P = nfl::poly_from_modulus<uint16_t, N, 14>;
+  constexpr size_t bbytes = 16;
+  constexpr size_t HASHSIZE = 32;
+  using msg_t = comm_rot_msg_2_t<P, bbytes, HASHSIZE>;
+  using traits = wire_traits_t<msg_t>;
+  constexpr size_t bytes = wire_bytes<msg_t>::value;
+  msg_t msg, msg_b;
+  uint8_t wire[bytes + 1], flat[bytes];
+  bool success = (bytes == WIRE_HEADER_BYTES + 4 + N * 14 / 8 + 2 * N / 8 + bbytes + 2 * HASHSIZE);
+
+  nfl::fastrandombytes((uint8_t *)&msg, sizeof(msg));
+  msg.sid = 0x01020304;
+
+  // Round trip, integers in little endian
+  success = success && (encode_into(byte_span_t(wire, bytes - 1), msg) == 0) &&
+    (encode_into(byte_span_t(wire, sizeof(wire)), msg) == bytes) &&
+    (wire_message_bytes(wire) == bytes) &&
+    (wire[WIRE_HEADER_BYTES] == 0x04) && (wire[WIRE_HEADER_BYTES + 3] == 0x01) &&
+    wire_decode(msg_b, wire, bytes) && (msg_b.sid == msg.sid) &&
+    (memcmp(&msg_b.pS, &msg.pS, sizeof(msg.pS)) == 0) &&
+    (msg_b.signal0 == msg.signal0) && (msg_b.signal1 == msg.signal1) &&
+    (memcmp(msg_b.u, msg.u, bbytes) == 0) &&
+    (memcmp(msg_b.hma0, msg.hma0, HASHSIZE) == 0) &&
+    (memcmp(msg_b.hma1, msg.hma1, HASHSIZE) == 0);
+
+  // In-place view reads from the buffer
+  wire_view_t<msg_t> view;
+  success = success && view.parse(wire, bytes) && (view.sid() == msg.sid) &&
+    ((const uint8_t *)&view.get<traits::PS>() == wire + WIRE_HEADER_BYTES + 4) &&
+    (view.get<traits::SIGNAL1>() == msg.signal1) &&
+    (memcmp(view.get<traits::HMA1>(), msg.hma1, HASHSIZE) == 0);
+
+  // Scatter/gather output matches the contiguous encoding
+  struct iovec iov[wire_iov_count<msg_t>::value];
+  uint8_t scratch[WIRE_IOV_SCRATCH_BYTES];
+  size_t niov = encode_iov(iov, scratch, msg), off = 0;
+  for (size_t i = 0; i < niov; i++)
+    {
+      memcpy(&flat[off], iov[i].iov_base, iov[i].iov_len);
+      off += iov[i].iov_len;
+    }
+  success = success && (off == bytes) && (memcmp(flat, wire, bytes) == 0);
+
+  // Malformed headers are rejected
+  success = success && !view.parse(wire, bytes - 1) &&
+    !wire_decode(msg_b, wire, bytes - 1);
+  wire[0]++;
+  success = success && !view.parse(wire, bytes) && (wire_message_bytes(wire) == 0);
+  wire[0]--;
+  wire[1] = WIRE_ROT_MSG_1;
+  success = success && !view.parse(wire, bytes) && !wire_decode(msg_b, wire, bytes);
+  wire[1] = WIRE_ROT_MSG_2;
+  wire[4]++;
+  success = success && !view.parse(wire, sizeof(wire)) && !wire_decode(msg_b, wire, sizeof(wire));
+
+  CU_ASSERT(success);
+}
+
 int main(int argc, char *argv[])
 {
   if (CUE_SUCCESS != CU_initialize_registry())
@@ -416,7 +1682,29 @@ int main(int argc, char *argv[])
   CU_pSuite suite4 = CU_add_suite("RLWEROT", NULL, NULL);
   if (suite4 == NULL) abort();
 
-  if ((NULL == CU_add_test(suite4, "comm_rot_test", comm_rot_test)))
+  if ((NULL == CU_add_test(suite4, "prng_ctx_test", prng_ctx_test)) ||
+      (NULL == CU_add_test(suite4, "prng_backend_test", prng_backend_test)) ||
+      (NULL == CU_add_test(suite4, "reconcile_test", reconcile_test)) ||
+      (NULL == CU_add_test(suite4, "mulmod_test", mulmod_test)) ||
+      (NULL == CU_add_test(suite4, "inv_ntt_test", inv_ntt_test)) ||
+      (NULL == CU_add_test(suite4, "ntt_test", ntt_test)) ||
+      (NULL == CU_add_test(suite4, "poly_batch_test", poly_batch_test)) ||
+      (NULL == CU_add_test(suite4, "lazy_reduction_test", lazy_reduction_test)) ||
+      (NULL == CU_add_test(suite4, "cbd_test", cbd_test)) ||
+      (NULL == CU_add_test(suite4, "gaussian_tables_test", gaussian_tables_test)) ||
+      (NULL == CU_add_test(suite4, "poly_codec_test", poly_codec_test)) ||
+      (NULL == CU_add_test(suite4, "rom1_test", rom1_test)) ||
+      (NULL == CU_add_test(suite4, "blake3_many_test", blake3_many_test)) ||
+      (NULL == CU_add_test(suite4, "sym_enc_test", sym_enc_test)) ||
+      (NULL == CU_add_test(suite4, "blake3_stream_test", blake3_stream_test)) ||
+      (NULL == CU_add_test(suite4, "wire_test", wire_test)) ||
+      (NULL == CU_add_test(suite4, "common_poly_test", common_poly_test)) ||
+      (NULL == CU_add_test(suite4, "comm_rot_test", comm_rot_test)) ||
+      (NULL == CU_add_test(suite4, "comm_rot_batch_test", comm_rot_batch_test)) ||
+      (NULL == CU_add_test(suite4, "transpose_bits_test", transpose_bits_test)) ||
+      (NULL == CU_add_test(suite4, "otext_test", otext_test)) ||
+      (NULL == CU_add_test(suite4, "rot_executor_test", rot_executor_test)) ||
+      (NULL == CU_add_test(suite4, "rlwe_pool_test", rlwe_pool_test)))
     {
       abort();
     }
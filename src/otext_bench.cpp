@@ -0,0 +1,113 @@
+/**
+@file
+
+Throughput benchmark of the IKNP OT extension seeded by the lattice ROT.
+
+Usage: otext_bench [number of extended OTs]
+*/
+#include "rlwerot_batch.hpp"
+#include "otext.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#define N 512
+#define K 8
+
+int main(int argc, char *argv[])
+{
+  constexpr size_t kappa = 128;
+  constexpr size_t msgbytes = 16;
+  constexpr size_t chunk = 1 << 16;
+  using P = nfl::poly_from_modulus<uint16_t, N, 14>;
+  constexpr size_t rbytes = 16;
+  constexpr size_t bbytes = 16;
+  constexpr size_t HASHSIZE = 32;
+  using poly_vector_t = std::vector<P, nfl::aligned_allocator<P, 64>>;
+  using alice_t = alice_rot_batch_t<P, rbytes, bbytes, HASHSIZE, kappa>;
+  using bob_t = bob_rot_batch_t<P, rbytes, bbytes, HASHSIZE, kappa>;
+  using bench_clock = std::chrono::steady_clock;
+
+  size_t total = (argc > 1) ? strtoull(argv[1], nullptr, 10) : (1 << 22);
+  total = (total + chunk - 1) / chunk * chunk;
+
+  nfl::uniform unif;
+  nfl::FastGaussianNoise<uint8_t, P::value_type, 2> g_prng(sqrt((double)K/2.), 138, N);
+
+  std::unique_ptr<alice_t> alice(new alice_t(&g_prng));
+  std::unique_ptr<bob_t> bob(new bob_t(&g_prng));
+
+  poly_vector_t p0(kappa), pS(kappa);
+  std::vector<ke_t<P>::signal_t> signal0(kappa), signal1(kappa);
+  uint32_t sid[kappa];
+  uint8_t r_sid[kappa][sizeof(uint32_t) + rbytes];
+  uint8_t hS0[kappa][HASHSIZE], hS1[kappa][HASHSIZE];
+  uint8_t u[kappa][bbytes];
+  uint8_t hma0[kappa][HASHSIZE], hma1[kappa][HASHSIZE];
+  uint8_t S0[kappa][bbytes], S1[kappa][bbytes];
+  uint8_t M0[kappa][HASHSIZE], M1[kappa][HASHSIZE], Mb[kappa][HASHSIZE];
+  int b[kappa];
+  P m = unif;
+
+  for (size_t j = 0; j < kappa; j++)
+    sid[j] = j;
+
+  // Base ROTs
+  auto start = bench_clock::now();
+  alice->msg1(&p0[0], r_sid, hS0, hS1, sid, m);
+  bob->msg1(&pS[0], &signal0[0], &signal1[0], u, hma0, hma1,
+            sid, hS0, hS1, &p0[0], r_sid, m);
+  bool success = alice->msg2(Mb, b, S0, S1, sid, &pS[0],
+                             &signal0[0], &signal1[0], hma0, hma1, u);
+  success = success && bob->msg2(M0, M1, sid, S0, S1);
+  double base_s = std::chrono::duration<double>(bench_clock::now() - start).count();
+
+  if (!success)
+    {
+      std::cerr << "Base ROTs failed" << std::endl;
+      return 1;
+    }
+
+  std::unique_ptr<iknp_sender_t<kappa, msgbytes>> sender(new iknp_sender_t<kappa, msgbytes>);
+  std::unique_ptr<iknp_receiver_t<kappa, msgbytes>> receiver(new iknp_receiver_t<kappa, msgbytes>);
+  sender->set_base(b, Mb);
+  receiver->set_base(M0, M1);
+
+  std::vector<uint8_t> ucorr(kappa * chunk / 8), choice(chunk / 8);
+  std::vector<uint8_t> x0(chunk * msgbytes), x1(chunk * msgbytes), xr(chunk * msgbytes);
+  double sender_s = 0, receiver_s = 0;
+
+  for (size_t done = 0; done < total; done += chunk)
+    {
+      nfl::fastrandombytes(&choice[0], choice.size());
+
+      start = bench_clock::now();
+      receiver->extend(&ucorr[0], (uint8_t (*)[msgbytes])&xr[0], &choice[0], chunk);
+      auto mid = bench_clock::now();
+      sender->extend((uint8_t (*)[msgbytes])&x0[0], (uint8_t (*)[msgbytes])&x1[0],
+                     &ucorr[0], chunk);
+      auto end = bench_clock::now();
+
+      receiver_s += std::chrono::duration<double>(mid - start).count();
+      sender_s += std::chrono::duration<double>(end - mid).count();
+
+      for (size_t j = 0; j < chunk; j++)
+        {
+          int rj = (choice[j / 8] >> (j & 7)) & 1;
+          success = success &&
+            (memcmp(&xr[j * msgbytes], rj ? &x1[j * msgbytes] : &x0[j * msgbytes],
+                    msgbytes) == 0);
+        }
+    }
+
+  std::cout << "base ROTs:        " << kappa << " in " << base_s * 1e3 << " ms" << std::endl;
+  std::cout << "extended OTs:     " << total << std::endl;
+  std::cout << "receiver:         " << total / receiver_s << " OT/s" << std::endl;
+  std::cout << "sender:           " << total / sender_s << " OT/s" << std::endl;
+  std::cout << "correct:          " << (success ? "yes" : "no") << std::endl;
+
+  return success ? 0 : 1;
+}
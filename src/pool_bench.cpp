@@ -0,0 +1,103 @@
+/**
+@file
+
+Latency benchmark of the first ROT messages, computed entirely online
+(msg1) or with RLWE samples precomputed by background threads (msg1_online).
+Sessions are paced so that the producers keep up, as when they run in idle
+time between sessions. Without two spare cores, the pools are refilled from
+the main thread between sessions instead of by producer threads.
+
+Usage: pool_bench [number of sessions]
+*/
+#include "rlwerot.hpp"
+#include "rlwe_pool.hpp"
+#include "common_poly.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+#define N 512
+#define K 8
+
+int main(int argc, char *argv[])
+{
+  using P = nfl::poly_from_modulus<uint16_t, N, 14>;
+  constexpr size_t rbytes = 16;
+  constexpr size_t bbytes = 16;
+  constexpr size_t HASHSIZE = 32;
+  using signal_t = ke_t<P>::signal_t;
+  using bench_clock = std::chrono::steady_clock;
+  const double sigma = sqrt((double)K/2.);
+
+  size_t sessions = (argc > 1) ? strtoull(argv[1], nullptr, 10) : 10000;
+  bool background = std::thread::hardware_concurrency() > 2;
+
+  nfl::FastGaussianNoise<uint8_t, P::value_type, 2> g_prng(sigma, 138, N);
+  common_poly_cache_t<P> cache;
+  uint8_t seed[COMMON_POLY_SEEDBYTES];
+  common_poly_cache_t<P>::new_seed(seed);
+  const P &m = cache.get(seed);
+
+  rlwe_pool_t<P> alice_pool(m, sigma, 138, 64, background);
+  rlwe_pool_t<P> bob_pool(m, sigma, 138, 64, background);
+
+  uint8_t r_sid[sizeof(uint32_t) + rbytes], hS0[HASHSIZE], hS1[HASHSIZE];
+  uint8_t u[bbytes], hma0[HASHSIZE], hma1[HASHSIZE], S0[bbytes], S1[bbytes];
+  uint8_t msg0[HASHSIZE], msg1[HASHSIZE], msgb[HASHSIZE];
+  signal_t signal0, signal1;
+  P p0, pS;
+  int b;
+
+  bool success = true;
+  double offline_alice = 0, offline_bob = 0, online_alice = 0, online_bob = 0;
+  for (size_t i = 0; i < sessions; i++)
+    {
+      alice_rot_t<P, rbytes, bbytes, HASHSIZE> alice(&g_prng);
+      bob_rot_t<P, rbytes, bbytes, HASHSIZE> bob(&g_prng);
+
+      auto t0 = bench_clock::now();
+      alice.msg1(p0, r_sid, hS0, hS1, i, m);
+      auto t1 = bench_clock::now();
+      bob.msg1(pS, signal0, signal1, u, hma0, hma1, i, hS0, hS1, p0, r_sid, m);
+      auto t2 = bench_clock::now();
+      success &= alice.msg2(msgb, b, S0, S1, i, pS, signal0, signal1, hma0, hma1, u) &&
+        bob.msg2(msg0, msg1, i, S0, S1);
+
+      offline_alice += std::chrono::duration<double>(t1 - t0).count();
+      offline_bob += std::chrono::duration<double>(t2 - t1).count();
+
+      if (background)
+        {
+          alice_pool.wait_idle();
+          bob_pool.wait_idle();
+        }
+      else
+        {
+          alice_pool.refill();
+          bob_pool.refill();
+        }
+
+      t0 = bench_clock::now();
+      alice.msg1_online(p0, r_sid, hS0, hS1, i, alice_pool);
+      t1 = bench_clock::now();
+      bob.msg1_online(pS, signal0, signal1, u, hma0, hma1, i, hS0, hS1, p0, r_sid, bob_pool);
+      t2 = bench_clock::now();
+      success &= alice.msg2(msgb, b, S0, S1, i, pS, signal0, signal1, hma0, hma1, u) &&
+        bob.msg2(msg0, msg1, i, S0, S1);
+
+      online_alice += std::chrono::duration<double>(t1 - t0).count();
+      online_bob += std::chrono::duration<double>(t2 - t1).count();
+    }
+
+  std::cout << "precomputation:    " << (background ? "producer threads" : "refill()") << std::endl;
+  std::cout << "alice msg1:        " << 1e6 * offline_alice / sessions << " us" << std::endl;
+  std::cout << "alice msg1_online: " << 1e6 * online_alice / sessions << " us" << std::endl;
+  std::cout << "bob msg1:          " << 1e6 * offline_bob / sessions << " us" << std::endl;
+  std::cout << "bob msg1_online:   " << 1e6 * online_bob / sessions << " us" << std::endl;
+  std::cout << "pool misses:       " << alice_pool.misses + bob_pool.misses << std::endl;
+  std::cout << "correct:           " << (success ? "yes" : "no") << std::endl;
+
+  return success ? 0 : 1;
+}
@@ -0,0 +1,94 @@
+/**
+@file
+
+Benchmark of the stream ciphers behind nfl::fastrandombytes: keystream
+throughput of Salsa20, ChaCha20 (vectorised with the vector engine of the
+build) and AES-256-CTR (when the AES instructions are available), and the
+cost of the small requests of the protocol (single bits, masks, r_sid) and
+of uniform polynomials with the backend of the build.
+
+Usage: prng_bench [megabytes of keystream]
+*/
+#include "nfl.hpp"
+#include "nfl/prng/crypto_stream_salsa20.h"
+#include "nfl/prng/crypto_stream_chacha20.h"
+#include "nfl/prng/crypto_stream_aes256ctr.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#define N 512
+
+using bench_clock = std::chrono::steady_clock;
+typedef int (*crypto_stream_t)(unsigned char *, unsigned long long,
+			       const unsigned char *, const unsigned char *);
+
+/** Times a stream cipher on calls of the size of the PRNG buffer
+
+    @param stream Stream cipher
+    @param bytes Total keystream bytes
+    @return Bytes per second */
+static double bench_stream(crypto_stream_t stream, size_t bytes)
+{
+  std::vector<unsigned char> out(nfl::prng_ctx_t::BUFFERBYTES);
+  unsigned char key[nfl::prng_ctx_t::KEYBYTES], nonce[nfl::prng_ctx_t::NONCEBYTES] = {0};
+  const size_t calls = bytes / out.size();
+
+  nfl::fastrandombytes(key, sizeof(key));
+  auto start = bench_clock::now();
+  for (size_t i = 0; i < calls; i++)
+    {
+      nonce[0] = (unsigned char)i;
+      stream(&out[0], out.size(), nonce, key);
+    }
+  auto end = bench_clock::now();
+
+  return calls * out.size() / std::chrono::duration<double>(end - start).count();
+}
+
+/** Times fastrandombytes requests of a given size
+
+    @param rlen Request size
+    @param requests Number of requests
+    @return Seconds per request */
+static double bench_requests(size_t rlen, size_t requests)
+{
+  std::vector<unsigned char> out(rlen);
+  nfl::prng_ctx_t ctx;
+
+  auto start = bench_clock::now();
+  for (size_t i = 0; i < requests; i++)
+    nfl::fastrandombytes(ctx, &out[0], rlen);
+  auto end = bench_clock::now();
+
+  return std::chrono::duration<double>(end - start).count() / requests;
+}
+
+int main(int argc, char *argv[])
+{
+  using P = nfl::poly_from_modulus<uint16_t, N, 14>;
+  const size_t bytes = ((argc > 1) ? strtoull(argv[1], nullptr, 10) : 64) << 20;
+  const size_t requests = 100000;
+
+  std::cout << "salsa20:          " << bench_stream(nfl_crypto_stream_salsa20, bytes) / 1e6 << " MB/s" << std::endl;
+  std::cout << "chacha20:         " << bench_stream(nfl_crypto_stream_chacha20, bytes) / 1e6 << " MB/s" << std::endl;
+#ifdef NFL_HAVE_AES256CTR
+  std::cout << "aes256ctr:        " << bench_stream(nfl_crypto_stream_aes256ctr, bytes) / 1e6 << " MB/s" << std::endl;
+#endif
+
+  std::cout << "fastrandombytes (" << nfl::fastrandombytes_backend() << "):" << std::endl;
+  std::cout << "  1 byte:         " << bench_requests(1, requests) * 1e9 << " ns" << std::endl;
+  std::cout << "  16 bytes:       " << bench_requests(16, requests) * 1e9 << " ns" << std::endl;
+  std::cout << "  64 bytes:       " << bench_requests(64, requests) * 1e9 << " ns" << std::endl;
+
+  P p;
+  auto start = bench_clock::now();
+  for (size_t i = 0; i < requests / 10; i++)
+    p.set(nfl::uniform());
+  auto end = bench_clock::now();
+  std::cout << "  uniform poly:   " << std::chrono::duration<double>(end - start).count() / (requests / 10) * 1e6
+	    << " us" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,69 @@
+/**
+@file
+
+Scaling benchmark of the work-stealing session executor: runs the same
+number of sessions per thread for 1, 2, 4, ... up to the requested number
+of threads and reports total and per-core throughput.
+
+Usage: rot_scaling [max threads] [sessions per thread] [rot|ot]
+*/
+#include "rot_executor.hpp"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#define N 512
+#define K 8
+
+int main(int argc, char *argv[])
+{
+  using P = nfl::poly_from_modulus<uint16_t, N, 14>;
+  constexpr size_t rbytes = 16;
+  constexpr size_t bbytes = 16;
+  constexpr size_t HASHSIZE = 32;
+  using executor_t = rot_executor_t<P>;
+
+  size_t max_threads = (argc > 1) ? strtoull(argv[1], nullptr, 10) :
+    std::thread::hardware_concurrency();
+  size_t per_thread = (argc > 2) ? strtoull(argv[2], nullptr, 10) : 2000;
+  bool ot = (argc > 3) && (strcmp(argv[3], "ot") == 0);
+  if (max_threads == 0)
+    max_threads = 1;
+
+  uint8_t seed[COMMON_POLY_SEEDBYTES];
+  common_poly_cache_t<P>::new_seed(seed);
+
+  executor_t::task_t task;
+  if (ot)
+    task = ot_session_t<P, rbytes, bbytes>(seed);
+  else
+    task = rot_session_t<P, rbytes, bbytes, HASHSIZE>(seed);
+
+  std::cout << (ot ? "OT" : "ROT") << " sessions, " << per_thread
+            << " per thread" << std::endl;
+  std::cout << "threads\tsessions/s\tper core\tefficiency" << std::endl;
+
+  double base = 0;
+  size_t failures = 0;
+  for (size_t t = 1; t <= max_threads; t = (t * 2 > max_threads && t < max_threads) ? max_threads : t * 2)
+    {
+      executor_t executor(t, sqrt((double)K/2.));
+      failures += executor.run(0, t * per_thread, task);
+
+      double total = executor.throughput();
+      if (t == 1)
+        base = total;
+
+      std::cout << t << "\t" << total << "\t" << total / t << "\t"
+                << (base > 0 ? total / (base * t) : 0) << std::endl;
+      if (t == max_threads)
+        executor.report(std::cout);
+    }
+
+  if (failures)
+    std::cerr << failures << " sessions failed" << std::endl;
+
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,102 @@
+/**
+@file
+
+Startup benchmark of the Gaussian sampler: building its lookup tables with
+MPFR, against loading the tables generated at build time (gaussian_tables.h)
+and mapping them from a file. Checks that the three samplers draw the same
+noise from equally seeded contexts.
+
+Usage: startup_bench [number of loads]
+*/
+#include "nfl.hpp"
+#include "gaussian_tables.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define N 512
+#define K 8
+
+int main(int argc, char *argv[])
+{
+  using P = nfl::poly_from_modulus<uint16_t, N, 14>;
+  using sampler_t = nfl::FastGaussianNoise<uint8_t, P::value_type, 2>;
+  using bench_clock = std::chrono::steady_clock;
+  const size_t loads = (argc > 1) ? strtoull(argv[1], nullptr, 10) : 1000;
+  const size_t builds = 10;
+  const char *path = "gaussian_tables.bin";
+
+  double build_s = 0, load_s = 0, map_s = 0;
+  for (size_t i = 0; i < builds; i++)
+    {
+      auto start = bench_clock::now();
+      sampler_t g_prng(sqrt((double)K/2.), 138, N);
+      build_s += std::chrono::duration<double>(bench_clock::now() - start).count();
+    }
+
+  for (size_t i = 0; i < loads; i++)
+    {
+      auto start = bench_clock::now();
+      sampler_t g_prng(gaussian_tables_blob, gaussian_tables_size);
+      load_s += std::chrono::duration<double>(bench_clock::now() - start).count();
+    }
+
+  FILE *f = fopen(path, "wb");
+  if (f == nullptr || fwrite(gaussian_tables_blob, 1, gaussian_tables_size, f) != gaussian_tables_size)
+    {
+      std::cerr << "Could not write " << path << std::endl;
+      return 1;
+    }
+  fclose(f);
+  for (size_t i = 0; i < loads; i++)
+    {
+      auto start = bench_clock::now();
+      int fd = open(path, O_RDONLY);
+      struct stat st;
+      fstat(fd, &st);
+      void *blob = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      sampler_t g_prng(blob, st.st_size);
+      munmap(blob, st.st_size);
+      close(fd);
+      map_s += std::chrono::duration<double>(bench_clock::now() - start).count();
+    }
+
+  // The three samplers draw the same noise
+  sampler_t built(sqrt((double)K/2.), 138, N), loaded(gaussian_tables_blob, gaussian_tables_size);
+  int fd = open(path, O_RDONLY);
+  void *blob = mmap(nullptr, gaussian_tables_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  sampler_t mapped(blob, gaussian_tables_size);
+  munmap(blob, gaussian_tables_size);
+  close(fd);
+  unlink(path);
+
+  uint8_t key[nfl::prng_ctx_t::KEYBYTES];
+  nfl::fastrandombytes(key, sizeof(key));
+  nfl::prng_ctx_t ctx0, ctx1, ctx2;
+  ctx0.seed(key);
+  ctx1.seed(key);
+  ctx2.seed(key);
+  bool success = true;
+  for (size_t i = 0; i < 64; i++)
+    {
+      P e0 = nfl::gaussian<uint8_t, P::value_type, 2>(&built, 1, &ctx0);
+      P e1 = nfl::gaussian<uint8_t, P::value_type, 2>(&loaded, 1, &ctx1);
+      P e2 = nfl::gaussian<uint8_t, P::value_type, 2>(&mapped, 1, &ctx2);
+      success = success && (e0 == e1) && (e0 == e2);
+    }
+
+  std::cout << "tables:           " << gaussian_tables_size << " bytes" << std::endl;
+  std::cout << "MPFR build:       " << build_s / builds * 1e6 << " us" << std::endl;
+  std::cout << "embedded load:    " << load_s / loads * 1e6 << " us" << std::endl;
+  std::cout << "mapped file load: " << map_s / loads * 1e6 << " us" << std::endl;
+  std::cout << "same noise:       " << (success ? "yes" : "NO") << std::endl;
+
+  return success ? 0 : 1;
+}
@@ -0,0 +1,127 @@
+/**
+@file
+
+Benchmark of the cipher policies of sym_enc_t: AES-CBC (AES-NI when
+available, OpenSSL otherwise) against the BLAKE3 stream cipher, alone and
+within complete OT sessions. Meant to be run on the SERIAL and NEON builds
+of hosts without AES instructions as well as on x86.
+
+Usage: symenc_bench [number of OT sessions]
+*/
+#include "rlweot.hpp"
+#include "common_poly.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+#define N 512
+#define K 8
+
+using P = nfl::poly_from_modulus<uint16_t, N, 14>;
+constexpr size_t rbytes = 16;
+constexpr size_t bbytes = 16;
+using bench_clock = std::chrono::steady_clock;
+
+/** Times encryptions and decryptions of OT-sized messages
+
+    @param iterations Number of encryption/decryption pairs
+    @param success Cleared when a decryption fails
+    @return Seconds per pair
+    @tparam cipher_policy_t Cipher policy of sym_enc_t */
+template<template<size_t, size_t, size_t> class cipher_policy_t>
+double bench_cipher(size_t iterations, bool &success)
+{
+  sym_enc_t<rbytes, rbytes, bbytes, cipher_policy_t> enc;
+  typename sym_enc_t<rbytes, rbytes, bbytes, cipher_policy_t>::cipher_t c;
+  uint8_t in[rbytes], r[rbytes], key[bbytes], out[rbytes];
+
+  nfl::fastrandombytes(in, sizeof(in));
+  nfl::fastrandombytes(r, sizeof(r));
+  nfl::fastrandombytes(key, sizeof(key));
+
+  auto start = bench_clock::now();
+  for (size_t i = 0; i < iterations; i++)
+    {
+      // A fresh key every time, as in the OT
+      key[i % bbytes] ^= (uint8_t)i;
+      enc.SEnc(c, in, r, key);
+      enc.SDec(out, c, key);
+    }
+  auto end = bench_clock::now();
+
+  success = success && (memcmp(in, out, rbytes) == 0);
+  return std::chrono::duration<double>(end - start).count() / iterations;
+}
+
+/** Times complete OT sessions
+
+    @param sessions Number of sessions
+    @param m Common polynomial
+    @param g_prng Gaussian Noise sampler
+    @param success Cleared when a session fails
+    @return Seconds per session
+    @tparam cipher_policy_t Cipher policy of sym_enc_t */
+template<template<size_t, size_t, size_t> class cipher_policy_t>
+double bench_ot(size_t sessions, const P &m,
+		nfl::FastGaussianNoise<uint8_t, P::value_type, 2> *g_prng, bool &success)
+{
+  using alice_t = alice_ot_t<P, rbytes, bbytes, cipher_policy_t>;
+  using bob_t = bob_ot_t<P, rbytes, bbytes, cipher_policy_t>;
+  typename bob_t::cipher_t a0, a1, c0, c1;
+  typename ke_t<P>::signal_t signal0, signal1;
+  uint8_t r_sid[sizeof(uint32_t) + rbytes], u0[2*rbytes + bbytes], u1[2*rbytes + bbytes];
+  uint8_t ch[rbytes], msg0[rbytes], msg1[rbytes], msgb[rbytes];
+  P p0, pS;
+
+  nfl::fastrandombytes(msg0, rbytes);
+  nfl::fastrandombytes(msg1, rbytes);
+
+  auto start = bench_clock::now();
+  for (size_t i = 0; i < sessions; i++)
+    {
+      alice_t alice(g_prng);
+      bob_t bob(g_prng);
+      int b = i & 1;
+
+      alice.msg1(p0, r_sid, b, i, m);
+      bob.msg1(pS, signal0, signal1, u0, u1, a0, a1, i, p0, r_sid, m);
+      success &= alice.msg2(ch, i, pS, signal0, signal1, a0, a1, u0, u1) &&
+	bob.msg2(c0, c1, ch, msg0, msg1);
+      alice.msg3(msgb, c0, c1);
+      success &= memcmp(msgb, b ? msg1 : msg0, rbytes) == 0;
+    }
+  auto end = bench_clock::now();
+
+  return std::chrono::duration<double>(end - start).count() / sessions;
+}
+
+int main(int argc, char *argv[])
+{
+  size_t sessions = (argc > 1) ? strtoull(argv[1], nullptr, 10) : 2000;
+  size_t iterations = 500 * sessions;
+
+  nfl::FastGaussianNoise<uint8_t, P::value_type, 2> g_prng(sqrt((double)K/2.), 138, N);
+  common_poly_cache_t<P> cache;
+  uint8_t seed[COMMON_POLY_SEEDBYTES];
+  common_poly_cache_t<P>::new_seed(seed);
+  const P &m = cache.get(seed);
+
+  bool success = true;
+  double aes = bench_cipher<aes_cbc_t>(iterations, success);
+  double stream = bench_cipher<blake3_stream_t>(iterations, success);
+  double aes_ot = bench_ot<aes_cbc_t>(sessions, m, &g_prng, success);
+  double stream_ot = bench_ot<blake3_stream_t>(sessions, m, &g_prng, success);
+
+  std::cout << "AES-NI:                    " << (aes_cbc_t<rbytes, rbytes, bbytes>::aesni() ? "yes" : "no") << std::endl;
+  std::cout << "aes_cbc_t SEnc+SDec:       " << 1e9 * aes << " ns" << std::endl;
+  std::cout << "blake3_stream_t SEnc+SDec: " << 1e9 * stream << " ns" << std::endl;
+  std::cout << "aes_cbc_t OT:              " << 1e6 * aes_ot << " us" << std::endl;
+  std::cout << "blake3_stream_t OT:        " << 1e6 * stream_ot << " us" << std::endl;
+  std::cout << "ciphertext bytes:          " << sizeof(aes_cbc_t<rbytes + 4, rbytes, bbytes>::cipher_t().buf)
+	    << " (AES-CBC) / " << sizeof(blake3_stream_t<rbytes + 4, rbytes, bbytes>::cipher_t().buf)
+	    << " (BLAKE3) for " << rbytes + 4 << "-byte messages" << std::endl;
+  std::cout << "correct:                   " << (success ? "yes" : "no") << std::endl;
+
+  return success ? 0 : 1;
+}
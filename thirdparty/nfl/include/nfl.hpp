@@ -16,5 +16,6 @@
 
 #include "nfl/poly.hpp"
 #include "nfl/poly_p.hpp"
+#include "nfl/poly_batch.hpp"
 
 #endif
@@ -2,6 +2,7 @@
 #define NFL_ALGOS_HPP
 
 #include <nfl/arch/common.hpp>
+#include <algorithm>
 
 namespace nfl {
 
@@ -72,6 +73,418 @@ struct ntt_loop<simd::serial, poly, T>
   }
 };
 
+//
+// INVERSE NTT
+//
+// Gentleman-Sande inverse of the NTT above, from its bit-reversed output to
+// coefficients in natural order. The butterflies of a block of span len all
+// share the twiddle factor phi**-brv(degree / (2 * len) + block), so that
+// multiplying by the invphi powers is merged into the transform. The last
+// layer multiplies by invK: through its twiddle factor for the second half,
+// with a final pass over the first half. Each span goes through the body of
+// the widest of the SIMD modes (widest first) whose vectors it fills, or
+// through the serial body.
+//
+// Table layout (see prep()): the spans from degree/2 down to 1, each twiddle
+// factor repeated as many times as the body has lanes so that it can load it
+// as a vector, then invK. Spans are stored by decreasing size, which keeps
+// every vector aligned.
+
+template <class SIMD, class poly, class T=typename poly::value_type>
+struct inv_ntt_loop;
+
+template <class poly, class... SIMD>
+struct inv_ntt_level;
+
+template <class poly>
+struct inv_ntt_level<poly>
+{
+  using value_type = typename poly::value_type;
+
+  static constexpr size_t lanes(size_t) { return 1; }
+
+  template <size_t len>
+  static void run(value_type* x, const value_type* wtab, const value_type* winvtab, const value_type p) {
+    ntt_loop_body<simd::serial, poly, value_type> body(p);
+    for (size_t r = 0; r < poly::degree / (2 * len); r++, wtab++, winvtab++) {
+      for (size_t i = 0; i < len; i++) {
+        body(&x[2 * len * r + i], &x[2 * len * r + i + len], winvtab, wtab);
+      }
+    }
+  }
+};
+
+template <class poly, class S, class... SIMD>
+struct inv_ntt_level<poly, S, SIMD...>
+{
+  using value_type = typename poly::value_type;
+  static constexpr size_t width = S::template elt_count<value_type>::value;
+
+  static constexpr size_t lanes(size_t len) { return len >= width ? width : inv_ntt_level<poly, SIMD...>::lanes(len); }
+
+  template <size_t len>
+  static void run(value_type* x, const value_type* wtab, const value_type* winvtab, const value_type p) {
+    if (len < width) {
+      inv_ntt_level<poly, SIMD...>::template run<len>(x, wtab, winvtab, p);
+      return;
+    }
+    ntt_loop_body<S, poly, value_type> body(p);
+    for (size_t r = 0; r < poly::degree / (2 * len); r++, wtab += width, winvtab += width) {
+      for (size_t i = 0; i < len; i += width) {
+        body(&x[2 * len * r + i], &x[2 * len * r + i + len], winvtab, wtab);
+      }
+    }
+  }
+};
+
+template <class poly, class... SIMD>
+struct inv_ntt_loop_unrolled
+{
+  using value_type = typename poly::value_type;
+  using greater_value_type = typename poly::greater_value_type;
+  using level = inv_ntt_level<poly, SIMD...>;
+
+  static constexpr size_t degree = poly::degree;
+
+  // Number of table entries for the spans in [len, degree)
+  static constexpr size_t levels_size(size_t len)
+  {
+    return len >= degree ? 0 : degree / (2 * len) * level::lanes(len) + levels_size(2 * len);
+  }
+
+  // Number of table entries
+  static constexpr size_t size()
+  {
+    return degree < 2 ? 0 : levels_size(1) + 1;
+  }
+
+  // Spans from len to degree/2, reading the table backwards from offset
+  template <size_t len, bool = (len < degree)>
+  struct levels {
+    static void run(value_type* x, const value_type* wtab, const value_type* winvtab, size_t offset, const value_type p) {
+      offset -= degree / (2 * len) * level::lanes(len);
+      level::template run<len>(x, wtab + offset, winvtab + offset, p);
+      levels<2 * len>::run(x, wtab, winvtab, offset, p);
+    }
+  };
+
+  template <size_t len>
+  struct levels<len, false> {
+    static void run(value_type*, const value_type*, const value_type*, size_t, const value_type) {}
+  };
+
+  // x * y lazymod p, lower than 2p for x lower than 2**kModulusRepresentationBitsize
+  static inline value_type mulmod_shoup(value_type x, value_type y, value_type yprime, value_type p)
+  {
+    value_type q = ((greater_value_type) x * yprime) >> params<value_type>::kModulusRepresentationBitsize;
+    return (greater_value_type) x * y - (greater_value_type) q * p;
+  }
+
+  // x must hold values lower than 2p, they are returned lower than 2p
+  static void run(value_type* x, const value_type* wtab, const value_type* winvtab, const value_type p)
+  {
+    const value_type invK = wtab[levels_size(1)], invKprime = winvtab[levels_size(1)];
+
+    levels<1>::run(x, wtab, winvtab, levels_size(1), p);
+
+    for (size_t i = 0; i < degree / 2; i++) {
+      x[i] = mulmod_shoup(x[i], invK, invKprime, p);
+    }
+  }
+
+  // Fills wtab and its Shoup counterpart wtabshoup with the twiddle factors
+  // phi**-brv(k) (tw(k) must return them) and invK
+  template <class Twiddle>
+  static void prep(value_type* wtab, value_type* wtabshoup, Twiddle tw, value_type const invK, value_type const p)
+  {
+    const size_t log_degree = static_log2<degree>::value;
+    auto brv = [log_degree](size_t k) {
+      size_t r = 0;
+      for (size_t b = 0; b < log_degree; b++, k >>= 1)
+        r = (r << 1) | (k & 1);
+      return r;
+    };
+    size_t j = 0;
+    auto push = [&j, wtab, wtabshoup, p](value_type w) {
+      wtab[j] = w;
+      wtabshoup[j++] = ((greater_value_type) w << params<value_type>::kModulusRepresentationBitsize) / p;
+    };
+
+    if (degree < 2)
+      return;
+
+    for (size_t len = degree / 2; len >= 1; len >>= 1) {
+      const size_t M = degree / (2 * len);
+      for (size_t k = M; k < 2 * M; k++) {
+        const value_type w = (M == 1) ? ((greater_value_type) tw(brv(k)) * invK) % p : tw(brv(k));
+        for (size_t i = 0; i < level::lanes(len); i++)
+          push(w);
+      }
+    }
+    push(invK);
+  }
+};
+
+template <class poly, class T>
+struct inv_ntt_loop<simd::serial, poly, T>: public inv_ntt_loop_unrolled<poly>
+{ };
+
+//
+// REGISTER-RESIDENT NTT
+//
+// Forward and inverse transforms of a whole polynomial (one modulus) for the
+// SIMD modes and sizes where it fits in a few vector registers. They replace
+// ntt_pow_phi and invntt_pow_invphi (with their phi/invphi multiplications)
+// and give the same results, without memory round-trips between layers:
+// - the forward transform uses Cooley-Tukey butterflies with the twiddle
+// factor phi**brv(degree / (2 * len) + block), the inverse transform the
+// Gentleman-Sande butterflies of inv_ntt_loop;
+// - spans of at least a vector are butterflies between registers, with
+// broadcast twiddle factors;
+// - for smaller spans, each pair of registers is transposed by blocks of
+// span lanes so that the butterflies are again between registers. After the
+// last transposition the registers hold the even and odd coefficients.
+//
+// Table layout (see ntt_kernel_tables): the twiddle factors of the spans of
+// at least a vector indexed by degree / (2 * len) + block (index 0 holds
+// invK for the inverse transform), then one vector per pair of registers
+// for each smaller span, in the order the transform goes through them.
+
+template <class SIMD, class T, size_t Degree>
+struct ntt_kernel
+{
+  using value_type = T;
+
+  static constexpr bool enabled = false;
+  static constexpr size_t size = 0;
+
+  template <class Twiddle>
+  static void prep_ntt(value_type*, value_type*, Twiddle, value_type const) {}
+  template <class Twiddle>
+  static void prep_inv_ntt(value_type*, value_type*, Twiddle, value_type const, value_type const) {}
+  static void ntt(value_type*, const value_type*, const value_type*, value_type const) {}
+  static void inv_ntt(value_type*, const value_type*, const value_type*, value_type const) {}
+};
+
+template <class T, size_t Degree, size_t Lanes>
+struct ntt_kernel_tables
+{
+  using value_type = T;
+  using greater_value_type = typename params<T>::greater_value_type;
+
+  static constexpr size_t degree = Degree;
+  static constexpr size_t lanes = Lanes;
+
+  // Broadcast twiddle factors, padded to keep the vectors 64-byte aligned
+  static constexpr size_t scalars = (degree / lanes > 64 / sizeof(T)) ? degree / lanes : 64 / sizeof(T);
+
+  // Number of table entries
+  static constexpr size_t size = scalars + static_log2<lanes>::value * degree / 2;
+
+  // Coefficient held by each lane of a pair of registers (initially
+  // coefficients 0 to 2 * lanes - 1) once transposed for the spans from
+  // lanes/2 down to span
+  static void layout(size_t (&x)[2 * lanes], size_t span)
+  {
+    size_t y[2 * lanes];
+    for (size_t i = 0; i < 2 * lanes; i++)
+      x[i] = i;
+    for (size_t s = lanes / 2; s >= span; s >>= 1) {
+      for (size_t m = 0; m < lanes / (2 * s); m++) {
+        for (size_t i = 0; i < s; i++) {
+          y[2 * m * s + i] = x[2 * m * s + i];
+          y[(2 * m + 1) * s + i] = x[lanes + 2 * m * s + i];
+          y[lanes + 2 * m * s + i] = x[(2 * m + 1) * s + i];
+          y[lanes + (2 * m + 1) * s + i] = x[lanes + (2 * m + 1) * s + i];
+        }
+      }
+      std::copy(y, y + 2 * lanes, x);
+    }
+  }
+
+  static size_t brv(size_t k)
+  {
+    size_t r = 0;
+    for (size_t b = 0; b < static_log2<degree>::value; b++, k >>= 1)
+      r = (r << 1) | (k & 1);
+    return r;
+  }
+
+  // Fills the table of the spans smaller than a vector, from lanes/2 down
+  // to 1 for the forward transform, the other way round otherwise
+  template <class Twiddle>
+  static void prep_vectors(value_type* wtab, Twiddle tw, bool forward)
+  {
+    for (size_t n = 0; n < static_log2<lanes>::value; n++) {
+      const size_t len = forward ? (lanes / 2) >> n : size_t(1) << n;
+      size_t x[2 * lanes];
+      layout(x, len);
+      for (size_t r = 0; r < degree / (2 * lanes); r++)
+        for (size_t i = 0; i < lanes; i++)
+          *wtab++ = tw(brv(degree / (2 * len) + (2 * lanes * r + x[i]) / (2 * len)));
+    }
+  }
+
+  static void prep_shoup(const value_type* wtab, value_type* wtabshoup, value_type const p)
+  {
+    for (size_t i = 0; i < size; i++)
+      wtabshoup[i] = ((greater_value_type) wtab[i] << params<T>::kModulusRepresentationBitsize) / p;
+  }
+
+  // Fills wtab and its Shoup counterpart wtabshoup for the forward
+  // transform, tw(k) must return phi**k
+  template <class Twiddle>
+  static void prep_ntt(value_type* wtab, value_type* wtabshoup, Twiddle tw, value_type const p)
+  {
+    std::fill(wtab, wtab + scalars, 0);
+    for (size_t k = 1; k < degree / lanes; k++)
+      wtab[k] = tw(brv(k));
+    prep_vectors(wtab + scalars, tw, true);
+    prep_shoup(wtab, wtabshoup, p);
+  }
+
+  // Same for the inverse transform, tw(k) must return invphi**k
+  template <class Twiddle>
+  static void prep_inv_ntt(value_type* wtab, value_type* wtabshoup, Twiddle tw, value_type const invK, value_type const p)
+  {
+    std::fill(wtab, wtab + scalars, 0);
+    wtab[0] = invK;
+    for (size_t k = 1; k < degree / lanes; k++)
+      wtab[k] = (k == 1) ? ((greater_value_type) tw(brv(k)) * invK) % p : tw(brv(k));
+    prep_vectors(wtab + scalars, tw, false);
+    prep_shoup(wtab, wtabshoup, p);
+  }
+};
+
+//
+// RECONCILIATION
+//
+// Hint signal and robust extractor of the [DXL12] key exchange, over
+// coefficients in [0, p) with p odd. Signals and keys are packed one bit per
+// coefficient, coefficient i in bit (i & 7) of byte i / 8.
+// signal: 1 iff the centred representative of x is outside [-bound, bound],
+// i.e. iff bound < x < p - bound.
+// mod2: parity of the centred representative of y = x + sig * (p-1)/2 mod p,
+// i.e. (y & 1) ^ (y > (p-1)/2) as subtracting p flips the parity.
+// Bodies handle elt_count coefficients, i.e. elt_count bits of the signal
+// and of the key.
+
+template <class SIMD, class T>
+struct signal_body;
+
+template <class SIMD, class T>
+struct mod2_body;
+
+// True when every modulus of params<T> is below 2^bits, for the vector
+// bodies whose signed comparisons need some headroom above p
+template <class T>
+constexpr bool moduli_below(unsigned bits, unsigned i = 0)
+{
+  return i == params<T>::kMaxNbModuli ||
+    ((params<T>::P[i] >> bits) == 0 && moduli_below<T>(bits, i + 1));
+}
+
+template <class T>
+struct signal_body<simd::serial, T>
+{
+  using value_type = T;
+  using simd_type = simd::serial;
+
+  signal_body(value_type const p, value_type const bound)
+  {
+    _bound = bound;
+    _pmbound = p - bound;
+  }
+
+  inline uint64_t operator()(value_type const* x) const
+  {
+    return (*x > _bound) & (*x < _pmbound);
+  }
+
+  value_type _bound;
+  value_type _pmbound;
+};
+
+template <class T>
+struct mod2_body<simd::serial, T>
+{
+  using value_type = T;
+  using simd_type = simd::serial;
+
+  mod2_body(value_type const p)
+  {
+    _p = p;
+    _pov2 = p / 2;
+  }
+
+  inline uint64_t operator()(value_type const* x, uint64_t const sig) const
+  {
+    value_type y = *x + (((value_type)0 - (value_type)(sig & 1)) & _pov2);
+    y -= ((value_type)0 - (value_type)(y >= _p)) & _p;
+    return (y & 1) ^ (uint64_t)(y > _pov2);
+  }
+
+  value_type _p;
+  value_type _pov2;
+};
+
+template <class SIMD, class T>
+struct signal_loop
+{
+  static void run(uint8_t* sig, T const* x, size_t n, T const p, T const bound)
+  {
+    using body_type = signal_body<SIMD, T>;
+    constexpr size_t elt_count = body_type::simd_type::template elt_count<T>::value;
+    body_type body(p, bound);
+    signal_body<simd::serial, T> tail(p, bound);
+
+    size_t i = 0;
+    if (elt_count >= 8) {
+      for (; i + elt_count <= n; i += elt_count) {
+        const uint64_t bits = body(&x[i]);
+        for (size_t j = 0; j < elt_count / 8; j++)
+          sig[i / 8 + j] = (uint8_t)(bits >> (8 * j));
+      }
+    }
+    for (; i < n; i += 8) {
+      uint8_t byte = 0;
+      for (size_t j = 0; j < 8 && i + j < n; j++)
+        byte |= (uint8_t)(tail(&x[i + j]) << j);
+      sig[i / 8] = byte;
+    }
+  }
+};
+
+template <class SIMD, class T>
+struct mod2_loop
+{
+  static void run(uint8_t* sk, T const* x, uint8_t const* sig, size_t n, T const p)
+  {
+    using body_type = mod2_body<SIMD, T>;
+    constexpr size_t elt_count = body_type::simd_type::template elt_count<T>::value;
+    body_type body(p);
+    mod2_body<simd::serial, T> tail(p);
+
+    size_t i = 0;
+    if (elt_count >= 8) {
+      for (; i + elt_count <= n; i += elt_count) {
+        uint64_t bits = 0;
+        for (size_t j = 0; j < elt_count / 8; j++)
+          bits |= (uint64_t)sig[i / 8 + j] << (8 * j);
+        bits = body(&x[i], bits);
+        for (size_t j = 0; j < elt_count / 8; j++)
+          sk[i / 8 + j] = (uint8_t)(bits >> (8 * j));
+      }
+    }
+    for (; i < n; i += 8) {
+      uint8_t byte = 0;
+      for (size_t j = 0; j < 8 && i + j < n; j++)
+        byte |= (uint8_t)(tail(&x[i + j], sig[i / 8] >> j) << j);
+      sk[i / 8] = byte;
+    }
+  }
+};
+
 } // ops
 
 } // nfl
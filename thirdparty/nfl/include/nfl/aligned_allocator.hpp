@@ -6,6 +6,9 @@
  * http://jmabille.github.io/blog/2014/12/06/aligned-memory-allocator/
  */
 
+#ifndef NFL_ALIGNED_ALLOCATOR_HPP
+#define NFL_ALIGNED_ALLOCATOR_HPP
+
 namespace nfl {
 
 namespace detail {
@@ -119,3 +122,5 @@ inline void aligned_allocator<T, N>::deallocate(pointer p, size_type) {
 }
 
 }
+
+#endif
@@ -6,11 +6,11 @@
 #include <numeric>
 #include <algorithm>
 #include <stdio.h>
+#include <cstring>
 
 #include "nfl/poly.hpp"
 #include "nfl/ops.hpp"
 #include "nfl/algos.hpp"
-#include "nfl/permut.hpp"
 #include <type_traits>
 
 namespace nfl {
@@ -294,26 +294,20 @@ void poly<T, Degree, NbModuli>::set(gaussian<in_class, T, _lu_depth> const& mode
   // CRITICAL: the object must be 32-bytes aligned to avoid vectorization issues
   assert((unsigned long)(this->_data) % 32 == 0);
 
-  uint64_t const amplifier = mode.amplifier;
+  signed_value_type const amplifier = mode.amplifier;
 
-  // We play with the rnd pointer (in the uniform case), and thus
-  // we need to remember the allocated pointer to free it at the end
-  signed_value_type rnd[degree];
+  // Sample into the first modulus' coefficients, then map the signed
+  // values to each modulus, the first one last as it holds them
+  mode.fg_prng->getNoise(*mode.ctx, _data, degree);
 
-  // Get some randomness from the PRNG
-  mode.fg_prng->getNoise((value_type *)rnd, degree);
-
-  if (amplifier != 1) for (unsigned int i = 0; i < degree; i++) rnd[i]*= amplifier;
-  for (size_t cm = 0; cm < nmoduli; cm++)
+  for (size_t cm = nmoduli; cm-- > 0;)
   {
+    value_type const p = get_modulus(cm);
     for (size_t i = 0 ; i < degree; i++)
     {
-      if(rnd[i]<0)
-        _data[degree*cm+i] = get_modulus(cm) + rnd[i];
-      else
-        _data[degree*cm+i] = rnd[i];
+      signed_value_type const v = (signed_value_type)_data[i] * amplifier;
+      _data[degree*cm+i] = v < 0 ? p + v : v;
     }
-    //memcpy(_data+degree*cm, rnd, degree*sizeof(value_type));
   }
 
 
@@ -326,6 +320,57 @@ void poly<T, Degree, NbModuli>::set(gaussian<in_class, T, _lu_depth> const& mode
 #endif
 }
 
+template<class T, size_t Degree, size_t NbModuli>
+template<unsigned K>
+poly<T, Degree, NbModuli>::poly(cbd<K> const& mode) {
+  set(mode);
+}
+
+template<class T, size_t Degree, size_t NbModuli>
+template<unsigned K>
+void poly<T, Degree, NbModuli>::set(cbd<K> const& mode) {
+  static_assert(degree % 4 == 0, "cbd: the degree must be a multiple of 4");
+
+  // Two bytes of randomness per coefficient, of which K bits each are used
+  uint16_t rnd[degree];
+  fastrandombytes(*mode.ctx, (unsigned char *)rnd, sizeof(rnd));
+
+  // Bit-sliced popcounts, four coefficients per 64-bit word (so that the
+  // loop vectorises): each byte is replaced by its popcount, then each
+  // 16-bit lane by K + popcount(low byte) - popcount(high byte)
+  constexpr uint64_t bytes = 0x0101010101010101ULL;
+  constexpr uint64_t lanes = 0x0001000100010001ULL;
+  for (size_t j = 0; j < degree; j += 4) {
+    uint64_t x;
+    memcpy(&x, rnd + j, sizeof(x));
+    x &= ((1ULL << K) - 1) * bytes;
+    x -= (x >> 1) & (0x55 * bytes);
+    x = (x & (0x33 * bytes)) + ((x >> 2) & (0x33 * bytes));
+    x = (x + (x >> 4)) & (0x0f * bytes);
+    x = (x & (0xff * lanes)) + K * lanes - ((x >> 8) & (0xff * lanes));
+    memcpy(rnd + j, &x, sizeof(x));
+  }
+
+  signed_value_type const amplifier = mode.amplifier;
+  for (size_t cm = 0; cm < nmoduli; cm++)
+  {
+    value_type const p = get_modulus(cm);
+    for (size_t i = 0; i < degree; i++)
+    {
+      signed_value_type const v = ((signed_value_type)rnd[i] - (signed_value_type)K) * amplifier;
+      _data[degree*cm+i] = v < 0 ? p + v : v;
+    }
+  }
+
+#ifdef CHECK_STRICTMOD
+  for (size_t cm = 0; cm < nmoduli; cm++) {
+    for (size_t i = 0; i < degree; i++) {
+      assert(_data[i + degree * cm] < get_modulus(cm));
+    }
+  }
+#endif
+}
+
 template<class T, size_t Degree, size_t NbModuli>
 poly<T, Degree, NbModuli>::poly(ZO_dist const& mode) {
   set(mode);
@@ -533,31 +578,34 @@ template<class T, size_t Degree, size_t NbModuli> bool poly<T, Degree, NbModuli>
 }
 
 
-// Inverse NTT: replaces NTT values representation by the classic
-// coefficient representation, parameters are the same as for ntt() with
-// inv_wtab, inv_winvtab tables for the inverse operation and invK the
-// inverse of the polynomialDegree
+// Inverse NTT: replaces the NTT values representation output by ntt_pow_phi
+// (in bit-reversed order) by the classic coefficient representation,
+// including the multiplications by invK and the invphi powers, which are
+// folded into the inv_wtab, inv_winvtab tables of ops::inv_ntt_loop
+// (Gentleman-Sande butterflies, no bit-reversal permutations)
 template<class T, size_t Degree, size_t NbModuli> inline bool poly<T, Degree, NbModuli>::core::inv_ntt(value_type * x, const value_type* const inv_wtab, const value_type* const inv_winvtab,
-    const value_type invK, value_type const p)
+    value_type const p)
 {
-#ifdef __LP64__
-  alignas(64) value_type y[degree+1];
-#else
-  alignas(32) value_type y[degree+1];
+#ifdef CHECK_STRICTMOD
+  for (size_t i = 0 ; i < degree ; i++)
+  {
+    ASSERT_STRICTMOD(x[i] < p);
+  }
 #endif
 
   if (degree == 1)
     return true;
 
-  // bit-reverse
-  //r_set<0, 1, degree>{}(y, x);
-  permut<degree>::compute(y, x);
+  ops::inv_ntt_loop<CC_SIMD, poly>::run(x, inv_wtab, inv_winvtab, p);
 
-  ntt(y, inv_wtab, inv_winvtab, p);
+#ifdef NTT_STRICTMOD
+  for (size_t i = 0; i < degree; i++)
+  {
+    x[i]-= ((x[i]>=p)? p : 0);
+    ASSERT_STRICTMOD(x[i] < p);
+  }
+#endif
 
-  // bit-reverse again
-  permut<degree>::compute(x, y);
-  //r_set<0, 1, degree>{}(x, y);
   return true;
 }
 
@@ -598,6 +646,13 @@ template<class T, size_t Degree, size_t NbModuli> inline void poly<T, Degree, Nb
 // by phi powers before doing the NTT
 template<class T, size_t Degree, size_t NbModuli> inline void poly<T, Degree, NbModuli>::core::ntt_pow_phi(poly& op)
 {
+  if (ntt_kernel::enabled) {
+    for(size_t currentModulus = 0; currentModulus < nmoduli; ++currentModulus) {
+      ntt_kernel::ntt(&op(currentModulus, 0), kernel_wtab[currentModulus], shoupkernel_wtab[currentModulus], get_modulus(currentModulus));
+    }
+    return;
+  }
+
   op = nfl::shoup(op * reinterpret_cast<poly const &>(phis), reinterpret_cast<poly const &>(shoupphis));
   for(size_t currentModulus = 0; currentModulus < nmoduli; ++currentModulus) {
     poly::core::ntt(&op(currentModulus, 0), omegas[currentModulus], shoupomegas[currentModulus], get_modulus(currentModulus));
@@ -609,13 +664,20 @@ template<class T, size_t Degree, size_t NbModuli> inline void poly<T, Degree, Nb
 // coefficient representation and multiplies the coefficients with the
 // inverse powers of phi
 // In order to have polynomial operations mod X**n + 1 as we want
-// we must multiply the polynomial coefficients by invphi powers before doing the inverse-NTT
+// we must multiply the polynomial coefficients by invphi powers after doing
+// the inverse-NTT, which inv_ntt does within its butterflies
 template<class T, size_t Degree, size_t NbModuli> inline void poly<T, Degree, NbModuli>::core::invntt_pow_invphi(poly &op)
 {
+  if (ntt_kernel::enabled) {
+    for(size_t currentModulus = 0; currentModulus < nmoduli; ++currentModulus) {
+      ntt_kernel::inv_ntt(&op(currentModulus, 0), kernel_invwtab[currentModulus], shoupkernel_invwtab[currentModulus], get_modulus(currentModulus));
+    }
+    return;
+  }
+
   for(size_t currentModulus = 0; currentModulus < nmoduli; ++currentModulus) {
-    poly::core::inv_ntt(&op(currentModulus, 0), invomegas[currentModulus], shoupinvomegas[currentModulus], invpolyDegree[currentModulus], get_modulus(currentModulus));
+    poly::core::inv_ntt(&op(currentModulus, 0), invntt_wtab[currentModulus], shoupinvntt_wtab[currentModulus], get_modulus(currentModulus));
   }
-  op = nfl::shoup(op * reinterpret_cast<poly const &>(invpoly_times_invphis), reinterpret_cast<poly const &>(shoupinvpoly_times_invphis));
 }
 
 // *********************************************************
@@ -631,9 +693,12 @@ template<class T, size_t Degree, size_t NbModuli> void  poly<T, Degree, NbModuli
 {
   for(size_t currentModulus = 0; currentModulus < nmoduli; ++currentModulus)
   {
-    value_type phi, invphi, omega, invomega, temp;
+    value_type phi, invphi, omega, temp;
     shoupomegas[currentModulus] = omegas[currentModulus] + degree;
-    shoupinvomegas[currentModulus] = invomegas[currentModulus] + degree;
+    static_assert(ops::inv_ntt_loop<CC_SIMD, poly>::size() <= 3 * degree, "invntt_wtab is too small");
+    shoupinvntt_wtab[currentModulus] = invntt_wtab[currentModulus] + 3 * degree;
+    shoupkernel_wtab[currentModulus] = kernel_wtab[currentModulus] + ntt_kernel_size;
+    shoupkernel_invwtab[currentModulus] = kernel_invwtab[currentModulus] + ntt_kernel_size;
 
     // We start by computing phi
     // The roots in the array are primitve
@@ -669,24 +734,28 @@ template<class T, size_t Degree, size_t NbModuli> void  poly<T, Degree, NbModuli
     invpolyDegree[currentModulus] = ops::mulmod<T, simd::serial>{}(params<T>::invkMaxPolyDegree[currentModulus],
         static_cast<T>(params<T>::kMaxPolyDegree/degree), currentModulus);
 
-    // Now we can compute the table invpoly_times_invphis
-    temp = invpolyDegree[currentModulus];
-    for (unsigned int i = 0 ; i < degree ; i++)
-    {
-      invpoly_times_invphis[currentModulus][i] = temp;
-      shoupinvpoly_times_invphis[currentModulus][i] = ((greater_value_type) temp << params<T>::kModulusRepresentationBitsize)
-        / get_modulus(currentModulus);
-      // This is invpolyDegree*invphi**(i+1)
-      temp = ops::mulmod<T, simd::serial>{}(temp, invphi, currentModulus);
-    }
-
     // For the omegas it is easy, we just use the function of David Harvey modified for our needs
     omega = ops::mulmod<T, simd::serial>{}(phi, phi, currentModulus);
     prep_wtab(omegas[currentModulus], shoupomegas[currentModulus], omega, currentModulus);
 
-    // And again for the invomegas
-    invomega = ops::mulmod<T, simd::serial>{}(invphi, invphi, currentModulus);
-    prep_wtab(invomegas[currentModulus], shoupinvomegas[currentModulus], invomega, currentModulus);
+    // The inverse NTT merges the invphi powers into its twiddle factors
+    auto power = [currentModulus](value_type base, size_t e) {
+      value_type res = 1;
+      for (; e; e >>= 1, base = ops::mulmod<T, simd::serial>{}(base, base, currentModulus))
+        if (e & 1)
+          res = ops::mulmod<T, simd::serial>{}(res, base, currentModulus);
+      return res;
+    };
+    auto phi_pow = [power, phi](size_t e) { return power(phi, e); };
+    auto invphi_pow = [power, invphi](size_t e) { return power(invphi, e); };
+    ops::inv_ntt_loop<CC_SIMD, poly>::prep(invntt_wtab[currentModulus], shoupinvntt_wtab[currentModulus],
+        invphi_pow, invpolyDegree[currentModulus], get_modulus(currentModulus));
+
+    // And so does ops::ntt_kernel with the phi powers
+    ntt_kernel::prep_ntt(kernel_wtab[currentModulus], shoupkernel_wtab[currentModulus],
+        phi_pow, get_modulus(currentModulus));
+    ntt_kernel::prep_inv_ntt(kernel_invwtab[currentModulus], shoupkernel_invwtab[currentModulus],
+        invphi_pow, invpolyDegree[currentModulus], get_modulus(currentModulus));
   }
 }
 
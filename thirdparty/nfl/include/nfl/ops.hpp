@@ -4,6 +4,7 @@
 #include "nfl/meta.hpp"
 #include "nfl/arch.hpp"
 #include <tuple>
+#include <type_traits>
 #include <iostream>
 #include <limits>
 
@@ -49,6 +50,47 @@ namespace ops {
 template<class Arg, class... Args>
   constexpr Arg first_of(Arg arg, Args... args) { return arg; }
 
+// Lazy reductions
+// Every expression node has a compile-time bound: its values are below
+// bound * p. Ops with a lazy form (lazy_form<Op>::type, void otherwise)
+// skip their final reduction and take unreduced operands, as long as the
+// bound stays below lazy_bound_max, which keeps the values in T. Ops
+// without one get reduced operands, and so does the final store, through
+// a single reduce<T, tag> of each unreduced node
+template<class T>
+struct lazy_bound_max {
+  static constexpr unsigned value = 1u << (params<T>::kModulusRepresentationBitsize - params<T>::kModulusBitsize);
+};
+
+// Whether lazy_add, lazy_sub and reduce are implemented for T and tag
+template<class T, class tag> struct has_lazy_ops : std::false_type {};
+template<class T> struct has_lazy_ops<T, simd::serial> : std::true_type {};
+
+template<class T, class tag> struct lazy_add;
+template<class T, class tag> struct lazy_sub;
+template<class T, class tag> struct reduce;
+
+template<class Op> struct lazy_form { using type = void; };
+
+template<unsigned> struct strict_bound { static constexpr unsigned value = 1; };
+
+// Bound of a node of lazy op LazyOp with operands of bounds B..., and
+// whether the operands can be passed unreduced. LazyOp::bound returns 0
+// when the operands must be reduced
+template<class LazyOp, class T, unsigned... B>
+struct lazy_eval {
+  static constexpr unsigned lazy_bound = LazyOp::bound(B...);
+  static constexpr bool lazy_args = lazy_bound > 0 && lazy_bound <= lazy_bound_max<T>::value;
+  static constexpr unsigned bound = lazy_args ? lazy_bound : LazyOp::bound(strict_bound<B>::value...);
+  static constexpr int kind = lazy_args ? 2 : 1;
+};
+
+template<class T, unsigned... B>
+struct lazy_eval<void, T, B...> {
+  static constexpr unsigned bound = 1;
+  static constexpr int kind = 0;
+};
+
 template <class Op, class... Args>
 struct expr {
   using simd_mode = typename Op::simd_mode;
@@ -66,16 +108,49 @@ struct expr {
 
   using p = params<value_type>;
 
+  using lazy_op = typename lazy_form<Op>::type;
+  using eval = lazy_eval<lazy_op, value_type, Args::bound...>;
+  static constexpr unsigned bound = eval::bound;
+
+  // Reduced operands, Op
   template<class M, size_t... I>
-  auto _load(size_t cm, size_t i, seq<I...>) const -> decltype(Op{}(std::get<I>(args).template load<M>(cm, i)..., cm)) const
+  auto _load(size_t cm, size_t i, seq<I...>, std::integral_constant<int, 0>) const -> decltype(Op{}(std::get<I>(args).template load<M>(cm, i)..., cm)) const
   {
     return Op{}(std::get<I>(args).template load<M>(cm, i)..., cm);
   }
 
+  // Reduced operands, lazy form of Op
+  template<class M, class L = lazy_op, size_t... I>
+  auto _load(size_t cm, size_t i, seq<I...>, std::integral_constant<int, 1>) const -> decltype(L::template apply<strict_bound<Args::bound>::value...>(std::get<I>(args).template load<M>(cm, i)..., cm)) const
+  {
+    return L::template apply<strict_bound<Args::bound>::value...>(std::get<I>(args).template load<M>(cm, i)..., cm);
+  }
+
+  // Unreduced operands, lazy form of Op
+  template<class M, class L = lazy_op, size_t... I>
+  auto _load(size_t cm, size_t i, seq<I...>, std::integral_constant<int, 2>) const -> decltype(L::template apply<Args::bound...>(std::get<I>(args).template load_lazy<M>(cm, i)..., cm)) const
+  {
+    return L::template apply<Args::bound...>(std::get<I>(args).template load_lazy<M>(cm, i)..., cm);
+  }
+
+  template<class V>
+  static V _reduce(V v, size_t, std::false_type) { return v; }
+
+  template<class V>
+  static V _reduce(V v, size_t cm, std::true_type) { return reduce<value_type, simd_mode>::template apply<bound>(v, cm); }
+
+  // Values below bound * p
+  template<class M>
+  auto load_lazy(size_t cm, size_t i) const -> decltype(this->_load<M>(cm, i, typename gens<sizeof...(Args)>::type{}, std::integral_constant<int, eval::kind>{}))
+  {
+    return _load<M>(cm, i, typename gens<sizeof...(Args)>::type{}, std::integral_constant<int, eval::kind>{});
+  }
+
+  // Values below p
   template<class M>
-  auto load(size_t cm, size_t i) const -> decltype(this->_load<M>(cm, i, typename gens<sizeof...(Args)>::type{}))
+  auto load(size_t cm, size_t i) const -> decltype(this->load_lazy<M>(cm, i))
   {
-    return _load<M>(cm, i, typename gens<sizeof...(Args)>::type{});
+    return _reduce(load_lazy<M>(cm, i), cm, std::integral_constant<bool, (bound > 1)>{});
   }
 
   operator bool() const {
@@ -156,6 +231,58 @@ struct submod<T, simd::serial> {
   }
 };
 
+// Lazy forms of addmod and submod: x < B0 * p and y < B1 * p
+// OUTPUT: x + y and x - y + B1 * p, below (B0 + B1) * p
+template<class T>
+struct lazy_add<T, simd::serial> {
+  static constexpr unsigned bound(unsigned b0, unsigned b1) { return b0 + b1; }
+
+  template<unsigned B0, unsigned B1>
+  static T apply(T x, T y, size_t cm)
+  {
+    (void) cm; // only read by ASSERT_STRICTMOD
+    ASSERT_STRICTMOD(x < B0 * params<T>::P[cm] && y < B1 * params<T>::P[cm]);
+    return x + y;
+  }
+};
+
+template<class T>
+struct lazy_sub<T, simd::serial> {
+  static constexpr unsigned bound(unsigned b0, unsigned b1) { return b0 + b1; }
+
+  template<unsigned B0, unsigned B1>
+  static T apply(T x, T y, size_t cm)
+  {
+    ASSERT_STRICTMOD(x < B0 * params<T>::P[cm] && y < B1 * params<T>::P[cm]);
+    return x + (B1 * params<T>::P[cm] - y);
+  }
+};
+
+// Final reduction of a lazy result: x < B * p with B <= 4
+// OUTPUT: x mod p
+template<class T>
+struct reduce<T, simd::serial> {
+  template<unsigned B>
+  static T apply(T x, size_t cm)
+  {
+    static_assert(B <= 4, "reduce: at most two conditional subtractions");
+    auto const p = params<T>::P[cm];
+    if (B > 2)
+      x -= (x >= 2 * p) ? 2 * p : 0;
+    x -= (x >= p) ? p : 0;
+    ASSERT_STRICTMOD(x < p);
+    return x;
+  }
+};
+
+template<class T, class tag> struct lazy_form<addmod<T, tag>> {
+  using type = typename std::conditional<has_lazy_ops<T, tag>::value, lazy_add<T, tag>, void>::type;
+};
+
+template<class T, class tag> struct lazy_form<submod<T, tag>> {
+  using type = typename std::conditional<has_lazy_ops<T, tag>::value, lazy_sub<T, tag>, void>::type;
+};
+
 template<class T, class tag> struct shoup;
 template<class T>
 struct shoup<T, simd::serial> {
@@ -46,6 +46,14 @@ static inline __m256i avx2_mulhi_epu32(__m256i avx_a, __m256i avx_b)
   return reinterpret_cast<__m256i>(_mm256_blend_ps(reinterpret_cast<__m256>(mullow), reinterpret_cast<__m256>(mulhigh), 0b10101010));
 }
 
+// Signed Montgomery product x * y / 2**16 mod p, in (-p, p) when
+// |x * y| < p * 2**15, given yp = y * p**-1 mod 2**16
+static inline __m256i montgomery16_avx2(__m256i x, __m256i y, __m256i yp, __m256i avx_p)
+{
+  const __m256i m = _mm256_mullo_epi16(x, yp);
+  return _mm256_sub_epi16(_mm256_mulhi_epi16(x, y), _mm256_mulhi_epi16(m, avx_p));
+}
+
 template <class Integer>
 static inline void assert_strict_mod_avx2(__m256i const avx_v, Integer const p)
 {
@@ -109,6 +117,30 @@ struct addmod<uint16_t, simd::avx2>
 template<class T>
 struct mulmod<T, simd::avx2> : mulmod<T, simd::sse> {};
 
+// Two Montgomery products: x * y / 2**16, then times 2**32 / 2**16
+template<>
+struct mulmod<uint16_t, simd::avx2>
+{
+  using simd_mode = simd::avx2;
+  __m256i operator()(__m256i const x, __m256i const y, size_t const cm) const {
+    auto const p = params<uint16_t>::P[cm];
+    assert_strict_mod_avx2<uint16_t>(x, p);
+    assert_strict_mod_avx2<uint16_t>(y, p);
+
+    uint16_t const pinv = montgomery16_pinv(p);
+    uint16_t const r2 = montgomery16_r2(p);
+    __m256i avx_p = _mm256_set1_epi16(p);
+    __m256i avx_r2 = _mm256_set1_epi16(r2);
+    __m256i avx_r2p = _mm256_set1_epi16((uint16_t)(r2 * pinv));
+    const __m256i t = montgomery16_avx2(x, y, _mm256_mullo_epi16(y, _mm256_set1_epi16(pinv)), avx_p);
+    const __m256i z = montgomery16_avx2(t, avx_r2, avx_r2p, avx_p);
+    const __m256i avx_res = _mm256_add_epi16(z, _mm256_and_si256(_mm256_srai_epi16(z, 15), avx_p));
+
+    assert_strict_mod_avx2<uint16_t>(avx_res, p);
+    return avx_res;
+  }
+};
+
 template<class T>
 struct submod<T, simd::avx2> : submod<T, simd::sse> {};
 
@@ -149,6 +181,63 @@ struct submod<uint32_t, simd::avx2>
 template<class T>
 struct muladd<T, simd::avx2> : muladd<T, simd::sse> {};
 
+template<>
+struct muladd<uint16_t, simd::avx2>
+{
+  using simd_mode = simd::avx2;
+  __m256i operator()(__m256i const rop, __m256i const x, __m256i const y, size_t const cm) const {
+    return addmod<uint16_t, simd::avx2>{}(rop, mulmod<uint16_t, simd::avx2>{}(x, y, cm), cm);
+  }
+};
+
+//
+// LAZY REDUCTIONS
+//
+
+template<>
+struct has_lazy_ops<uint16_t, simd::avx2> : std::true_type {};
+
+template<>
+struct lazy_add<uint16_t, simd::avx2>
+{
+  static constexpr unsigned bound(unsigned b0, unsigned b1) { return b0 + b1; }
+
+  template<unsigned B0, unsigned B1>
+  static __m256i apply(__m256i x, __m256i y, size_t)
+  {
+    return _mm256_add_epi16(x, y);
+  }
+};
+
+template<>
+struct lazy_sub<uint16_t, simd::avx2>
+{
+  static constexpr unsigned bound(unsigned b0, unsigned b1) { return b0 + b1; }
+
+  template<unsigned B0, unsigned B1>
+  static __m256i apply(__m256i x, __m256i y, size_t cm)
+  {
+    return _mm256_sub_epi16(_mm256_add_epi16(x, _mm256_set1_epi16(B1 * params<uint16_t>::P[cm])), y);
+  }
+};
+
+// x < 4p: min(x, x - 2p) < 2p and min(x, x - p) < p
+template<>
+struct reduce<uint16_t, simd::avx2>
+{
+  template<unsigned B>
+  static __m256i apply(__m256i x, size_t cm)
+  {
+    static_assert(B <= 4, "reduce: at most two conditional subtractions");
+    auto const p = params<uint16_t>::P[cm];
+    if (B > 2)
+      x = _mm256_min_epu16(x, _mm256_sub_epi16(x, _mm256_set1_epi16(2 * p)));
+    x = _mm256_min_epu16(x, _mm256_sub_epi16(x, _mm256_set1_epi16(p)));
+    assert_strict_mod_avx2<uint16_t>(x, p);
+    return x;
+  }
+};
+
 //
 // NTT
 //
@@ -303,6 +392,287 @@ template<class poly>
 struct ntt_loop<simd::avx2, poly, uint16_t>: public ntt_loop_avx2_unrolled<poly>
 { };
 
+template <class poly, class T>
+struct inv_ntt_loop<simd::avx2, poly, T>: public inv_ntt_loop<simd::sse, poly, T>
+{ };
+
+template<class poly>
+struct inv_ntt_loop<simd::avx2, poly, uint32_t>: public inv_ntt_loop_unrolled<poly, simd::avx2, simd::sse>
+{ };
+
+template<class poly>
+struct inv_ntt_loop<simd::avx2, poly, uint16_t>: public inv_ntt_loop_unrolled<poly, simd::avx2, simd::sse>
+{ };
+
+// 512 coefficients take 32 registers, more than the 16 available, so that
+// the transforms go through memory twice: once for the spans from 256 to 64
+// (8 registers 4 apart), once for the remaining ones (4 adjacent registers)
+template<>
+struct ntt_kernel<simd::avx2, uint16_t, 512>: public ntt_kernel_tables<uint16_t, 512, 16>
+{
+  static constexpr bool enabled = true;
+
+  using span8 = std::integral_constant<size_t, 8>;
+  using span4 = std::integral_constant<size_t, 4>;
+  using span2 = std::integral_constant<size_t, 2>;
+  using span1 = std::integral_constant<size_t, 1>;
+
+  // Cooley-Tukey butterfly (x0 + w x1, x0 - w x1) for x0, x1 lower than 4p,
+  // returned lower than 4p
+  static inline void butterfly(__m256i &x0, __m256i &x1, __m256i const w, __m256i const wp,
+      __m256i const avx_p, __m256i const avx_2p)
+  {
+    const __m256i q = _mm256_mulhi_epu16(x1, wp);
+    const __m256i t = _mm256_sub_epi16(_mm256_mullo_epi16(x1, w), _mm256_mullo_epi16(q, avx_p));
+    x0 = _mm256_min_epu16(x0, _mm256_sub_epi16(x0, avx_2p));
+    x1 = _mm256_add_epi16(_mm256_sub_epi16(x0, t), avx_2p);
+    x0 = _mm256_add_epi16(x0, t);
+  }
+
+  // Gentleman-Sande butterfly (x0 + x1, (x0 - x1) w) for x0, x1 lower than
+  // 2p, returned lower than 2p
+  static inline void inv_butterfly(__m256i &x0, __m256i &x1, __m256i const w, __m256i const wp,
+      __m256i const avx_p, __m256i const avx_2p)
+  {
+    const __m256i t = _mm256_add_epi16(_mm256_sub_epi16(x0, x1), avx_2p);
+    const __m256i q = _mm256_mulhi_epu16(t, wp);
+    x0 = _mm256_add_epi16(x0, x1);
+    x0 = _mm256_min_epu16(x0, _mm256_sub_epi16(x0, avx_2p));
+    x1 = _mm256_sub_epi16(_mm256_mullo_epi16(t, w), _mm256_mullo_epi16(q, avx_p));
+  }
+
+  // Same with a multiplication of x0 + x1 by w0
+  static inline void inv_butterfly(__m256i &x0, __m256i &x1, __m256i const w, __m256i const wp,
+      __m256i const w0, __m256i const w0p, __m256i const avx_p, __m256i const avx_2p)
+  {
+    const __m256i t = _mm256_add_epi16(_mm256_sub_epi16(x0, x1), avx_2p);
+    const __m256i q = _mm256_mulhi_epu16(t, wp);
+    x0 = _mm256_add_epi16(x0, x1);
+    const __m256i q0 = _mm256_mulhi_epu16(x0, w0p);
+    x0 = _mm256_sub_epi16(_mm256_mullo_epi16(x0, w0), _mm256_mullo_epi16(q0, avx_p));
+    x1 = _mm256_sub_epi16(_mm256_mullo_epi16(t, w), _mm256_mullo_epi16(q, avx_p));
+  }
+
+  // Butterfly of the span of index k in the table
+  template <bool inverse>
+  static inline void butterfly(__m256i &x0, __m256i &x1, const value_type* wtab, const value_type* wtabshoup,
+      size_t k, __m256i const avx_p, __m256i const avx_2p)
+  {
+    const __m256i w = _mm256_set1_epi16(wtab[k]);
+    const __m256i wp = _mm256_set1_epi16(wtabshoup[k]);
+    if (inverse)
+      inv_butterfly(x0, x1, w, wp, avx_p, avx_2p);
+    else
+      butterfly(x0, x1, w, wp, avx_p, avx_2p);
+  }
+
+  // Butterflies of a pair of transposed registers with the table vectors at wtab
+  template <bool inverse>
+  static inline void butterfly(__m256i &x0, __m256i &x1, const value_type* wtab, const value_type* wtabshoup,
+      __m256i const avx_p, __m256i const avx_2p)
+  {
+    const __m256i w = _mm256_load_si256((__m256i const*) wtab);
+    const __m256i wp = _mm256_load_si256((__m256i const*) wtabshoup);
+    if (inverse)
+      inv_butterfly(x0, x1, w, wp, avx_p, avx_2p);
+    else
+      butterfly(x0, x1, w, wp, avx_p, avx_2p);
+  }
+
+  // Transpositions of x0, x1 by blocks of span lanes, each its own inverse
+  static inline void transpose(__m256i &x0, __m256i &x1, span8)
+  {
+    const __m256i t = _mm256_permute2x128_si256(x0, x1, 0x20);
+    x1 = _mm256_permute2x128_si256(x0, x1, 0x31);
+    x0 = t;
+  }
+
+  static inline void transpose(__m256i &x0, __m256i &x1, span4)
+  {
+    const __m256i t = _mm256_unpacklo_epi64(x0, x1);
+    x1 = _mm256_unpackhi_epi64(x0, x1);
+    x0 = t;
+  }
+
+  static inline void transpose(__m256i &x0, __m256i &x1, span2)
+  {
+    const __m256i t = _mm256_blend_epi32(x0, _mm256_slli_epi64(x1, 32), 0xAA);
+    x1 = _mm256_blend_epi32(_mm256_srli_epi64(x0, 32), x1, 0xAA);
+    x0 = t;
+  }
+
+  static inline void transpose(__m256i &x0, __m256i &x1, span1)
+  {
+    const __m256i t = _mm256_blend_epi16(x0, _mm256_slli_epi32(x1, 16), 0xAA);
+    x1 = _mm256_blend_epi16(_mm256_srli_epi32(x0, 16), x1, 0xAA);
+    x0 = t;
+  }
+
+  // From 32 coefficients to their even and odd ones, and back
+  static inline void deinterleave(__m256i &x0, __m256i &x1)
+  {
+    const __m256i mask = _mm256_set1_epi32(0xFFFF);
+    const __m256i t = _mm256_packus_epi32(_mm256_and_si256(x0, mask), _mm256_and_si256(x1, mask));
+    x1 = _mm256_packus_epi32(_mm256_srli_epi32(x0, 16), _mm256_srli_epi32(x1, 16));
+    x0 = _mm256_permute4x64_epi64(t, 0xD8);
+    x1 = _mm256_permute4x64_epi64(x1, 0xD8);
+  }
+
+  static inline void interleave(__m256i &x0, __m256i &x1)
+  {
+    const __m256i lo = _mm256_unpacklo_epi16(x0, x1);
+    const __m256i hi = _mm256_unpackhi_epi16(x0, x1);
+    x0 = _mm256_permute2x128_si256(lo, hi, 0x20);
+    x1 = _mm256_permute2x128_si256(lo, hi, 0x31);
+  }
+
+  // x must hold values lower than p, they are returned lower than p
+  static void ntt(value_type* x, const value_type* wtab, const value_type* wtabshoup, value_type const p)
+  {
+    const __m256i avx_p = _mm256_set1_epi16(p);
+    const __m256i avx_2p = _mm256_set1_epi16(2 * p);
+    __m256i* v = (__m256i*) x;
+
+    // Spans 256, 128 and 64
+    for (size_t j = 0; j < 4; j++) {
+      __m256i a0 = _mm256_load_si256(v + j), a1 = _mm256_load_si256(v + j + 4),
+              a2 = _mm256_load_si256(v + j + 8), a3 = _mm256_load_si256(v + j + 12),
+              a4 = _mm256_load_si256(v + j + 16), a5 = _mm256_load_si256(v + j + 20),
+              a6 = _mm256_load_si256(v + j + 24), a7 = _mm256_load_si256(v + j + 28);
+
+      butterfly<false>(a0, a4, wtab, wtabshoup, 1, avx_p, avx_2p);
+      butterfly<false>(a1, a5, wtab, wtabshoup, 1, avx_p, avx_2p);
+      butterfly<false>(a2, a6, wtab, wtabshoup, 1, avx_p, avx_2p);
+      butterfly<false>(a3, a7, wtab, wtabshoup, 1, avx_p, avx_2p);
+
+      butterfly<false>(a0, a2, wtab, wtabshoup, 2, avx_p, avx_2p);
+      butterfly<false>(a1, a3, wtab, wtabshoup, 2, avx_p, avx_2p);
+      butterfly<false>(a4, a6, wtab, wtabshoup, 3, avx_p, avx_2p);
+      butterfly<false>(a5, a7, wtab, wtabshoup, 3, avx_p, avx_2p);
+
+      butterfly<false>(a0, a1, wtab, wtabshoup, 4, avx_p, avx_2p);
+      butterfly<false>(a2, a3, wtab, wtabshoup, 5, avx_p, avx_2p);
+      butterfly<false>(a4, a5, wtab, wtabshoup, 6, avx_p, avx_2p);
+      butterfly<false>(a6, a7, wtab, wtabshoup, 7, avx_p, avx_2p);
+
+      _mm256_store_si256(v + j, a0); _mm256_store_si256(v + j + 4, a1);
+      _mm256_store_si256(v + j + 8, a2); _mm256_store_si256(v + j + 12, a3);
+      _mm256_store_si256(v + j + 16, a4); _mm256_store_si256(v + j + 20, a5);
+      _mm256_store_si256(v + j + 24, a6); _mm256_store_si256(v + j + 28, a7);
+    }
+
+    // Spans 32 to 1
+    const value_type* vtab = wtab + scalars;
+    const value_type* vtabshoup = wtabshoup + scalars;
+    for (size_t g = 0; g < 8; g++, vtab += 2 * lanes, vtabshoup += 2 * lanes) {
+      __m256i a0 = _mm256_load_si256(v + 4 * g), a1 = _mm256_load_si256(v + 4 * g + 1),
+              a2 = _mm256_load_si256(v + 4 * g + 2), a3 = _mm256_load_si256(v + 4 * g + 3);
+
+      butterfly<false>(a0, a2, wtab, wtabshoup, 8 + g, avx_p, avx_2p);
+      butterfly<false>(a1, a3, wtab, wtabshoup, 8 + g, avx_p, avx_2p);
+      butterfly<false>(a0, a1, wtab, wtabshoup, 16 + 2 * g, avx_p, avx_2p);
+      butterfly<false>(a2, a3, wtab, wtabshoup, 17 + 2 * g, avx_p, avx_2p);
+
+      transpose(a0, a1, span8()); transpose(a2, a3, span8());
+      butterfly<false>(a0, a1, vtab, vtabshoup, avx_p, avx_2p);
+      butterfly<false>(a2, a3, vtab + lanes, vtabshoup + lanes, avx_p, avx_2p);
+      transpose(a0, a1, span4()); transpose(a2, a3, span4());
+      butterfly<false>(a0, a1, vtab + 256, vtabshoup + 256, avx_p, avx_2p);
+      butterfly<false>(a2, a3, vtab + 256 + lanes, vtabshoup + 256 + lanes, avx_p, avx_2p);
+      transpose(a0, a1, span2()); transpose(a2, a3, span2());
+      butterfly<false>(a0, a1, vtab + 512, vtabshoup + 512, avx_p, avx_2p);
+      butterfly<false>(a2, a3, vtab + 512 + lanes, vtabshoup + 512 + lanes, avx_p, avx_2p);
+      transpose(a0, a1, span1()); transpose(a2, a3, span1());
+      butterfly<false>(a0, a1, vtab + 768, vtabshoup + 768, avx_p, avx_2p);
+      butterfly<false>(a2, a3, vtab + 768 + lanes, vtabshoup + 768 + lanes, avx_p, avx_2p);
+      interleave(a0, a1); interleave(a2, a3);
+
+      // From [0, 4p) to [0, p)
+      a0 = _mm256_min_epu16(a0, _mm256_sub_epi16(a0, avx_2p)); a0 = _mm256_min_epu16(a0, _mm256_sub_epi16(a0, avx_p));
+      a1 = _mm256_min_epu16(a1, _mm256_sub_epi16(a1, avx_2p)); a1 = _mm256_min_epu16(a1, _mm256_sub_epi16(a1, avx_p));
+      a2 = _mm256_min_epu16(a2, _mm256_sub_epi16(a2, avx_2p)); a2 = _mm256_min_epu16(a2, _mm256_sub_epi16(a2, avx_p));
+      a3 = _mm256_min_epu16(a3, _mm256_sub_epi16(a3, avx_2p)); a3 = _mm256_min_epu16(a3, _mm256_sub_epi16(a3, avx_p));
+
+      _mm256_store_si256(v + 4 * g, a0); _mm256_store_si256(v + 4 * g + 1, a1);
+      _mm256_store_si256(v + 4 * g + 2, a2); _mm256_store_si256(v + 4 * g + 3, a3);
+    }
+  }
+
+  // x must hold values lower than p, they are returned lower than p
+  static void inv_ntt(value_type* x, const value_type* wtab, const value_type* wtabshoup, value_type const p)
+  {
+    const __m256i avx_p = _mm256_set1_epi16(p);
+    const __m256i avx_2p = _mm256_set1_epi16(2 * p);
+    __m256i* v = (__m256i*) x;
+
+    // Spans 1 to 32
+    const value_type* vtab = wtab + scalars;
+    const value_type* vtabshoup = wtabshoup + scalars;
+    for (size_t g = 0; g < 8; g++, vtab += 2 * lanes, vtabshoup += 2 * lanes) {
+      __m256i a0 = _mm256_load_si256(v + 4 * g), a1 = _mm256_load_si256(v + 4 * g + 1),
+              a2 = _mm256_load_si256(v + 4 * g + 2), a3 = _mm256_load_si256(v + 4 * g + 3);
+
+      deinterleave(a0, a1); deinterleave(a2, a3);
+      butterfly<true>(a0, a1, vtab, vtabshoup, avx_p, avx_2p);
+      butterfly<true>(a2, a3, vtab + lanes, vtabshoup + lanes, avx_p, avx_2p);
+      transpose(a0, a1, span1()); transpose(a2, a3, span1());
+      butterfly<true>(a0, a1, vtab + 256, vtabshoup + 256, avx_p, avx_2p);
+      butterfly<true>(a2, a3, vtab + 256 + lanes, vtabshoup + 256 + lanes, avx_p, avx_2p);
+      transpose(a0, a1, span2()); transpose(a2, a3, span2());
+      butterfly<true>(a0, a1, vtab + 512, vtabshoup + 512, avx_p, avx_2p);
+      butterfly<true>(a2, a3, vtab + 512 + lanes, vtabshoup + 512 + lanes, avx_p, avx_2p);
+      transpose(a0, a1, span4()); transpose(a2, a3, span4());
+      butterfly<true>(a0, a1, vtab + 768, vtabshoup + 768, avx_p, avx_2p);
+      butterfly<true>(a2, a3, vtab + 768 + lanes, vtabshoup + 768 + lanes, avx_p, avx_2p);
+      transpose(a0, a1, span8()); transpose(a2, a3, span8());
+
+      butterfly<true>(a0, a1, wtab, wtabshoup, 16 + 2 * g, avx_p, avx_2p);
+      butterfly<true>(a2, a3, wtab, wtabshoup, 17 + 2 * g, avx_p, avx_2p);
+      butterfly<true>(a0, a2, wtab, wtabshoup, 8 + g, avx_p, avx_2p);
+      butterfly<true>(a1, a3, wtab, wtabshoup, 8 + g, avx_p, avx_2p);
+
+      _mm256_store_si256(v + 4 * g, a0); _mm256_store_si256(v + 4 * g + 1, a1);
+      _mm256_store_si256(v + 4 * g + 2, a2); _mm256_store_si256(v + 4 * g + 3, a3);
+    }
+
+    // Spans 64, 128 and 256, the last one with the multiplications by invK
+    const __m256i w = _mm256_set1_epi16(wtab[1]), wp = _mm256_set1_epi16(wtabshoup[1]);
+    const __m256i invK = _mm256_set1_epi16(wtab[0]), invKp = _mm256_set1_epi16(wtabshoup[0]);
+    for (size_t j = 0; j < 4; j++) {
+      __m256i a0 = _mm256_load_si256(v + j), a1 = _mm256_load_si256(v + j + 4),
+              a2 = _mm256_load_si256(v + j + 8), a3 = _mm256_load_si256(v + j + 12),
+              a4 = _mm256_load_si256(v + j + 16), a5 = _mm256_load_si256(v + j + 20),
+              a6 = _mm256_load_si256(v + j + 24), a7 = _mm256_load_si256(v + j + 28);
+
+      butterfly<true>(a0, a1, wtab, wtabshoup, 4, avx_p, avx_2p);
+      butterfly<true>(a2, a3, wtab, wtabshoup, 5, avx_p, avx_2p);
+      butterfly<true>(a4, a5, wtab, wtabshoup, 6, avx_p, avx_2p);
+      butterfly<true>(a6, a7, wtab, wtabshoup, 7, avx_p, avx_2p);
+
+      butterfly<true>(a0, a2, wtab, wtabshoup, 2, avx_p, avx_2p);
+      butterfly<true>(a1, a3, wtab, wtabshoup, 2, avx_p, avx_2p);
+      butterfly<true>(a4, a6, wtab, wtabshoup, 3, avx_p, avx_2p);
+      butterfly<true>(a5, a7, wtab, wtabshoup, 3, avx_p, avx_2p);
+
+      inv_butterfly(a0, a4, w, wp, invK, invKp, avx_p, avx_2p);
+      inv_butterfly(a1, a5, w, wp, invK, invKp, avx_p, avx_2p);
+      inv_butterfly(a2, a6, w, wp, invK, invKp, avx_p, avx_2p);
+      inv_butterfly(a3, a7, w, wp, invK, invKp, avx_p, avx_2p);
+
+      // From [0, 2p) to [0, p)
+      a0 = _mm256_min_epu16(a0, _mm256_sub_epi16(a0, avx_p)); a1 = _mm256_min_epu16(a1, _mm256_sub_epi16(a1, avx_p));
+      a2 = _mm256_min_epu16(a2, _mm256_sub_epi16(a2, avx_p)); a3 = _mm256_min_epu16(a3, _mm256_sub_epi16(a3, avx_p));
+      a4 = _mm256_min_epu16(a4, _mm256_sub_epi16(a4, avx_p)); a5 = _mm256_min_epu16(a5, _mm256_sub_epi16(a5, avx_p));
+      a6 = _mm256_min_epu16(a6, _mm256_sub_epi16(a6, avx_p)); a7 = _mm256_min_epu16(a7, _mm256_sub_epi16(a7, avx_p));
+
+      _mm256_store_si256(v + j, a0); _mm256_store_si256(v + j + 4, a1);
+      _mm256_store_si256(v + j + 8, a2); _mm256_store_si256(v + j + 12, a3);
+      _mm256_store_si256(v + j + 16, a4); _mm256_store_si256(v + j + 20, a5);
+      _mm256_store_si256(v + j + 24, a6); _mm256_store_si256(v + j + 28, a7);
+    }
+  }
+};
+
 //
 // MULMOD_SHOUP
 //
@@ -432,6 +802,90 @@ struct shoup<T, simd::avx2> {
 template<class T>
 struct compute_shoup<T, simd::avx2> : compute_shoup<T, simd::sse> {};
 
+//
+// RECONCILIATION
+//
+
+template<class T>
+struct signal_body<simd::avx2, T> : signal_body<simd::sse, T>
+{
+  using signal_body<simd::sse, T>::signal_body;
+};
+
+// p < 2^14, so that signed comparisons hold on all lanes
+template<>
+struct signal_body<simd::avx2, uint16_t>
+{
+  using value_type = uint16_t;
+  using simd_type = simd::avx2;
+  static_assert(params<uint16_t>::kModulusBitsize <= 14 && moduli_below<uint16_t>(14),
+                "signal_body: the signed comparisons need p < 2^14");
+
+  signal_body(value_type const p, value_type const bound)
+  {
+    _avx_bound = _mm256_set1_epi16(bound);
+    _avx_pmbound = _mm256_set1_epi16(p - bound);
+  }
+
+  inline uint64_t operator()(value_type const* x) const
+  {
+    const __m256i avx_x = _mm256_load_si256((__m256i const*) x);
+    const __m256i avx_cmp = _mm256_and_si256(_mm256_cmpgt_epi16(avx_x, _avx_bound),
+                                             _mm256_cmpgt_epi16(_avx_pmbound, avx_x));
+    return _mm_movemask_epi8(_mm_packs_epi16(_mm256_castsi256_si128(avx_cmp),
+                                             _mm256_extracti128_si256(avx_cmp, 1)));
+  }
+
+  __m256i _avx_bound;
+  __m256i _avx_pmbound;
+};
+
+template<class T>
+struct mod2_body<simd::avx2, T> : mod2_body<simd::sse, T>
+{
+  using mod2_body<simd::sse, T>::mod2_body;
+};
+
+// p < 2^14, so that signed comparisons hold on all lanes
+template<>
+struct mod2_body<simd::avx2, uint16_t>
+{
+  using value_type = uint16_t;
+  using simd_type = simd::avx2;
+  static_assert(params<uint16_t>::kModulusBitsize <= 14 && moduli_below<uint16_t>(14),
+                "mod2_body: the signed comparisons need p < 2^14");
+
+  mod2_body(value_type const p)
+  {
+    _avx_p = _mm256_set1_epi16(p);
+    _avx_pov2 = _mm256_set1_epi16(p / 2);
+    _avx_1 = _mm256_set1_epi16(1);
+    _avx_lanebit = _mm256_setr_epi16(1 << 0, 1 << 1, 1 << 2, 1 << 3, 1 << 4, 1 << 5, 1 << 6, 1 << 7,
+                                     1 << 8, 1 << 9, 1 << 10, 1 << 11, 1 << 12, 1 << 13, 1 << 14,
+                                     (short)(1 << 15));
+  }
+
+  inline uint64_t operator()(value_type const* x, uint64_t const sig) const
+  {
+    const __m256i avx_x = _mm256_load_si256((__m256i const*) x);
+    const __m256i avx_sig = _mm256_cmpeq_epi16(_mm256_and_si256(_mm256_set1_epi16(sig & 0xFFFF), _avx_lanebit),
+                                               _avx_lanebit);
+
+    __m256i avx_y = _mm256_add_epi16(avx_x, _mm256_and_si256(avx_sig, _avx_pov2));
+    avx_y = _mm256_sub_epi16(avx_y, _mm256_andnot_si256(_mm256_cmpgt_epi16(_avx_p, avx_y), _avx_p));
+
+    const __m256i avx_res = _mm256_xor_si256(_mm256_cmpeq_epi16(_mm256_and_si256(avx_y, _avx_1), _avx_1),
+                                             _mm256_cmpgt_epi16(avx_y, _avx_pov2));
+    return _mm_movemask_epi8(_mm_packs_epi16(_mm256_castsi256_si128(avx_res),
+                                             _mm256_extracti128_si256(avx_res, 1)));
+  }
+
+  __m256i _avx_p;
+  __m256i _avx_pov2;
+  __m256i _avx_1;
+  __m256i _avx_lanebit;
+};
+
 } // ops
 
 } // ntt
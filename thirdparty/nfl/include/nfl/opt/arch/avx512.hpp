@@ -48,6 +48,14 @@ static inline __m512i avx512_mulhi_epu32(__m512i avx_a, __m512i avx_b)
   return reinterpret_cast<__m512i>(_mm512_mask_blend_ps((__mmask16) 0b1010101010101010, reinterpret_cast<__m512>(mullow), reinterpret_cast<__m512>(mulhigh)));
 }
 
+// Signed Montgomery product x * y / 2**16 mod p, in (-p, p) when
+// |x * y| < p * 2**15, given yp = y * p**-1 mod 2**16
+static inline __m512i montgomery16_avx512(__m512i x, __m512i y, __m512i yp, __m512i avx_p)
+{
+  const __m512i m = _mm512_mullo_epi16(x, yp);
+  return _mm512_sub_epi16(_mm512_mulhi_epi16(x, y), _mm512_mulhi_epi16(m, avx_p));
+}
+
 template <class Integer>
 static inline void assert_strict_mod_avx512(__m512i const avx_v, Integer const p)
 {
@@ -113,6 +121,30 @@ struct addmod<uint16_t, simd::avx512>
 template<class T>
 struct mulmod<T, simd::avx512> : mulmod<T, simd::avx2> {};
 
+// Two Montgomery products: x * y / 2**16, then times 2**32 / 2**16
+template<>
+struct mulmod<uint16_t, simd::avx512>
+{
+  using simd_mode = simd::avx512;
+  __m512i operator()(__m512i const x, __m512i const y, size_t const cm) const {
+    auto const p = params<uint16_t>::P[cm];
+    assert_strict_mod_avx512<uint16_t>(x, p);
+    assert_strict_mod_avx512<uint16_t>(y, p);
+
+    uint16_t const pinv = montgomery16_pinv(p);
+    uint16_t const r2 = montgomery16_r2(p);
+    __m512i avx_p = _mm512_set1_epi16(p);
+    __m512i avx_r2 = _mm512_set1_epi16(r2);
+    __m512i avx_r2p = _mm512_set1_epi16((uint16_t)(r2 * pinv));
+    const __m512i t = montgomery16_avx512(x, y, _mm512_mullo_epi16(y, _mm512_set1_epi16(pinv)), avx_p);
+    const __m512i z = montgomery16_avx512(t, avx_r2, avx_r2p, avx_p);
+    const __m512i avx_res = _mm512_add_epi16(z, _mm512_and_si512(_mm512_srai_epi16(z, 15), avx_p));
+
+    assert_strict_mod_avx512<uint16_t>(avx_res, p);
+    return avx_res;
+  }
+};
+
 template<class T>
 struct submod<T, simd::avx512> : submod<T, simd::avx2> {};
 
@@ -153,6 +185,63 @@ struct submod<uint32_t, simd::avx512>
 template<class T>
 struct muladd<T, simd::avx512> : muladd<T, simd::avx2> {};
 
+template<>
+struct muladd<uint16_t, simd::avx512>
+{
+  using simd_mode = simd::avx512;
+  __m512i operator()(__m512i const rop, __m512i const x, __m512i const y, size_t const cm) const {
+    return addmod<uint16_t, simd::avx512>{}(rop, mulmod<uint16_t, simd::avx512>{}(x, y, cm), cm);
+  }
+};
+
+//
+// LAZY REDUCTIONS
+//
+
+template<>
+struct has_lazy_ops<uint16_t, simd::avx512> : std::true_type {};
+
+template<>
+struct lazy_add<uint16_t, simd::avx512>
+{
+  static constexpr unsigned bound(unsigned b0, unsigned b1) { return b0 + b1; }
+
+  template<unsigned B0, unsigned B1>
+  static __m512i apply(__m512i x, __m512i y, size_t)
+  {
+    return _mm512_add_epi16(x, y);
+  }
+};
+
+template<>
+struct lazy_sub<uint16_t, simd::avx512>
+{
+  static constexpr unsigned bound(unsigned b0, unsigned b1) { return b0 + b1; }
+
+  template<unsigned B0, unsigned B1>
+  static __m512i apply(__m512i x, __m512i y, size_t cm)
+  {
+    return _mm512_sub_epi16(_mm512_add_epi16(x, _mm512_set1_epi16(B1 * params<uint16_t>::P[cm])), y);
+  }
+};
+
+// x < 4p: min(x, x - 2p) < 2p and min(x, x - p) < p
+template<>
+struct reduce<uint16_t, simd::avx512>
+{
+  template<unsigned B>
+  static __m512i apply(__m512i x, size_t cm)
+  {
+    static_assert(B <= 4, "reduce: at most two conditional subtractions");
+    auto const p = params<uint16_t>::P[cm];
+    if (B > 2)
+      x = _mm512_min_epu16(x, _mm512_sub_epi16(x, _mm512_set1_epi16(2 * p)));
+    x = _mm512_min_epu16(x, _mm512_sub_epi16(x, _mm512_set1_epi16(p)));
+    assert_strict_mod_avx512<uint16_t>(x, p);
+    return x;
+  }
+};
+
 //
 // NTT
 //
@@ -317,6 +406,263 @@ template<class poly>
 struct ntt_loop<simd::avx512, poly, uint16_t>: public ntt_loop_avx512_unrolled<poly>
 { };
 
+template <class poly, class T>
+struct inv_ntt_loop<simd::avx512, poly, T>: public inv_ntt_loop<simd::avx2, poly, T>
+{ };
+
+template<class poly>
+struct inv_ntt_loop<simd::avx512, poly, uint32_t>: public inv_ntt_loop_unrolled<poly, simd::avx512, simd::avx2, simd::sse>
+{ };
+
+template<class poly>
+struct inv_ntt_loop<simd::avx512, poly, uint16_t>: public inv_ntt_loop_unrolled<poly, simd::avx512, simd::avx2, simd::sse>
+{ };
+
+// 512 coefficients take 16 registers: the transforms load them once, go
+// through all the spans and store them once
+template<>
+struct ntt_kernel<simd::avx512, uint16_t, 512>: public ntt_kernel_tables<uint16_t, 512, 32>
+{
+  static constexpr bool enabled = true;
+
+  using span16 = std::integral_constant<size_t, 16>;
+  using span8 = std::integral_constant<size_t, 8>;
+  using span4 = std::integral_constant<size_t, 4>;
+  using span2 = std::integral_constant<size_t, 2>;
+  using span1 = std::integral_constant<size_t, 1>;
+
+  // Cooley-Tukey butterfly (x0 + w x1, x0 - w x1) for x0, x1 lower than 4p,
+  // returned lower than 4p
+  static inline void butterfly(__m512i &x0, __m512i &x1, __m512i const w, __m512i const wp,
+      __m512i const avx_p, __m512i const avx_2p)
+  {
+    const __m512i q = _mm512_mulhi_epu16(x1, wp);
+    const __m512i t = _mm512_sub_epi16(_mm512_mullo_epi16(x1, w), _mm512_mullo_epi16(q, avx_p));
+    x0 = _mm512_min_epu16(x0, _mm512_sub_epi16(x0, avx_2p));
+    x1 = _mm512_add_epi16(_mm512_sub_epi16(x0, t), avx_2p);
+    x0 = _mm512_add_epi16(x0, t);
+  }
+
+  // Gentleman-Sande butterfly (x0 + x1, (x0 - x1) w) for x0, x1 lower than
+  // 2p, returned lower than 2p
+  static inline void inv_butterfly(__m512i &x0, __m512i &x1, __m512i const w, __m512i const wp,
+      __m512i const avx_p, __m512i const avx_2p)
+  {
+    const __m512i t = _mm512_add_epi16(_mm512_sub_epi16(x0, x1), avx_2p);
+    const __m512i q = _mm512_mulhi_epu16(t, wp);
+    x0 = _mm512_add_epi16(x0, x1);
+    x0 = _mm512_min_epu16(x0, _mm512_sub_epi16(x0, avx_2p));
+    x1 = _mm512_sub_epi16(_mm512_mullo_epi16(t, w), _mm512_mullo_epi16(q, avx_p));
+  }
+
+  // Same with a multiplication of x0 + x1 by w0
+  static inline void inv_butterfly(__m512i &x0, __m512i &x1, __m512i const w, __m512i const wp,
+      __m512i const w0, __m512i const w0p, __m512i const avx_p, __m512i const avx_2p)
+  {
+    const __m512i t = _mm512_add_epi16(_mm512_sub_epi16(x0, x1), avx_2p);
+    const __m512i q = _mm512_mulhi_epu16(t, wp);
+    x0 = _mm512_add_epi16(x0, x1);
+    const __m512i q0 = _mm512_mulhi_epu16(x0, w0p);
+    x0 = _mm512_sub_epi16(_mm512_mullo_epi16(x0, w0), _mm512_mullo_epi16(q0, avx_p));
+    x1 = _mm512_sub_epi16(_mm512_mullo_epi16(t, w), _mm512_mullo_epi16(q, avx_p));
+  }
+
+  // Butterfly of the span of index k in the table
+  template <bool inverse>
+  static inline void butterfly(__m512i &x0, __m512i &x1, const value_type* wtab, const value_type* wtabshoup,
+      size_t k, __m512i const avx_p, __m512i const avx_2p)
+  {
+    const __m512i w = _mm512_set1_epi16(wtab[k]);
+    const __m512i wp = _mm512_set1_epi16(wtabshoup[k]);
+    if (inverse)
+      inv_butterfly(x0, x1, w, wp, avx_p, avx_2p);
+    else
+      butterfly(x0, x1, w, wp, avx_p, avx_2p);
+  }
+
+  // Butterflies of a pair of transposed registers with the table vectors at wtab
+  template <bool inverse>
+  static inline void butterfly(__m512i &x0, __m512i &x1, const value_type* wtab, const value_type* wtabshoup,
+      __m512i const avx_p, __m512i const avx_2p)
+  {
+    const __m512i w = _mm512_load_si512((__m512i const*) wtab);
+    const __m512i wp = _mm512_load_si512((__m512i const*) wtabshoup);
+    if (inverse)
+      inv_butterfly(x0, x1, w, wp, avx_p, avx_2p);
+    else
+      butterfly(x0, x1, w, wp, avx_p, avx_2p);
+  }
+
+  // Transpositions of x0, x1 by blocks of span lanes, each its own inverse
+  static inline void transpose(__m512i &x0, __m512i &x1, span16)
+  {
+    const __m512i t = _mm512_shuffle_i64x2(x0, x1, 0x44);
+    x1 = _mm512_shuffle_i64x2(x0, x1, 0xEE);
+    x0 = t;
+  }
+
+  static inline void transpose(__m512i &x0, __m512i &x1, span8)
+  {
+    const __m512i t = _mm512_permutex2var_epi64(x0, _mm512_set_epi64(13, 12, 5, 4, 9, 8, 1, 0), x1);
+    x1 = _mm512_permutex2var_epi64(x0, _mm512_set_epi64(15, 14, 7, 6, 11, 10, 3, 2), x1);
+    x0 = t;
+  }
+
+  static inline void transpose(__m512i &x0, __m512i &x1, span4)
+  {
+    const __m512i t = _mm512_unpacklo_epi64(x0, x1);
+    x1 = _mm512_unpackhi_epi64(x0, x1);
+    x0 = t;
+  }
+
+  static inline void transpose(__m512i &x0, __m512i &x1, span2)
+  {
+    const __m512i t = _mm512_mask_blend_epi32(0xAAAA, x0, _mm512_slli_epi64(x1, 32));
+    x1 = _mm512_mask_blend_epi32(0xAAAA, _mm512_srli_epi64(x0, 32), x1);
+    x0 = t;
+  }
+
+  static inline void transpose(__m512i &x0, __m512i &x1, span1)
+  {
+    const __m512i t = _mm512_mask_blend_epi16(0xAAAAAAAA, x0, _mm512_slli_epi32(x1, 16));
+    x1 = _mm512_mask_blend_epi16(0xAAAAAAAA, _mm512_srli_epi32(x0, 16), x1);
+    x0 = t;
+  }
+
+  // From 64 coefficients to their even and odd ones, and back
+  static inline void deinterleave(__m512i &x0, __m512i &x1)
+  {
+    const __m512i mask = _mm512_set1_epi32(0xFFFF);
+    const __m512i idx = _mm512_set_epi64(7, 5, 3, 1, 6, 4, 2, 0);
+    const __m512i t = _mm512_packus_epi32(_mm512_and_si512(x0, mask), _mm512_and_si512(x1, mask));
+    x1 = _mm512_packus_epi32(_mm512_srli_epi32(x0, 16), _mm512_srli_epi32(x1, 16));
+    x0 = _mm512_permutexvar_epi64(idx, t);
+    x1 = _mm512_permutexvar_epi64(idx, x1);
+  }
+
+  static inline void interleave(__m512i &x0, __m512i &x1)
+  {
+    const __m512i lo = _mm512_unpacklo_epi16(x0, x1);
+    const __m512i hi = _mm512_unpackhi_epi16(x0, x1);
+    x0 = _mm512_permutex2var_epi64(lo, _mm512_set_epi64(11, 10, 3, 2, 9, 8, 1, 0), hi);
+    x1 = _mm512_permutex2var_epi64(lo, _mm512_set_epi64(15, 14, 7, 6, 13, 12, 5, 4), hi);
+  }
+
+  // The loops over registers below are unrolled through index sequences, so
+  // that the registers are never spilled to an array on the stack
+  using registers = typename gens<16>::type;
+  using pairs = typename gens<8>::type;
+
+  template <size_t... I>
+  static inline void load(__m512i (&a)[16], __m512i const* v, seq<I...>)
+  {
+    (void) std::initializer_list<int>{(a[I] = _mm512_load_si512(v + I), 0)...};
+  }
+
+  template <size_t... I>
+  static inline void store(__m512i* v, __m512i (&a)[16], seq<I...>)
+  {
+    (void) std::initializer_list<int>{(_mm512_store_si512(v + I, a[I]), 0)...};
+  }
+
+  // Butterflies between the registers d apart, I going over the first
+  // register of each butterfly
+  template <bool inverse, size_t d, size_t... I>
+  static inline void layer(__m512i (&a)[16], const value_type* wtab, const value_type* wtabshoup,
+      __m512i const avx_p, __m512i const avx_2p, seq<I...>)
+  {
+    (void) std::initializer_list<int>{(butterfly<inverse>(a[I / d * 2 * d + I % d], a[I / d * 2 * d + I % d + d],
+          wtab, wtabshoup, 8 / d + I / d, avx_p, avx_2p), 0)...};
+  }
+
+  // Butterflies of span lanes between the registers of each pair R, after
+  // (forward transform) or before (inverse transform) their transposition
+  template <bool inverse, size_t span, size_t... R>
+  static inline void pair_layer(__m512i (&a)[16], const value_type* vtab, const value_type* vtabshoup,
+      __m512i const avx_p, __m512i const avx_2p, seq<R...>)
+  {
+    using span_t = std::integral_constant<size_t, span>;
+    if (!inverse)
+      (void) std::initializer_list<int>{(transpose(a[2 * R], a[2 * R + 1], span_t()), 0)...};
+    (void) std::initializer_list<int>{(butterfly<inverse>(a[2 * R], a[2 * R + 1],
+          vtab + R * lanes, vtabshoup + R * lanes, avx_p, avx_2p), 0)...};
+    if (inverse)
+      (void) std::initializer_list<int>{(transpose(a[2 * R], a[2 * R + 1], span_t()), 0)...};
+  }
+
+  // Back from even and odd coefficients in each pair, then from [0, 4p) to [0, p)
+  template <size_t... R>
+  static inline void interleave(__m512i (&a)[16], __m512i const avx_p, __m512i const avx_2p, seq<R...>)
+  {
+    (void) std::initializer_list<int>{(interleave(a[2 * R], a[2 * R + 1]), 0)...};
+    (void) std::initializer_list<int>{(a[2 * R] = _mm512_min_epu16(a[2 * R], _mm512_sub_epi16(a[2 * R], avx_2p)),
+        a[2 * R] = _mm512_min_epu16(a[2 * R], _mm512_sub_epi16(a[2 * R], avx_p)),
+        a[2 * R + 1] = _mm512_min_epu16(a[2 * R + 1], _mm512_sub_epi16(a[2 * R + 1], avx_2p)),
+        a[2 * R + 1] = _mm512_min_epu16(a[2 * R + 1], _mm512_sub_epi16(a[2 * R + 1], avx_p)), 0)...};
+  }
+
+  template <size_t... R>
+  static inline void deinterleave(__m512i (&a)[16], seq<R...>)
+  {
+    (void) std::initializer_list<int>{(deinterleave(a[2 * R], a[2 * R + 1]), 0)...};
+  }
+
+  // Span 256 of the inverse transform, with the multiplications by invK,
+  // then from [0, 2p) to [0, p)
+  template <size_t... I>
+  static inline void last_layer(__m512i (&a)[16], const value_type* wtab, const value_type* wtabshoup,
+      __m512i const avx_p, __m512i const avx_2p, seq<I...>)
+  {
+    const __m512i w = _mm512_set1_epi16(wtab[1]), wp = _mm512_set1_epi16(wtabshoup[1]);
+    const __m512i invK = _mm512_set1_epi16(wtab[0]), invKp = _mm512_set1_epi16(wtabshoup[0]);
+    (void) std::initializer_list<int>{(inv_butterfly(a[I], a[I + 8], w, wp, invK, invKp, avx_p, avx_2p), 0)...};
+    (void) std::initializer_list<int>{(a[I] = _mm512_min_epu16(a[I], _mm512_sub_epi16(a[I], avx_p)),
+        a[I + 8] = _mm512_min_epu16(a[I + 8], _mm512_sub_epi16(a[I + 8], avx_p)), 0)...};
+  }
+
+  // x must hold values lower than p, they are returned lower than p
+  static void ntt(value_type* x, const value_type* wtab, const value_type* wtabshoup, value_type const p)
+  {
+    const __m512i avx_p = _mm512_set1_epi16(p);
+    const __m512i avx_2p = _mm512_set1_epi16(2 * p);
+    __m512i a[16];
+
+    load(a, (__m512i const*) x, registers());
+    layer<false, 8>(a, wtab, wtabshoup, avx_p, avx_2p, pairs());
+    layer<false, 4>(a, wtab, wtabshoup, avx_p, avx_2p, pairs());
+    layer<false, 2>(a, wtab, wtabshoup, avx_p, avx_2p, pairs());
+    layer<false, 1>(a, wtab, wtabshoup, avx_p, avx_2p, pairs());
+    pair_layer<false, 16>(a, wtab + scalars, wtabshoup + scalars, avx_p, avx_2p, pairs());
+    pair_layer<false, 8>(a, wtab + scalars + 256, wtabshoup + scalars + 256, avx_p, avx_2p, pairs());
+    pair_layer<false, 4>(a, wtab + scalars + 512, wtabshoup + scalars + 512, avx_p, avx_2p, pairs());
+    pair_layer<false, 2>(a, wtab + scalars + 768, wtabshoup + scalars + 768, avx_p, avx_2p, pairs());
+    pair_layer<false, 1>(a, wtab + scalars + 1024, wtabshoup + scalars + 1024, avx_p, avx_2p, pairs());
+    interleave(a, avx_p, avx_2p, pairs());
+    store((__m512i*) x, a, registers());
+  }
+
+  // x must hold values lower than p, they are returned lower than p
+  static void inv_ntt(value_type* x, const value_type* wtab, const value_type* wtabshoup, value_type const p)
+  {
+    const __m512i avx_p = _mm512_set1_epi16(p);
+    const __m512i avx_2p = _mm512_set1_epi16(2 * p);
+    __m512i a[16];
+
+    load(a, (__m512i const*) x, registers());
+    deinterleave(a, pairs());
+    pair_layer<true, 1>(a, wtab + scalars, wtabshoup + scalars, avx_p, avx_2p, pairs());
+    pair_layer<true, 2>(a, wtab + scalars + 256, wtabshoup + scalars + 256, avx_p, avx_2p, pairs());
+    pair_layer<true, 4>(a, wtab + scalars + 512, wtabshoup + scalars + 512, avx_p, avx_2p, pairs());
+    pair_layer<true, 8>(a, wtab + scalars + 768, wtabshoup + scalars + 768, avx_p, avx_2p, pairs());
+    pair_layer<true, 16>(a, wtab + scalars + 1024, wtabshoup + scalars + 1024, avx_p, avx_2p, pairs());
+    layer<true, 1>(a, wtab, wtabshoup, avx_p, avx_2p, pairs());
+    layer<true, 2>(a, wtab, wtabshoup, avx_p, avx_2p, pairs());
+    layer<true, 4>(a, wtab, wtabshoup, avx_p, avx_2p, pairs());
+    last_layer(a, wtab, wtabshoup, avx_p, avx_2p, pairs());
+    store((__m512i*) x, a, registers());
+  }
+};
+
 //
 // MULMOD_SHOUP
 //
@@ -464,6 +810,73 @@ struct shoup<T, simd::avx512> {
 template<class T>
 struct compute_shoup<T, simd::avx512> : compute_shoup<T, simd::avx2> {};
 
+//
+// RECONCILIATION
+//
+
+template<class T>
+struct signal_body<simd::avx512, T> : signal_body<simd::avx2, T>
+{
+  using signal_body<simd::avx2, T>::signal_body;
+};
+
+template<>
+struct signal_body<simd::avx512, uint16_t>
+{
+  using value_type = uint16_t;
+  using simd_type = simd::avx512;
+
+  signal_body(value_type const p, value_type const bound)
+  {
+    _avx_bound = _mm512_set1_epi16(bound);
+    _avx_pmbound = _mm512_set1_epi16(p - bound);
+  }
+
+  inline uint64_t operator()(value_type const* x) const
+  {
+    const __m512i avx_x = _mm512_load_si512((__m512i const*) x);
+    return _mm512_mask_cmplt_epu16_mask(_mm512_cmpgt_epu16_mask(avx_x, _avx_bound),
+                                        avx_x, _avx_pmbound);
+  }
+
+  __m512i _avx_bound;
+  __m512i _avx_pmbound;
+};
+
+template<class T>
+struct mod2_body<simd::avx512, T> : mod2_body<simd::avx2, T>
+{
+  using mod2_body<simd::avx2, T>::mod2_body;
+};
+
+template<>
+struct mod2_body<simd::avx512, uint16_t>
+{
+  using value_type = uint16_t;
+  using simd_type = simd::avx512;
+
+  mod2_body(value_type const p)
+  {
+    _avx_p = _mm512_set1_epi16(p);
+    _avx_pov2 = _mm512_set1_epi16(p / 2);
+    _avx_1 = _mm512_set1_epi16(1);
+  }
+
+  inline uint64_t operator()(value_type const* x, uint64_t const sig) const
+  {
+    const __m512i avx_x = _mm512_load_si512((__m512i const*) x);
+
+    __m512i avx_y = _mm512_mask_add_epi16(avx_x, (__mmask32)sig, avx_x, _avx_pov2);
+    avx_y = _mm512_mask_sub_epi16(avx_y, _mm512_cmpge_epu16_mask(avx_y, _avx_p), avx_y, _avx_p);
+
+    return _mm512_test_epi16_mask(avx_y, _avx_1) ^ _mm512_cmpgt_epu16_mask(avx_y, _avx_pov2);
+  }
+
+  __m512i _avx_p;
+  __m512i _avx_pov2;
+  __m512i _avx_1;
+};
+
 } // ops
 
 } // ntt
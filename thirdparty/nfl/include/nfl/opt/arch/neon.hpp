@@ -473,6 +473,10 @@ template<class poly>
 struct ntt_loop<simd::neon, poly, uint16_t>: public ntt_loop_neon_unrolled<poly>
 { };
 
+template <class poly, class T>
+struct inv_ntt_loop<simd::neon, poly, T>: public inv_ntt_loop<simd::serial, poly, T>
+{ };
+
 //
 // MULMOD_SHOUP
 //
@@ -691,6 +695,22 @@ struct shoup<T, simd::neon> {
 template<class T>
 struct compute_shoup<T, simd::neon> : compute_shoup<T, simd::serial> {};
 
+//
+// RECONCILIATION
+//
+
+template<class T>
+struct signal_body<simd::neon, T> : signal_body<simd::serial, T>
+{
+  using signal_body<simd::serial, T>::signal_body;
+};
+
+template<class T>
+struct mod2_body<simd::neon, T> : mod2_body<simd::serial, T>
+{
+  using mod2_body<simd::serial, T>::mod2_body;
+};
+
 } // ops
 
 } // nfl
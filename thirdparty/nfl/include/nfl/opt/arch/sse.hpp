@@ -54,6 +54,14 @@ static inline __m128i mulhi_epu16(__m128i sse_a, __m128i sse_b)
   return _mm_mulhi_epu16(sse_a, sse_b);
 }
 
+// Signed Montgomery product x * y / 2**16 mod p, in (-p, p) when
+// |x * y| < p * 2**15, given yp = y * p**-1 mod 2**16
+static inline __m128i montgomery16_sse(__m128i x, __m128i y, __m128i yp, __m128i sse_p)
+{
+  const __m128i m = _mm_mullo_epi16(x, yp);
+  return _mm_sub_epi16(_mm_mulhi_epi16(x, y), _mm_mulhi_epi16(m, sse_p));
+}
+
 template <class Integer>
 static inline void assert_strict_mod_sse(__m128i const sse_v, Integer const p)
 {
@@ -115,6 +123,30 @@ struct addmod<uint16_t, simd::sse>
 template<class T>
 struct mulmod<T, simd::sse> : mulmod<T, simd::serial> {};
 
+// Two Montgomery products: x * y / 2**16, then times 2**32 / 2**16
+template<>
+struct mulmod<uint16_t, simd::sse>
+{
+  using simd_mode = simd::sse;
+  __m128i operator()(__m128i const x, __m128i const y, size_t const cm) const {
+    auto const p = params<uint16_t>::P[cm];
+    assert_strict_mod_sse<uint16_t>(x, p);
+    assert_strict_mod_sse<uint16_t>(y, p);
+
+    uint16_t const pinv = montgomery16_pinv(p);
+    uint16_t const r2 = montgomery16_r2(p);
+    __m128i sse_p = _mm_set1_epi16(p);
+    __m128i sse_r2 = _mm_set1_epi16(r2);
+    __m128i sse_r2p = _mm_set1_epi16((uint16_t)(r2 * pinv));
+    const __m128i t = montgomery16_sse(x, y, _mm_mullo_epi16(y, _mm_set1_epi16(pinv)), sse_p);
+    const __m128i z = montgomery16_sse(t, sse_r2, sse_r2p, sse_p);
+    const __m128i sse_res = _mm_add_epi16(z, _mm_and_si128(_mm_srai_epi16(z, 15), sse_p));
+
+    assert_strict_mod_sse<uint16_t>(sse_res, p);
+    return sse_res;
+  }
+};
+
 template<class T>
 struct submod<T, simd::sse> : submod<T, simd::serial> {};
 
@@ -155,6 +187,63 @@ struct submod<uint32_t, simd::sse>
 template<class T>
 struct muladd<T, simd::sse> : muladd<T, simd::serial> {};
 
+template<>
+struct muladd<uint16_t, simd::sse>
+{
+  using simd_mode = simd::sse;
+  __m128i operator()(__m128i const rop, __m128i const x, __m128i const y, size_t const cm) const {
+    return addmod<uint16_t, simd::sse>{}(rop, mulmod<uint16_t, simd::sse>{}(x, y, cm), cm);
+  }
+};
+
+//
+// LAZY REDUCTIONS
+//
+
+template<>
+struct has_lazy_ops<uint16_t, simd::sse> : std::true_type {};
+
+template<>
+struct lazy_add<uint16_t, simd::sse>
+{
+  static constexpr unsigned bound(unsigned b0, unsigned b1) { return b0 + b1; }
+
+  template<unsigned B0, unsigned B1>
+  static __m128i apply(__m128i x, __m128i y, size_t)
+  {
+    return _mm_add_epi16(x, y);
+  }
+};
+
+template<>
+struct lazy_sub<uint16_t, simd::sse>
+{
+  static constexpr unsigned bound(unsigned b0, unsigned b1) { return b0 + b1; }
+
+  template<unsigned B0, unsigned B1>
+  static __m128i apply(__m128i x, __m128i y, size_t cm)
+  {
+    return _mm_sub_epi16(_mm_add_epi16(x, _mm_set1_epi16(B1 * params<uint16_t>::P[cm])), y);
+  }
+};
+
+// x < 4p: min(x, x - 2p) < 2p and min(x, x - p) < p
+template<>
+struct reduce<uint16_t, simd::sse>
+{
+  template<unsigned B>
+  static __m128i apply(__m128i x, size_t cm)
+  {
+    static_assert(B <= 4, "reduce: at most two conditional subtractions");
+    auto const p = params<uint16_t>::P[cm];
+    if (B > 2)
+      x = _mm_min_epu16(x, _mm_sub_epi16(x, _mm_set1_epi16(2 * p)));
+    x = _mm_min_epu16(x, _mm_sub_epi16(x, _mm_set1_epi16(p)));
+    assert_strict_mod_sse<uint16_t>(x, p);
+    return x;
+  }
+};
+
 //
 // NTT
 //
@@ -300,6 +389,18 @@ template<class poly>
 struct ntt_loop<simd::sse, poly, uint16_t>: public ntt_loop_sse_unrolled<poly>
 { };
 
+template <class poly, class T>
+struct inv_ntt_loop<simd::sse, poly, T>: public inv_ntt_loop<simd::serial, poly, T>
+{ };
+
+template<class poly>
+struct inv_ntt_loop<simd::sse, poly, uint32_t>: public inv_ntt_loop_unrolled<poly, simd::sse>
+{ };
+
+template<class poly>
+struct inv_ntt_loop<simd::sse, poly, uint16_t>: public inv_ntt_loop_unrolled<poly, simd::sse>
+{ };
+
 //
 // MULMOD_SHOUP
 //
@@ -497,6 +598,86 @@ struct shoup<T, simd::sse> {
 template<class T>
 struct compute_shoup<T, simd::sse> : compute_shoup<T, simd::serial> {};
 
+//
+// RECONCILIATION
+//
+
+template<class T>
+struct signal_body<simd::sse, T> : signal_body<simd::serial, T>
+{
+  using signal_body<simd::serial, T>::signal_body;
+};
+
+// p < 2^14, so that signed comparisons hold on all lanes
+template<>
+struct signal_body<simd::sse, uint16_t>
+{
+  using value_type = uint16_t;
+  using simd_type = simd::sse;
+  static_assert(params<uint16_t>::kModulusBitsize <= 14 && moduli_below<uint16_t>(14),
+                "signal_body: the signed comparisons need p < 2^14");
+
+  signal_body(value_type const p, value_type const bound)
+  {
+    _sse_bound = _mm_set1_epi16(bound);
+    _sse_pmbound = _mm_set1_epi16(p - bound);
+  }
+
+  inline uint64_t operator()(value_type const* x) const
+  {
+    const __m128i sse_x = _mm_load_si128((__m128i const*) x);
+    const __m128i sse_cmp = _mm_and_si128(_mm_cmpgt_epi16(sse_x, _sse_bound),
+                                          _mm_cmplt_epi16(sse_x, _sse_pmbound));
+    return _mm_movemask_epi8(_mm_packs_epi16(sse_cmp, _mm_setzero_si128()));
+  }
+
+  __m128i _sse_bound;
+  __m128i _sse_pmbound;
+};
+
+template<class T>
+struct mod2_body<simd::sse, T> : mod2_body<simd::serial, T>
+{
+  using mod2_body<simd::serial, T>::mod2_body;
+};
+
+// p < 2^14, so that signed comparisons hold on all lanes
+template<>
+struct mod2_body<simd::sse, uint16_t>
+{
+  using value_type = uint16_t;
+  using simd_type = simd::sse;
+  static_assert(params<uint16_t>::kModulusBitsize <= 14 && moduli_below<uint16_t>(14),
+                "mod2_body: the signed comparisons need p < 2^14");
+
+  mod2_body(value_type const p)
+  {
+    _sse_p = _mm_set1_epi16(p);
+    _sse_pov2 = _mm_set1_epi16(p / 2);
+    _sse_1 = _mm_set1_epi16(1);
+    _sse_lanebit = _mm_setr_epi16(1 << 0, 1 << 1, 1 << 2, 1 << 3, 1 << 4, 1 << 5, 1 << 6, 1 << 7);
+  }
+
+  inline uint64_t operator()(value_type const* x, uint64_t const sig) const
+  {
+    const __m128i sse_x = _mm_load_si128((__m128i const*) x);
+    const __m128i sse_sig = _mm_cmpeq_epi16(_mm_and_si128(_mm_set1_epi16(sig & 0xFF), _sse_lanebit),
+                                            _sse_lanebit);
+
+    __m128i sse_y = _mm_add_epi16(sse_x, _mm_and_si128(sse_sig, _sse_pov2));
+    sse_y = _mm_sub_epi16(sse_y, _mm_andnot_si128(_mm_cmpgt_epi16(_sse_p, sse_y), _sse_p));
+
+    const __m128i sse_res = _mm_xor_si128(_mm_cmpeq_epi16(_mm_and_si128(sse_y, _sse_1), _sse_1),
+                                          _mm_cmpgt_epi16(sse_y, _sse_pov2));
+    return _mm_movemask_epi8(_mm_packs_epi16(sse_res, _mm_setzero_si128()));
+  }
+
+  __m128i _sse_p;
+  __m128i _sse_pov2;
+  __m128i _sse_1;
+  __m128i _sse_lanebit;
+};
+
 } // ops
 
 } // nfl
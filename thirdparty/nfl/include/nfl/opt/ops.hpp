@@ -2,6 +2,26 @@ namespace nfl {
 
 namespace ops {
 
+// Montgomery constants for the 16-bit moduli (R = 2**16) of the SIMD mulmod
+// and muladd specializations for uint16_t
+// p**-1 mod 2**16 by Newton iteration, each step doubling the correct bits
+static constexpr uint16_t montgomery16_newton(uint32_t p, uint32_t x, unsigned steps)
+{
+  return steps == 0 ? (uint16_t)x : montgomery16_newton(p, (x * (2U - p * x)) & 0xFFFF, steps - 1);
+}
+
+static constexpr uint16_t montgomery16_pinv(uint16_t p)
+{
+  // p * p = 1 mod 8 for odd p
+  return montgomery16_newton(p, p, 3);
+}
+
+// R**2 mod p, which takes a Montgomery product back out of the Montgomery domain
+static constexpr uint16_t montgomery16_r2(uint16_t p)
+{
+  return (uint16_t)(((uint64_t)1 << 32) % p);
+}
+
 // Fused Multiplications-Additions
 // FMA with division for modular reduction (expensive)
 template<class type, class tag> struct muladd;
@@ -80,6 +100,35 @@ T operator()(T rop, T x, T y, T yprime, size_t cm) const
 };
 
 
+// Lazy form of muladd: rop < B0 * p, x < p and y < p
+// OUTPUT: rop + x * y mod p, below (B0 + 1) * p
+template<class T, class tag>
+struct lazy_muladd {
+  static constexpr unsigned bound(unsigned b0, unsigned b1, unsigned b2) { return (b1 == 1 && b2 == 1) ? b0 + 1 : 0; }
+
+  template<unsigned B0, unsigned B1, unsigned B2, class V>
+  static V apply(V rop, V x, V y, size_t cm)
+  {
+    return lazy_add<T, tag>::template apply<B0, 1>(rop, mulmod<T, tag>{}(x, y, cm), cm);
+  }
+};
+
+template<class T, class tag> struct lazy_form<muladd<T, tag>> {
+  using type = typename std::conditional<has_lazy_ops<T, tag>::value, lazy_muladd<T, tag>, void>::type;
+};
+
+// detect fused multiplication-addition x * y + z
+template<class tag0, class tag1, class type, class Arg0, class Arg1, class Arg2>
+struct _make_op<addmod<type, tag0>, expr<mulmod<type, tag1>, Arg0, Arg1>, Arg2> {
+  expr<muladd<type, retag<Arg0, Arg1, Arg2>>, Arg2, Arg0, Arg1>
+  operator()(expr<mulmod<type, tag1>, Arg0, Arg1> const& from0, Arg2 const& from1) const {
+    return expr<muladd<type, retag<Arg0, Arg1, Arg2>>, Arg2, Arg0, Arg1>{
+      from1,
+      std::get<0>(from0.args),
+      std::get<1>(from0.args)
+    };
+  }
+};
 
 } // ops
 
@@ -24,6 +24,7 @@
 #include "nfl/meta.hpp"
 #include "nfl/params.hpp"
 #include "nfl/ops.hpp"
+#include "nfl/algos.hpp"
 #include "nfl/arch.hpp"
 #include "nfl/prng/fastrandombytes.h"
 #include "nfl/prng/FastGaussianNoise.hpp"
@@ -62,8 +63,23 @@ template<class in_class, class out_class, unsigned _lu_depth>
 struct gaussian {
   FastGaussianNoise<in_class, out_class, _lu_depth> *fg_prng;
   uint64_t amplifier;
-  gaussian(FastGaussianNoise<in_class, out_class, _lu_depth> *prng) : fg_prng{prng}, amplifier{1} {}
-  gaussian(FastGaussianNoise<in_class, out_class, _lu_depth> *prng, uint64_t amp) : fg_prng{prng}, amplifier{amp} {}
+  prng_ctx_t *ctx; // uniform randomness consumed by the sampler
+  gaussian(FastGaussianNoise<in_class, out_class, _lu_depth> *prng) : fg_prng{prng}, amplifier{1}, ctx{&default_prng_ctx()} {}
+  gaussian(FastGaussianNoise<in_class, out_class, _lu_depth> *prng, uint64_t amp) : fg_prng{prng}, amplifier{amp}, ctx{&default_prng_ctx()} {}
+  gaussian(FastGaussianNoise<in_class, out_class, _lu_depth> *prng, uint64_t amp, prng_ctx_t *c) : fg_prng{prng}, amplifier{amp}, ctx{c} {}
+};
+
+// centered binomial distribution: popcount(a) - popcount(b) for two
+// K-bit uniform strings, of standard deviation sqrt(K/2). Unlike gaussian
+// it needs no precomputed tables
+template<unsigned K>
+struct cbd {
+  static_assert(K >= 1 && K <= 8, "cbd: K must be in [1, 8]");
+  uint64_t amplifier;
+  prng_ctx_t *ctx; // uniform randomness consumed by the sampler
+  cbd() : amplifier{1}, ctx{&default_prng_ctx()} {}
+  cbd(uint64_t amp) : amplifier{amp}, ctx{&default_prng_ctx()} {}
+  cbd(uint64_t amp, prng_ctx_t *c) : amplifier{amp}, ctx{c} {}
 };
 
 // Forward declaration for proxy class used in tests to access poly
@@ -112,6 +128,8 @@ template<class Archive>
   static constexpr size_t nmoduli = NbModuli;
   static constexpr size_t nbits = params<T>::kModulusBitsize;
   static constexpr size_t aggregated_modulus_bit_size = NbModuli * nbits;
+  // coefficients are below bound * p (see ops::lazy_form)
+  static constexpr unsigned bound = 1;
 
 public:
   /* constructors
@@ -126,6 +144,7 @@ public:
   template <class It> poly(It first, It last, bool reduce_coeffs = true);
   template <class Op, class... Args> poly(ops::expr<Op, Args...> const& expr);
   template <class in_class, unsigned _lu_depth> poly(gaussian<in_class, T, _lu_depth> const& mode);
+  template <unsigned K> poly(cbd<K> const& mode);
 
   void set(uniform const& mode);
   void set(non_uniform const& mode);
@@ -135,6 +154,7 @@ public:
   void set(std::initializer_list<value_type> values, bool reduce_coeffs = true);
   template <class It> void set(It first, It last, bool reduce_coeffs = true);
   template <class in_class, unsigned _lu_depth> void set(gaussian<in_class, T, _lu_depth> const& mode);
+  template <unsigned K> void set(cbd<K> const& mode);
 
   const T* get_coeffs() { return _data; }
   size_t get_coeffs_size_bytes() { return N * sizeof(T); }
@@ -148,6 +168,7 @@ public:
   poly& operator=(ZO_dist const& mode) { set(mode); return *this; }
   poly& operator=(std::initializer_list<value_type> values) { set(values); return *this; }
   template <class in_class, unsigned _lu_depth> poly& operator=(gaussian<in_class, T, _lu_depth> const& mode) { set(mode); return *this; }
+  template <unsigned K> poly& operator=(cbd<K> const& mode) { set(mode); return *this; }
   template <class Op, class... Args> poly& operator=(ops::expr<Op, Args...> const& expr);
 
   /* conversion operators
@@ -169,6 +190,7 @@ public:
   value_type const& operator()(size_t cm, size_t i) const { return _data[cm * degree + i]; }
   value_type& operator()(size_t cm, size_t i) { return _data[cm * degree + i]; }
   template<class M> auto load(size_t cm, size_t i) const -> decltype(M::load(&(this->operator()(cm, i)))) { return M::load(&(*this)(cm, i)); }
+  template<class M> auto load_lazy(size_t cm, size_t i) const -> decltype(this->load<M>(cm, i)) { return load<M>(cm, i); }
 
   /* misc
    */
@@ -226,7 +248,7 @@ public:
     void ntt_pow_phi(poly &op);
     void invntt_pow_invphi(poly&);
     static bool ntt(value_type* x, const value_type* wtab, const value_type* winvtab, value_type  const p);
-    static bool inv_ntt(value_type *x, const value_type* const inv_wtab, const value_type* const inv_winvtab, value_type invK, value_type const p);
+    static bool inv_ntt(value_type *x, const value_type* const inv_wtab, const value_type* const inv_winvtab, value_type const p);
 
   private:
     // NTT and inversse NTT related attributes
@@ -238,27 +260,37 @@ public:
     // NOTE : omega and derived values are ordered following David Harvey's
     // algorithm w**0 w**1 ... w**(degree/2) w**0 w**2 ...
     // w**(degree/2) w**0 w**4 ... w**(degree/2) etc. (degree values)
+    // The inverse NTT tables hold bit-reversed powers of invphi and invK,
+    // laid out as described with ops::inv_ntt_loop (at most 3*degree values)
+    // When ops::ntt_kernel handles the polynomial type, it uses its own tables
+    // for both transforms instead of all the above
+    using ntt_kernel = ops::ntt_kernel<CC_SIMD, T, Degree>;
+    static constexpr size_t ntt_kernel_size = ntt_kernel::size ? ntt_kernel::size : 1;
 #ifdef __LP64__
     value_type
       phis[nmoduli][degree] __attribute__((aligned(64))),
       shoupphis[nmoduli][degree]  __attribute__((aligned(64))),
-      invpoly_times_invphis[nmoduli][degree]  __attribute__((aligned(64))),
-      shoupinvpoly_times_invphis[nmoduli][degree]  __attribute__((aligned(64))),
       omegas[nmoduli][degree * 2]  __attribute__((aligned(64))),
       *shoupomegas[nmoduli]  __attribute__((aligned(64))),
-      invomegas[nmoduli][2 * degree]  __attribute__((aligned(64))),
-      *shoupinvomegas[nmoduli]  __attribute__((aligned(64))),
+      invntt_wtab[nmoduli][6 * degree]  __attribute__((aligned(64))),
+      *shoupinvntt_wtab[nmoduli]  __attribute__((aligned(64))),
+      kernel_wtab[nmoduli][2 * ntt_kernel_size]  __attribute__((aligned(64))),
+      *shoupkernel_wtab[nmoduli]  __attribute__((aligned(64))),
+      kernel_invwtab[nmoduli][2 * ntt_kernel_size]  __attribute__((aligned(64))),
+      *shoupkernel_invwtab[nmoduli]  __attribute__((aligned(64))),
       invpolyDegree[nmoduli]  __attribute__((aligned(64)));
 #else
     value_type
       phis[nmoduli][degree] __attribute__((aligned(32))),
       shoupphis[nmoduli][degree]  __attribute__((aligned(32))),
-      invpoly_times_invphis[nmoduli][degree]  __attribute__((aligned(32))),
-      shoupinvpoly_times_invphis[nmoduli][degree]  __attribute__((aligned(32))),
       omegas[nmoduli][degree * 2]  __attribute__((aligned(32))),
       *shoupomegas[nmoduli]  __attribute__((aligned(32))),
-      invomegas[nmoduli][2 * degree]  __attribute__((aligned(32))),
-      *shoupinvomegas[nmoduli]  __attribute__((aligned(32))),
+      invntt_wtab[nmoduli][6 * degree]  __attribute__((aligned(32))),
+      *shoupinvntt_wtab[nmoduli]  __attribute__((aligned(32))),
+      kernel_wtab[nmoduli][2 * ntt_kernel_size]  __attribute__((aligned(32))),
+      *shoupkernel_wtab[nmoduli]  __attribute__((aligned(32))),
+      kernel_invwtab[nmoduli][2 * ntt_kernel_size]  __attribute__((aligned(32))),
+      *shoupkernel_invwtab[nmoduli]  __attribute__((aligned(32))),
       invpolyDegree[nmoduli]  __attribute__((aligned(32)));
 #endif
 
@@ -0,0 +1,378 @@
+/* Copyright (C) 2015  Carlos Aguilar, Tancrède Lepoint, Adrien Guinet and Serge Guelton
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef NFL_POLY_BATCH_HPP
+#define NFL_POLY_BATCH_HPP
+
+/***
+ * Transposed batch of polynomials for NFL
+ *
+ * A poly_batch holds Lanes independent polynomials of poly<T, Degree, 1>
+ * with coefficient i of polynomial l stored at (i, l): the Lanes values of
+ * a coefficient are contiguous. Every operation below is a loop over the
+ * lanes of one or two coefficients, which the compiler turns into full
+ * width vector code whatever the stride of the operation inside a
+ * polynomial (e.g. the last NTT layers, which pair neighbouring
+ * coefficients and can't fill a vector register on a single polynomial).
+ *
+ * The NTT representation is the one of poly::ntt_pow_phi, so that
+ * polynomials can be moved between both containers in any representation.
+ */
+
+#include <algorithm>
+#include <vector>
+#include "nfl/poly.hpp"
+#include "nfl/aligned_allocator.hpp"
+
+namespace nfl {
+
+template<class T, size_t Degree, size_t Lanes>
+class poly_batch {
+
+  static_assert(Lanes > 0, "a batch needs at least one lane");
+  static_assert((Degree & (Degree - 1)) == 0, "Degree must be a power of two");
+
+public:
+  using poly_type = poly<T, Degree, 1>;
+  using value_type = typename poly_type::value_type;
+  using greater_value_type = typename poly_type::greater_value_type;
+  using signed_value_type = typename poly_type::signed_value_type;
+
+  static constexpr size_t degree = Degree;
+  static constexpr size_t lanes = Lanes;
+
+  /* constructors
+   */
+  poly_batch() = default;
+  template <class in_class, unsigned _lu_depth> poly_batch(gaussian<in_class, T, _lu_depth> const& mode) { set(mode); }
+
+  /* Gaussian noise in every lane: the samples are independent, so they
+   * are drawn in a single call and used in storage order
+   */
+  template <class in_class, unsigned _lu_depth> void set(gaussian<in_class, T, _lu_depth> const& mode);
+  template <class in_class, unsigned _lu_depth> poly_batch& operator=(gaussian<in_class, T, _lu_depth> const& mode) { set(mode); return *this; }
+
+  /* lane access (transposes a polynomial in or out of the batch)
+   */
+  void set(size_t l, poly_type const& a);
+  void get(size_t l, poly_type& a) const;
+  // Lanes 0 to m-1, by blocks that stay in L1
+  void set(poly_type const* a, size_t m);
+  void get(poly_type* a, size_t m) const;
+
+  /* indexing: coefficient i of lane l
+   */
+  value_type const& operator()(size_t i, size_t l) const { return _data[i][l]; }
+  value_type& operator()(size_t i, size_t l) { return _data[i][l]; }
+
+  /* pointwise operations, lane by lane
+   */
+  poly_batch& operator+=(poly_batch const& a);
+  poly_batch& operator-=(poly_batch const& a);
+  poly_batch& operator*=(poly_batch const& a);
+  // Multiplies every lane by the same polynomial
+  poly_batch& operator*=(poly_type const& a);
+  // (*this) = a * s + e in every lane, e.g. RLWE samples from a common a
+  void muladd(poly_type const& a, poly_batch const& s, poly_batch const& e);
+
+  /* ntt stuff, same representation as poly
+   */
+  void ntt_pow_phi();
+  void invntt_pow_invphi();
+
+  static constexpr value_type get_modulus() { return params<T>::P[0]; }
+
+private:
+  // Twiddle factors of the merged-twist NTT: zetas[k] = phi**brv(k) and
+  // invzetas[k] = phi**(-brv(k)), with the Shoup quotients of each
+  struct tables_t {
+    value_type zetas[Degree], shoupzetas[Degree];
+    value_type invzetas[Degree], shoupinvzetas[Degree];
+    value_type invK, shoupinvK;
+    tables_t();
+  };
+  static tables_t const& tables() { static const tables_t t; return t; }
+
+  static inline value_type shoup(value_type x) {
+    return ((greater_value_type) x << params<T>::kModulusRepresentationBitsize) / get_modulus();
+  }
+  // x < 2p -> x mod p
+  static inline value_type reduce(value_type x) {
+    return std::min<value_type>(x, x - get_modulus());
+  }
+  // x * w mod p, with w' = shoup(w)
+  static inline value_type mulmod_shoup(value_type x, value_type w, value_type wprime) {
+    value_type q = ((greater_value_type) x * wprime) >> params<T>::kModulusRepresentationBitsize;
+    return reduce((value_type)(x * (greater_value_type) w) - (value_type)(q * (greater_value_type) get_modulus()));
+  }
+  static inline value_type mulmod(value_type x, value_type y) {
+    return ((greater_value_type) x * y) % get_modulus();
+  }
+
+  // Butterflies between two coefficient rows, one lane at a time (rows
+  // never overlap, which lets the compiler vectorise without alias checks)
+  static inline void ct_butterfly(value_type * __restrict x0, value_type * __restrict x1,
+      value_type w, value_type wprime) {
+    for (size_t l = 0; l < Lanes; l++) {
+      value_type const t = mulmod_shoup(x1[l], w, wprime);
+      x1[l] = reduce(x0[l] + get_modulus() - t);
+      x0[l] = reduce(x0[l] + t);
+    }
+  }
+  static inline void gs_butterfly(value_type * __restrict x0, value_type * __restrict x1,
+      value_type w, value_type wprime) {
+    for (size_t l = 0; l < Lanes; l++) {
+      value_type const u = x0[l], v = x1[l];
+      x0[l] = reduce(u + v);
+      x1[l] = mulmod_shoup(u + get_modulus() - v, w, wprime);
+    }
+  }
+  // Also multiplies the sum by s
+  static inline void gs_butterfly(value_type * __restrict x0, value_type * __restrict x1,
+      value_type w, value_type wprime, value_type s, value_type sprime) {
+    for (size_t l = 0; l < Lanes; l++) {
+      value_type const u = x0[l], v = x1[l];
+      x0[l] = mulmod_shoup(reduce(u + v), s, sprime);
+      x1[l] = mulmod_shoup(u + get_modulus() - v, w, wprime);
+    }
+  }
+
+#ifdef __LP64__
+  value_type _data[Degree][Lanes] __attribute__((aligned(64)));
+#else
+  value_type _data[Degree][Lanes] __attribute__((aligned(32)));
+#endif
+};
+
+template<class T, size_t Degree, size_t Lanes>
+poly_batch<T, Degree, Lanes>::tables_t::tables_t()
+{
+  auto const mul = [](value_type x, value_type y) { return ops::mulmod<T, simd::serial>{}(x, y, 0); };
+
+  // phi is obtained as in poly::core::initialize, squaring the primitive
+  // 2*kMaxPolyDegree-th root until it is a primitive 2*Degree-th root
+  value_type phi = params<T>::primitive_roots[0];
+  for (unsigned int i = 0; i < static_log2<params<T>::kMaxPolyDegree>::value - static_log2<Degree>::value; i++)
+    phi = mul(phi, phi);
+  // phi**(2*Degree) = 1
+  value_type invphi = 1;
+  for (size_t i = 0; i < 2 * Degree - 1; i++)
+    invphi = mul(invphi, phi);
+
+  invK = mul(params<T>::invkMaxPolyDegree[0], static_cast<T>(params<T>::kMaxPolyDegree / Degree));
+  shoupinvK = shoup(invK);
+
+  // powers in bit-reversed order
+  constexpr size_t logn = static_log2<Degree>::value;
+  value_type pw = 1, invpw = 1;
+  for (size_t e = 0; e < Degree; e++) {
+    size_t k = 0;
+    for (size_t b = 0; b < logn; b++)
+      k |= ((e >> b) & 1) << (logn - 1 - b);
+    zetas[k] = pw;
+    invzetas[k] = invpw;
+    pw = mul(pw, phi);
+    invpw = mul(invpw, invphi);
+  }
+  // The last inverse layer also multiplies by invK
+  if (Degree > 1)
+    invzetas[1] = mul(invzetas[1], invK);
+  for (size_t k = 0; k < Degree; k++) {
+    shoupzetas[k] = shoup(zetas[k]);
+    shoupinvzetas[k] = shoup(invzetas[k]);
+  }
+}
+
+template<class T, size_t Degree, size_t Lanes>
+template <class in_class, unsigned _lu_depth>
+void poly_batch<T, Degree, Lanes>::set(gaussian<in_class, T, _lu_depth> const& mode)
+{
+  value_type * const x = &_data[0][0];
+  signed_value_type const amplifier = mode.amplifier;
+  mode.fg_prng->getNoise(*mode.ctx, x, Degree * Lanes);
+
+  for (size_t i = 0; i < Degree * Lanes; i++) {
+    signed_value_type const s = (signed_value_type) x[i] * amplifier;
+    x[i] = s < 0 ? get_modulus() + s : s;
+  }
+}
+
+template<class T, size_t Degree, size_t Lanes>
+void poly_batch<T, Degree, Lanes>::set(size_t l, poly_type const& a)
+{
+  for (size_t i = 0; i < Degree; i++)
+    _data[i][l] = a(0, i);
+}
+
+template<class T, size_t Degree, size_t Lanes>
+void poly_batch<T, Degree, Lanes>::get(size_t l, poly_type& a) const
+{
+  for (size_t i = 0; i < Degree; i++)
+    a(0, i) = _data[i][l];
+}
+
+template<class T, size_t Degree, size_t Lanes>
+void poly_batch<T, Degree, Lanes>::set(poly_type const* a, size_t m)
+{
+  constexpr size_t block = Degree < 64 / sizeof(T) ? Degree : 64 / sizeof(T);
+  for (size_t i = 0; i < Degree; i += block)
+    for (size_t l = 0; l < m; l++)
+      for (size_t j = i; j < i + block; j++)
+        _data[j][l] = a[l](0, j);
+}
+
+template<class T, size_t Degree, size_t Lanes>
+void poly_batch<T, Degree, Lanes>::get(poly_type* a, size_t m) const
+{
+  constexpr size_t block = Degree < 64 / sizeof(T) ? Degree : 64 / sizeof(T);
+  for (size_t i = 0; i < Degree; i += block)
+    for (size_t l = 0; l < m; l++)
+      for (size_t j = i; j < i + block; j++)
+        a[l](0, j) = _data[j][l];
+}
+
+template<class T, size_t Degree, size_t Lanes>
+poly_batch<T, Degree, Lanes>& poly_batch<T, Degree, Lanes>::operator+=(poly_batch const& a)
+{
+  for (size_t i = 0; i < Degree; i++)
+    for (size_t l = 0; l < Lanes; l++)
+      _data[i][l] = reduce(_data[i][l] + a._data[i][l]);
+  return *this;
+}
+
+template<class T, size_t Degree, size_t Lanes>
+poly_batch<T, Degree, Lanes>& poly_batch<T, Degree, Lanes>::operator-=(poly_batch const& a)
+{
+  for (size_t i = 0; i < Degree; i++)
+    for (size_t l = 0; l < Lanes; l++)
+      _data[i][l] = reduce(_data[i][l] + get_modulus() - a._data[i][l]);
+  return *this;
+}
+
+template<class T, size_t Degree, size_t Lanes>
+poly_batch<T, Degree, Lanes>& poly_batch<T, Degree, Lanes>::operator*=(poly_batch const& a)
+{
+  for (size_t i = 0; i < Degree; i++)
+    for (size_t l = 0; l < Lanes; l++)
+      _data[i][l] = mulmod(_data[i][l], a._data[i][l]);
+  return *this;
+}
+
+template<class T, size_t Degree, size_t Lanes>
+poly_batch<T, Degree, Lanes>& poly_batch<T, Degree, Lanes>::operator*=(poly_type const& a)
+{
+  for (size_t i = 0; i < Degree; i++) {
+    value_type const w = a(0, i), wprime = shoup(w);
+    for (size_t l = 0; l < Lanes; l++)
+      _data[i][l] = mulmod_shoup(_data[i][l], w, wprime);
+  }
+  return *this;
+}
+
+template<class T, size_t Degree, size_t Lanes>
+void poly_batch<T, Degree, Lanes>::muladd(poly_type const& a, poly_batch const& s, poly_batch const& e)
+{
+  for (size_t i = 0; i < Degree; i++) {
+    value_type const w = a(0, i), wprime = shoup(w);
+    for (size_t l = 0; l < Lanes; l++)
+      _data[i][l] = reduce(mulmod_shoup(s._data[i][l], w, wprime) + e._data[i][l]);
+  }
+}
+
+// Forward NTT with the phi powers merged into the twiddle factors
+// (Cooley-Tukey butterflies, natural order in, bit-reversed order out):
+// the butterfly of a layer runs on whole coefficient rows
+template<class T, size_t Degree, size_t Lanes>
+void poly_batch<T, Degree, Lanes>::ntt_pow_phi()
+{
+  tables_t const& tab = tables();
+
+  size_t k = 1;
+  for (size_t len = Degree / 2; len > 0; len >>= 1) {
+    for (size_t start = 0; start < Degree; start += 2 * len, k++) {
+      value_type const w = tab.zetas[k], wprime = tab.shoupzetas[k];
+      for (size_t j = start; j < start + len; j++)
+        ct_butterfly(_data[j], _data[j + len], w, wprime);
+    }
+  }
+}
+
+// Inverse NTT, undoing the layers of ntt_pow_phi in reverse order with
+// Gentleman-Sande butterflies, the last one also multiplying by invK
+template<class T, size_t Degree, size_t Lanes>
+void poly_batch<T, Degree, Lanes>::invntt_pow_invphi()
+{
+  tables_t const& tab = tables();
+
+  for (size_t len = 1; len < Degree / 2; len <<= 1) {
+    for (size_t start = 0, k = Degree / (2 * len); start < Degree; start += 2 * len, k++) {
+      value_type const w = tab.invzetas[k], wprime = tab.shoupinvzetas[k];
+      for (size_t j = start; j < start + len; j++)
+        gs_butterfly(_data[j], _data[j + len], w, wprime);
+    }
+  }
+
+  if (Degree > 1) {
+    size_t const len = Degree / 2;
+    value_type const w = tab.invzetas[1], wprime = tab.shoupinvzetas[1];
+    for (size_t j = 0; j < len; j++)
+      gs_butterfly(_data[j], _data[j + len], w, wprime, tab.invK, tab.shoupinvK);
+  }
+}
+
+// NTTs of n independent polynomials. Without a register-resident kernel
+// for the polynomial type (see ops::ntt_kernel), the last layers of each
+// NTT run on partly filled vectors, so the polynomials go through
+// transposed batches of Lanes polynomials instead
+template<size_t Lanes, class T, size_t Degree>
+void batch_ntt(poly<T, Degree, 1>* polys, size_t n, bool inverse)
+{
+  if (ops::ntt_kernel<CC_SIMD, T, Degree>::enabled) {
+    for (size_t i = 0; i < n; i++) {
+      if (inverse)
+        polys[i].invntt_pow_invphi();
+      else
+        polys[i].ntt_pow_phi();
+    }
+    return;
+  }
+
+  using batch_type = poly_batch<T, Degree, Lanes>;
+  // zero initialised: the lanes of an incomplete batch stay valid values
+  std::vector<batch_type, aligned_allocator<batch_type, 64>> batch(1);
+  for (size_t i = 0; i < n; i += Lanes) {
+    size_t const m = std::min(Lanes, n - i);
+    batch[0].set(polys + i, m);
+    if (inverse)
+      batch[0].invntt_pow_invphi();
+    else
+      batch[0].ntt_pow_phi();
+    batch[0].get(polys + i, m);
+  }
+}
+
+template<class T, size_t Degree>
+void batch_ntt_pow_phi(poly<T, Degree, 1>* polys, size_t n)
+{
+  batch_ntt<64 / sizeof(T)>(polys, n, false);
+}
+
+template<class T, size_t Degree>
+void batch_invntt_pow_invphi(poly<T, Degree, 1>* polys, size_t n)
+{
+  batch_ntt<64 / sizeof(T)>(polys, n, true);
+}
+
+}
+
+#endif
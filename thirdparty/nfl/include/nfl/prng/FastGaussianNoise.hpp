@@ -3,7 +3,11 @@
 
 #include <cstdint>
 #include <cstddef>
-#include <list>
+#include <limits>
+#include <initializer_list>
+#include <ostream>
+#include <stdexcept>
+#include <algorithm>
 #include <iostream>
 #include <cstdlib>
 #include <ctime>
@@ -14,7 +18,9 @@
 #include <typeinfo>
 #include <gmp.h>
 #include <mpfr.h>
+#include <vector>
 #include "fastrandombytes.h"
+#include "nfl/aligned_allocator.hpp"
 
 #ifdef BOOST_RAPHSON
 #include <boost/math/tools/roots.hpp>
@@ -29,7 +35,6 @@
 namespace nfl {
 
 #ifdef NTT_USE_NOISE_CACHE
-    static uint32_t CACHE_POINTER = 0;
     const static uint32_t CACHE_NOISE_SIZE = 30720;
     static uint32_t CACHE_NOISE[] = {
 0xFFFFFFFF, 0x00000001, 0x00000001, 0x00000003, 0xFFFFFFFF, 0x00000002, 0xFFFFFFFD, 0x00000001,
@@ -3878,16 +3883,23 @@ namespace nfl {
 template<typename T0, typename T1>
 constexpr inline auto tstbit(T0 x, T1 n) -> decltype((x << (63 - n)) >> 63 ) { return ((x << (63 - n)) >> 63 ); }
 
-template<class in_class, class out_class>
-struct output {
-  out_class val;
-  bool flag;
-  std::list<in_class*> l_b_ptr;
+// Lookup table as a structure of arrays. A flagged entry is resolved by
+// comparing the input with the barriers [first, first + count) of the
+// packed barrier matrix, or, in the first level of a two-level table, by
+// the second level row starting at first
+template<class out_class>
+struct lookup_table {
+  template<class U> using vector = std::vector<U, aligned_allocator<U, 64>>;
+  vector<out_class> val;
+  vector<uint8_t> flag;
+  vector<uint32_t> first;
+  vector<uint16_t> count;
+
+  void resize(size_t n) { val.resize(n); flag.resize(n); first.resize(n); count.resize(n); }
 };
 
 template<class in_class, class out_class, unsigned _lu_depth>
 class FastGaussianNoise {
-    typedef output<in_class, out_class> output_t;
   private:
     unsigned int _bit_precision;
     unsigned int _word_precision;
@@ -3904,23 +3916,34 @@ class FastGaussianNoise {
     double _tail_bound;
     bool _verbose;
 
-    in_class **barriers;
-    output_t *lu_table;
-    output_t **lu_table2;
+    // _number_of_barriers rows of _word_precision words, followed by an
+    // all-ones sentinel row
+    std::vector<in_class, aligned_allocator<in_class, 64>> barriers;
+    lookup_table<out_class> lu_table;
+    // One row of _lu_size entries per flagged entry of lu_table
+    lookup_table<out_class> lu_table2;
+
+    in_class const *barrier(size_t b) const { return barriers.data() + b * _word_precision; }
+    unsigned search(uint32_t first, uint16_t count, in_class const *noise) const;
 
     void check_template_params();
     void init();
     void precomputeBarrierValues();
     void buildLookupTables();
     void nn_gaussian_law(mpfr_t rop, const mpfr_t x_fr);
-    int cmp(in_class *op1, in_class *op2);
+    int cmp(in_class const *op1, in_class const *op2) const;
 
   public:
     static const unsigned int default_k;
     FastGaussianNoise(double sigma, unsigned int security, unsigned int samples, double center_d = 0, bool verbose = false);
     FastGaussianNoise(double sigma, unsigned int security, unsigned int samples, mpfr_t center, bool verbose = false);
+    // Load the tables written by save(), e.g. embedded in a header by the
+    // gaussian_tables generator or mapped from a file: no MPFR computation
+    FastGaussianNoise(void const *blob, size_t size, bool verbose = false);
+    void save(std::ostream &os) const;
     ~FastGaussianNoise();
     void getNoise(out_class * const rand_data2out, uint64_t rlen);
+    void getNoise(prng_ctx_t &ctx, out_class * const rand_data2out, uint64_t rlen);
 };
 
 
@@ -4066,6 +4089,122 @@ FastGaussianNoise<in_class, out_class, _lu_depth>::FastGaussianNoise( double sig
 }
 
 
+// Persisted tables
+//
+// Blob layout, in the native byte order (the blob is a build artifact of
+// the target): magic, the sizes of in_class and out_class, _lu_depth,
+// the sampler parameters and the table sizes, then the barrier matrix
+// (sentinel included) and the val, flag, first and count arrays of
+// lu_table and of lu_table2
+static const char fast_gaussian_noise_magic[8] = {'N', 'F', 'L', 'G', 'N', '0', '0', '1'};
+
+template<class in_class, class out_class, unsigned _lu_depth>
+void FastGaussianNoise<in_class, out_class, _lu_depth>::save(std::ostream &os) const
+{
+  auto put = [&os](void const *data, size_t bytes) { os.write((char const *)data, bytes); };
+  uint32_t const header[] = {
+    (uint32_t)sizeof(in_class), (uint32_t)sizeof(out_class), _lu_depth,
+    _security, _samples, _bit_precision, _word_precision,
+    _number_of_barriers, _lu_size, _flag_ctr1, _flag_ctr2, (uint32_t)rounded_center
+  };
+  double const values[] = { _sigma, _tail_bound, mpfr_get_d(_center, MPFR_RNDN) };
+  uint64_t const lu_size2 = lu_table2.val.size();
+
+  put(fast_gaussian_noise_magic, sizeof(fast_gaussian_noise_magic));
+  put(header, sizeof(header));
+  put(values, sizeof(values));
+  put(&lu_size2, sizeof(lu_size2));
+  put(barriers.data(), barriers.size() * sizeof(in_class));
+  for (lookup_table<out_class> const *t : {&lu_table, &lu_table2})
+  {
+    put(t->val.data(), t->val.size() * sizeof(out_class));
+    put(t->flag.data(), t->flag.size() * sizeof(uint8_t));
+    put(t->first.data(), t->first.size() * sizeof(uint32_t));
+    put(t->count.data(), t->count.size() * sizeof(uint16_t));
+  }
+}
+
+template<class in_class, class out_class, unsigned _lu_depth>
+FastGaussianNoise<in_class, out_class, _lu_depth>::FastGaussianNoise(void const *blob, size_t size, bool verbose):
+  _verbose(verbose)
+{
+  unsigned char const *ptr = (unsigned char const *)blob, *end = ptr + size;
+  auto get = [&ptr, end](void *data, size_t bytes) {
+    if ((size_t)(end - ptr) < bytes)
+      throw std::runtime_error("FastGaussianNoise: truncated tables");
+    memcpy(data, ptr, bytes);
+    ptr += bytes;
+  };
+  char magic[sizeof(fast_gaussian_noise_magic)];
+  uint32_t header[12];
+  double values[3];
+  uint64_t lu_size2;
+
+  check_template_params();
+  get(magic, sizeof(magic));
+  if (memcmp(magic, fast_gaussian_noise_magic, sizeof(magic)) != 0)
+    throw std::runtime_error("FastGaussianNoise: not a table blob");
+  get(header, sizeof(header));
+  if (header[0] != sizeof(in_class) || header[1] != sizeof(out_class) || header[2] != _lu_depth || header[8] != _lu_size)
+    throw std::runtime_error("FastGaussianNoise: tables built for other template parameters");
+  _security = header[3];
+  _samples = header[4];
+  _bit_precision = header[5];
+  _word_precision = header[6];
+  _number_of_barriers = header[7];
+  _flag_ctr1 = header[9];
+  _flag_ctr2 = header[10];
+  rounded_center = (int)header[11];
+  get(values, sizeof(values));
+  _sigma = values[0];
+  _tail_bound = values[1];
+  get(&lu_size2, sizeof(lu_size2));
+
+  // Check the header before sizing anything from it: the sizes are
+  // computed on 64 bits and bounded by the blob size, and the precision
+  // must fit in the PRNG buffer read by getNoise
+  uint64_t const barrier_words = ((uint64_t)_number_of_barriers + 1) * _word_precision;
+  if (_word_precision < _lu_depth
+      || (uint64_t)_bit_precision != (uint64_t)_word_precision * 8 * sizeof(in_class)
+      || (uint64_t)_word_precision * sizeof(in_class) > prng_ctx_t::BUFFERBYTES
+      || lu_size2 != (_lu_depth == 2 ? (uint64_t)_flag_ctr1 * _lu_size : 0)
+      || barrier_words > (uint64_t)(end - ptr) / sizeof(in_class)
+      || lu_size2 > (uint64_t)(end - ptr))
+    throw std::runtime_error("FastGaussianNoise: corrupted tables header");
+
+  barriers.resize(barrier_words);
+  get(barriers.data(), barriers.size() * sizeof(in_class));
+  lu_table.resize(_lu_size);
+  lu_table2.resize(lu_size2);
+  for (lookup_table<out_class> *t : {&lu_table, &lu_table2})
+  {
+    get(t->val.data(), t->val.size() * sizeof(out_class));
+    get(t->flag.data(), t->flag.size() * sizeof(uint8_t));
+    get(t->first.data(), t->first.size() * sizeof(uint32_t));
+    get(t->count.data(), t->count.size() * sizeof(uint16_t));
+  }
+  if (ptr != end)
+    throw std::runtime_error("FastGaussianNoise: trailing bytes after the tables");
+
+  // Every flagged entry must stay within the barriers, or within
+  // lu_table2 for the first level of a two-level table
+  for (size_t i = 0; i < _lu_size; i++)
+    if (lu_table.flag[i] && (_lu_depth == 2
+                             ? (uint64_t)lu_table.first[i] + _lu_size > lu_size2
+                             : (uint64_t)lu_table.first[i] + lu_table.count[i] > _number_of_barriers))
+      throw std::runtime_error("FastGaussianNoise: lookup entry out of the tables");
+  for (size_t e = 0; e < lu_size2; e++)
+    if (lu_table2.flag[e] && (uint64_t)lu_table2.first[e] + lu_table2.count[e] > _number_of_barriers)
+      throw std::runtime_error("FastGaussianNoise: lookup entry out of the tables");
+
+  // Only kept for the destructor, the tables are already computed
+  mpfr_init_set_d(_center, values[2], MPFR_RNDN);
+  mpfr_init_set_d(_const_sigma, 1. / (2 * _sigma * _sigma), MPFR_RNDN);
+
+  if (_verbose) std::cout << "FastGaussianNoise: Lookup tables loaded" << std::endl;
+}
+
+
 // Check template parameters
 template<class in_class, class out_class, unsigned _lu_depth>
 void FastGaussianNoise<in_class, out_class, _lu_depth>::check_template_params()
@@ -4170,8 +4309,9 @@ void FastGaussianNoise<in_class, out_class, _lu_depth>::precomputeBarrierValues(
   // and compute on the loop with the barriers
   mpfr_set_ui(sum, 0, MPFR_RNDN);
 
-  // Allocate memory for the barrier pointers
-  barriers = (in_class **) malloc(_number_of_barriers*sizeof(in_class *));
+  // Allocate memory for the barriers and the sentinel
+  barriers.assign((_number_of_barriers + 1) * _word_precision, 0);
+  std::fill(barriers.begin() + _number_of_barriers * _word_precision, barriers.end(), std::numeric_limits<in_class>::max());
   mp_barriers = (mpfr_t *) malloc(_number_of_barriers*sizeof(mpfr_t));
 
   // Now loop over the barriers
@@ -4205,20 +4345,17 @@ void FastGaussianNoise<in_class, out_class, _lu_depth>::precomputeBarrierValues(
   // Now that we got the inverted sum normalize and export
   for (unsigned i = 0; i < _number_of_barriers; i++)
   {
-    // Allocate space
-    barriers[i] = (in_class *) calloc(_word_precision,sizeof(in_class));
-
     mpfr_mul(mp_barriers[i], mp_barriers[i], sum, MPFR_RNDN);
     mpfr_get_z(int_value, mp_barriers[i], MPFR_RNDN);
-    mpz_export((void *) (barriers[i] + ((int)_word_precision -
+    mpz_export((void *) (barriers.data() + i * _word_precision + ((int)_word_precision -
            (int)ceil( (float)mpz_sizeinbase(int_value, 256)/sizeof(in_class) ))), nullptr, 1, sizeof(in_class), 0, 0, int_value);
 #ifdef OUTPUT_BARRIERS
     mpz_out_str(stdout, 10, int_value);
     std::cout << " = Barriers[" << i << "] = " << std::endl;
     if (sizeof(in_class) == 1) for (unsigned j = 0 ; j < _word_precision; j++)
-      printf("%.2x", barriers[i][j]);
+      printf("%.2x", barrier(i)[j]);
     if (sizeof(in_class) == 2) for (unsigned j = 0 ; j < _word_precision; j++)
-      printf("%.4x", barriers[i][j]);
+      printf("%.4x", barrier(i)[j]);
     std::cout <<  std::endl;
 #endif
     mpfr_clear(mp_barriers[i]);
@@ -4238,25 +4375,24 @@ void FastGaussianNoise<in_class, out_class, _lu_depth>::buildLookupTables()
 	unsigned lu_index1 = 0, lu_index2 = 0;
   _flag_ctr1 = _flag_ctr2 = 0;
 
-  // Allocate space for the lookup tables
-  lu_table = new output_t[_lu_size]();
-  if(_lu_depth == 2)
-    lu_table2 = (output_t **) calloc(_lu_size,sizeof(output_t *));
+  // Allocate space for the first level, the second level grows by one
+  // row per flagged entry
+  lu_table.resize(_lu_size);
 
 	// We start building the first dimension of the lookup table
   // corresponding to the first in_class word of the barriers
 	for (int64_t val = -((int)_number_of_barriers-1)/2 + rounded_center, b_index = 0; val <= ((int)_number_of_barriers-1)/2 + rounded_center && lu_index1 < _lu_size;)
   {
 
-		while (lu_index1 < barriers[b_index][0] && lu_index1 < _lu_size)
+		while (lu_index1 < barrier(b_index)[0] && lu_index1 < _lu_size)
     {
-      lu_table[lu_index1].val = val;
+      lu_table.val[lu_index1] = val;
 			lu_index1++;
 		}
 
 		// Flag the entry
-		lu_table[lu_index1].val = val;
-		lu_table[lu_index1].flag = true;
+		lu_table.val[lu_index1] = val;
+		lu_table.flag[lu_index1] = 1;
     _flag_ctr1++;
 		// If _lu_depth == 1 we have to list the barriers here
     if (_lu_depth == 1)
@@ -4266,13 +4402,14 @@ void FastGaussianNoise<in_class, out_class, _lu_depth>::buildLookupTables()
        << lu_index1 << "] for barriers " << val;
 #endif
 
-      // Prepare the first element of the chained list of barrier
-			lu_table[lu_index1].l_b_ptr.push_back(barriers[b_index++]);
+      // The barriers of the entry are consecutive in the matrix
+			lu_table.first[lu_index1] = b_index++;
+			lu_table.count[lu_index1] = 1;
       val++;
-			// If more that one barrier is present, we add them to the chained list
-			while ( (b_index<_number_of_barriers) && (lu_index1 == barriers[b_index][0]))
+			// If more that one barrier is present, we add them to the range
+			while ( (b_index<_number_of_barriers) && (lu_index1 == barrier(b_index)[0]))
       {
-			  lu_table[lu_index1].l_b_ptr.push_back(barriers[b_index]);
+			  lu_table.count[lu_index1]++;
 #ifdef OUTPUT_LUT_FLAGS
       std::cout << "FastGaussianNoise: flagged lu_table[" << lu_index1 << "] for barriers " << val;
 #endif
@@ -4284,37 +4421,41 @@ void FastGaussianNoise<in_class, out_class, _lu_depth>::buildLookupTables()
     if (_lu_depth == 2)
     {
       // When we meet a barrier in an entry of the lu_table,
-      // we build another lu_table inside that entry
+      // we build another lu_table row for that entry
 		  // corresponding to the next in_class word of the barriers
 		  lu_index2 = 0;
-      lu_table2[lu_index1] = new output_t[_lu_size]();
+      size_t const row = lu_table2.val.size();
+      lu_table.first[lu_index1] = row;
+      lu_table2.resize(row + _lu_size);
 		  while (lu_index2 < _lu_size)
       {
-			  if(lu_index1 < barriers[b_index][0] || lu_index2 < barriers[b_index][1])
+        size_t const e = row + lu_index2;
+			  if(lu_index1 < barrier(b_index)[0] || lu_index2 < barrier(b_index)[1])
         {
-          lu_table2[lu_index1][lu_index2].val = val;
+          lu_table2.val[e] = val;
         }
         else
         {
 		      // If we are on a barrier
-		      if (lu_index1 == barriers[b_index][0] && lu_index2 == barriers[b_index][1])
+		      if (lu_index1 == barrier(b_index)[0] && lu_index2 == barrier(b_index)[1])
           {
 			      // Flag the entry
-			      lu_table2[lu_index1][lu_index2].val = val;
-			      lu_table2[lu_index1][lu_index2].flag = true;
+			      lu_table2.val[e] = val;
+			      lu_table2.flag[e] = 1;
 #ifdef OUTPUT_LUT_FLAGS
             std::cout << "FastGaussianNoise: flagged lu_table2[" << lu_index1 << "][" << lu_index2 << "] for barriers " << val;
 #endif
             _flag_ctr2++;
-			      // And prepare the first element of the chained list of barrier
-			      lu_table2[lu_index1][lu_index2].l_b_ptr.push_back(barriers[b_index++]);
+			      // The barriers of the entry are consecutive in the matrix
+			      lu_table2.first[e] = b_index++;
+			      lu_table2.count[e] = 1;
             val++;
-			      // If more that one barrier is present, we add them to the chained list
+			      // If more that one barrier is present, we add them to the range
 			      while ( (b_index<_number_of_barriers) &&
-                (lu_index1 == barriers[b_index][0]) &&
-                (lu_index2 == barriers[b_index][1]) )
+                (lu_index1 == barrier(b_index)[0]) &&
+                (lu_index2 == barrier(b_index)[1]) )
             {
-				      lu_table2[lu_index1][lu_index2].l_b_ptr.push_back(barriers[b_index]);
+				      lu_table2.count[e]++;
 #ifdef OUTPUT_LUT_FLAGS
             std::cout << " " << val;
 #endif
@@ -4338,103 +4479,84 @@ void FastGaussianNoise<in_class, out_class, _lu_depth>::buildLookupTables()
 
 template<class in_class, class out_class, unsigned _lu_depth>
 void FastGaussianNoise<in_class, out_class, _lu_depth>::getNoise(out_class* const rand_outdata, uint64_t rlen)
+{
+  getNoise(default_prng_ctx(), rand_outdata, rlen);
+}
+
+// The lookup tables are read-only once built, so a single sampler can be
+// shared by several threads as long as each one passes its own context
+template<class in_class, class out_class, unsigned _lu_depth>
+void FastGaussianNoise<in_class, out_class, _lu_depth>::getNoise(prng_ctx_t &ctx, out_class* const rand_outdata, uint64_t rlen)
 {
 #ifdef NTT_USE_NOISE_CACHE
-    if (CACHE_POINTER + (rlen * sizeof(out_class)) >= CACHE_NOISE_SIZE) {
-        CACHE_POINTER = CACHE_POINTER + (rlen * sizeof(out_class)) - CACHE_NOISE_SIZE;
+    if (ctx.noise_pointer + (rlen * sizeof(out_class)) >= CACHE_NOISE_SIZE) {
+        ctx.noise_pointer = ctx.noise_pointer + (rlen * sizeof(out_class)) - CACHE_NOISE_SIZE;
     }
-    memcpy(rand_outdata, CACHE_NOISE + CACHE_POINTER, rlen * sizeof(out_class));
-    CACHE_POINTER += (rlen * sizeof(out_class));
+    memcpy(rand_outdata, CACHE_NOISE + ctx.noise_pointer, rlen * sizeof(out_class));
+    ctx.noise_pointer += (rlen * sizeof(out_class));
 #else
-	uint64_t computed_outputs, innoise_bytesize, innoise_words, used_words;
+	uint64_t computed_outputs;
 	int64_t output;
   bool flagged;
-	in_class *noise, *noise_init_ptr, input1, input2;
-  float innoise_multiplier;
-
-  // Expected number of input bytes per output byte. Lowering this
-  // (e.g. by a factor .5) works but could lead to segfaults.
-  if (_lu_depth == 1)
-  {
-    innoise_multiplier = 1.05 * ((float)(_lu_size - _flag_ctr1)/(float)_lu_size) + _word_precision * ((float)_flag_ctr1/_lu_size);
-  }
-  else // _lu_depth == 2
-  {
-    innoise_multiplier = 1.05 * ((float)(_lu_size - _flag_ctr1)/(float)_lu_size) + 2.0 * ((float)_flag_ctr1/(float)_lu_size) + _word_precision * ((float)_flag_ctr2/((float)_lu_size*_lu_size));
-  }
-  innoise_words = rlen * innoise_multiplier;
-  innoise_bytesize = sizeof(in_class) * innoise_words;
-	noise = noise_init_ptr = new in_class[innoise_words];
-  used_words = 0;
-  if (_verbose) std::cout << "FastGaussianNoise: Using " << " " <<innoise_multiplier*sizeof(in_class)*8/std::min(log2(_number_of_barriers),(double)sizeof(out_class)*8) << " input bits per output bit" << std::endl;
-
-  // Count time for uniform noise generation
-	uint64_t start = rdtsc();
-	fastrandombytes((uint8_t*)noise, innoise_bytesize);
-	uint64_t stop = rdtsc();
+	in_class const *noise, *noise_init_ptr;
+	in_class input1, input2;
+  // A sample reads at most _word_precision words
+  size_t const lookahead = _word_precision * sizeof(in_class);
+  if (lookahead > prng_ctx_t::BUFFERBYTES)
+    throw std::runtime_error("FastGaussianNoise: precision larger than the PRNG buffer");
 
-  // Give some feedback
-	if (_verbose) printf("FastGaussianNoise: Uniform noise  cycles = %.2e bits = %.2e cycles/bit = %.2e\n", (float) stop - start, (float) innoise_bytesize * 8, (float)(stop-start)/(innoise_bytesize*8));
-
-  // Loop until all the outputs have been generated
+  // Loop until all the outputs have been generated, reading the uniform
+  // words in place from the context's buffer
   computed_outputs = 0;
 	while (computed_outputs < rlen )
   {
+    // Refill when the buffer might not hold a whole sample
+    if (ctx.buffer_pos + lookahead > prng_ctx_t::BUFFERBYTES)
+    {
+      if (_verbose) std::cout << "FastGaussianNoise: All the buffered input bits have been used, regenerating them ..." << std::endl;
+      ctx.refill();
+    }
+    noise = noise_init_ptr = (in_class const *)(ctx.buffer + ctx.buffer_pos);
 		input1 = *noise;
-		flagged = lu_table[input1].flag;
+		flagged = lu_table.flag[input1];
 
     // If flagged we have to look at the next in_class word
     if (flagged)
     {
 		  if (_lu_depth == 1)
       {
-				output = lu_table[input1].val;
-				for(in_class* b_ptr : lu_table[input1].l_b_ptr)
-        {
-					// If the barrier value is greater than the noise
-					if(cmp(b_ptr, noise)==1) break;
-					output++;
-				}
+				output = lu_table.val[input1] + search(lu_table.first[input1], lu_table.count[input1], noise);
         // We shift the noise pointer of word_precision minus 1
         // As there another byte shift later
 				noise += _word_precision - 1;
-				used_words += _word_precision - 1;
 
       }
       else // _lu_depth == 2
       {
 			  input2 = *(noise+1);
-			  flagged = lu_table2[input1][input2].flag;
+			  size_t const e = lu_table.first[input1] + input2;
+			  flagged = lu_table2.flag[e];
         // If flagged again we compare using full precision the random value
-        // with all barriers in the linked list of the lookup table
+        // with the barriers of the entry
 			  if (flagged)
         {
-			    output = lu_table2[input1][input2].val;
-				  for(in_class* b_ptr : lu_table2[input1][input2].l_b_ptr)
-          {
-					  // If the barrier value is greater than the noise
-					  if(cmp(b_ptr, noise)==1) break;
-					  output++;
-				  }
+			    output = lu_table2.val[e] + search(lu_table2.first[e], lu_table2.count[e], noise);
           // We shift the noise pointer of word_precision minus 2
           // As there are two other one byte shifts later
 				  noise += _word_precision - 2;
-				  used_words += _word_precision - 2;
 			  } // if
         else
         {
-			    output = lu_table2[input1][input2].val;
+			    output = lu_table2.val[e];
         }
         noise++;
-        used_words++;
       } // else
     }
     else
     {
-		  output = lu_table[input1].val;
+		  output = lu_table.val[input1];
     }
 		noise++;
-    used_words++;
 		// Add the obtained result to the list of outputs
 		rand_outdata[computed_outputs++] = (out_class) output;
 
@@ -4448,26 +4570,15 @@ void FastGaussianNoise<in_class, out_class, _lu_depth>::getNoise(out_class* cons
     }
 #endif
 
-#if 1
-    // If too much noise has been used regenerate it
-    if ((used_words+_word_precision) >= innoise_words)
-    {
-      noise = noise_init_ptr;
-      used_words = 0;
-      if (_verbose) std::cout << "FastGaussianNoise: All the input bits have been used, regenerating them ..." << std::endl;
-
-	    fastrandombytes((uint8_t*)noise, innoise_bytesize);
-    }
-#endif
+    ctx.buffer_pos += (noise - noise_init_ptr) * sizeof(in_class);
 	}
-	delete[] noise_init_ptr;
 #endif
 }
 
 /* Compare two arrays word by word.
  * return 1 if op1 > op2, 0 if equals and -1 if op1 < op2 */
 template<class in_class, class out_class, unsigned _lu_depth>
-inline int FastGaussianNoise<in_class, out_class, _lu_depth>::cmp(in_class *op1, in_class *op2)
+inline int FastGaussianNoise<in_class, out_class, _lu_depth>::cmp(in_class const *op1, in_class const *op2) const
 {
 
 	for (int i = 0; i < (int)_word_precision; i++)
@@ -4481,6 +4592,17 @@ inline int FastGaussianNoise<in_class, out_class, _lu_depth>::cmp(in_class *op1,
 }
 
 
+// Number of barriers of [first, first + count) which are not greater than
+// the noise
+template<class in_class, class out_class, unsigned _lu_depth>
+inline unsigned FastGaussianNoise<in_class, out_class, _lu_depth>::search(uint32_t first, uint16_t count, in_class const *noise) const
+{
+  unsigned n = 0;
+  for (in_class const *b = barrier(first); n < count && cmp(b, noise) != 1; b += _word_precision)
+    n++;
+  return n;
+}
+
 // Compute exp(-(x-center)^2/(2*sigma^2)) this is not normalized ! (hence the nn)
 template<class in_class, class out_class, unsigned _lu_depth>
 void  inline FastGaussianNoise<in_class, out_class, _lu_depth>::nn_gaussian_law(mpfr_t rop, const mpfr_t x)
@@ -4496,27 +4618,9 @@ void  inline FastGaussianNoise<in_class, out_class, _lu_depth>::nn_gaussian_law(
 template<class in_class, class out_class, unsigned _lu_depth>
 FastGaussianNoise<in_class, out_class, _lu_depth>::~FastGaussianNoise()
 {
-  // Freed allocated memory for the barriers
-  for (unsigned ctr = 0; ctr < _number_of_barriers; ctr++)
-  {
-    if (barriers[ctr] != nullptr) free(barriers[ctr]);
-    barriers[ctr] = nullptr;
-  }
-  if (barriers != nullptr) free(barriers);
-  barriers=nullptr;
-
-  // Free other variables
+  // Free the mpfr variables, the tables free themselves
   mpfr_clear(_const_sigma);
   mpfr_clear(_center);
-  delete[](lu_table);
-  if(_lu_depth == 2)
-  {
-    for (unsigned ctr = 0 ; ctr < _lu_size; ctr++)
-    {
-      if (lu_table2[ctr]!=nullptr) delete[](lu_table2[ctr]);
-    }
-    free(lu_table2);
-  }
 }
 
 }  // namespace nfl
@@ -0,0 +1,19 @@
+#ifndef CRYPTO_STREAM_AES256CTR_H
+#define CRYPTO_STREAM_AES256CTR_H
+
+// AES-256 in counter mode, with the calling convention of
+// nfl_crypto_stream_salsa20: clen bytes of keystream under the 32-byte
+// key k, the counter block being the 8-byte nonce n followed by a 64-bit
+// big-endian block counter starting at 0. Only available with the AES-NI
+// instructions of x86, NFL_HAVE_AES256CTR is defined then.
+#if defined(__AES__) && (defined __x86_64__ || defined __i386__)
+#define NFL_HAVE_AES256CTR 1
+
+extern "C" {
+int nfl_crypto_stream_aes256ctr(unsigned char *c, unsigned long long clen,
+                                const unsigned char *n,
+                                const unsigned char *k);
+}
+#endif
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef CRYPTO_STREAM_CHACHA20_H
+#define CRYPTO_STREAM_CHACHA20_H
+
+// ChaCha20 keystream (64-bit nonce, 64-bit block counter starting at 0),
+// with the calling convention of nfl_crypto_stream_salsa20: clen bytes
+// of keystream under the 8-byte nonce n and the 32-byte key k. Computes
+// 8 blocks at once with AVX2 and 4 with SSE.
+extern "C" {
+int nfl_crypto_stream_chacha20(unsigned char *c, unsigned long long clen,
+                               const unsigned char *n,
+                               const unsigned char *k);
+}
+
+#endif
@@ -7,7 +7,50 @@
 #ifndef FASTRANDOMBYTES_H
 #define FASTRANDOMBYTES_H
 
+#include <cstddef>
+#include <cstdint>
+
 namespace nfl {
+
+/* State of a PRNG stream, keystream of the stream cipher selected at
+ * build time (see fastrandombytes_backend). Each thread must use its own
+ * context: contexts are not synchronised.
+ */
+struct prng_ctx_t {
+  static constexpr size_t KEYBYTES = 32;
+  static constexpr size_t NONCEBYTES = 8;
+
+  unsigned char key[KEYBYTES];
+  unsigned char nonce[NONCEBYTES];
+  // The key is drawn from randombytes on first use unless seed() was called
+  int init;
+  // Read positions in the uniform and Gaussian noise caches
+  // (only used with NTT_USE_NOISE_CACHE)
+  size_t rand_pointer;
+  uint32_t noise_pointer;
+  // Uniform bytes drawn ahead from the stream, from which small
+  // fastrandombytes requests and FastGaussianNoise are served:
+  // buffer[buffer_pos, BUFFERBYTES) is unread
+  static constexpr size_t BUFFERBYTES = 4096;
+  alignas(16) unsigned char buffer[BUFFERBYTES];
+  size_t buffer_pos;
+
+  prng_ctx_t();
+  // Deterministically key the stream (and rewind the noise caches)
+  void seed(const unsigned char k[KEYBYTES]);
+  // Move the unread bytes to the front of the buffer and fill the rest
+  // with a single stream call
+  void refill();
+};
+
+// Per-thread context used when none is given explicitly
+prng_ctx_t &default_prng_ctx();
+
+// Name of the stream cipher: "salsa20", "chacha20" (NFL_PRNG_CHACHA20)
+// or "aes256ctr" (NFL_PRNG_AES_CTR)
+const char *fastrandombytes_backend();
+
+void fastrandombytes(prng_ctx_t &ctx, unsigned char *r, unsigned long long rlen);
 void fastrandombytes(unsigned char *r, unsigned long long rlen);
 }
 
@@ -8,8 +8,16 @@
 #include <iostream>
 #include <stdio.h>
 #include <cstring>
+#include <algorithm>
 #include "nfl/prng/crypto_stream_salsa20.h"
+#include "nfl/prng/crypto_stream_chacha20.h"
+#include "nfl/prng/crypto_stream_aes256ctr.h"
 #include "nfl/prng/randombytes.h"
+#include "nfl/prng/fastrandombytes.h"
+
+#if defined(NFL_PRNG_AES_CTR) && !defined(NFL_HAVE_AES256CTR)
+#error NFL_PRNG_AES_CTR requires the AES-NI instructions
+#endif
 
 namespace nfl {
 
@@ -3638,38 +3646,101 @@ static uint8_t CACHE_RAND[CACHE_RAND_SIZE] = {
     0xBA, 0x72, 0xCD, 0xD3, 0x9F, 0xC5, 0x62, 0xB2, 0x36, 0x0E, 0xAE, 0x38, 0x92, 0x81, 0xB8,
     0xA5, 0xF3, 0xD6, 0x7D, 0xF5, 0x6D, 0x58, 0xB2, 0xDA, 0x17, 0xF1, 0x93, 0xEC, 0xB2, 0x06
 };
-static size_t pointer = 0;
 #endif
 
-static size_t constexpr crypto_stream_salsa20_KEYBYTES = 32;
-static size_t constexpr crypto_stream_salsa20_NONCEBYTES = 8;
+prng_ctx_t::prng_ctx_t()
+  : nonce{0}, init(0), rand_pointer(0), noise_pointer(0), buffer_pos(BUFFERBYTES) {
+}
 
-static int init = 0;
-static unsigned char key[crypto_stream_salsa20_KEYBYTES];
-static unsigned char nonce[crypto_stream_salsa20_NONCEBYTES] = {0};
+void prng_ctx_t::seed(const unsigned char k[KEYBYTES]) {
+  memcpy(key, k, KEYBYTES);
+  memset(nonce, 0, NONCEBYTES);
+  init = 1;
+  rand_pointer = 0;
+  noise_pointer = 0;
+  buffer_pos = BUFFERBYTES;
+}
 
-void fastrandombytes(unsigned char *r, unsigned long long rlen) {
-#ifdef NTT_USE_NOISE_CACHE
-    if (pointer + rlen > CACHE_RAND_SIZE) {
-        pointer = pointer + rlen - CACHE_RAND_SIZE;
-        memcpy(r, CACHE_RAND+pointer, rlen * sizeof(unsigned char));
-    } else {
-        memcpy(r, CACHE_RAND+pointer, rlen * sizeof(unsigned char));
-        pointer+=rlen;
-    }
+// Keystream of the stream cipher selected at build time
+// (NFL_PRNG_CHACHA20, NFL_PRNG_AES_CTR, Salsa20 otherwise)
+static void crypto_stream(unsigned char *c, unsigned long long clen,
+                          const unsigned char *n, const unsigned char *k) {
+#if defined(NFL_PRNG_CHACHA20)
+  nfl_crypto_stream_chacha20(c, clen, n, k);
+#elif defined(NFL_PRNG_AES_CTR)
+  nfl_crypto_stream_aes256ctr(c, clen, n, k);
 #else
+  nfl_crypto_stream_salsa20(c, clen, n, k);
+#endif
+}
+
+const char *fastrandombytes_backend() {
+#if defined(NFL_PRNG_CHACHA20)
+  return "chacha20";
+#elif defined(NFL_PRNG_AES_CTR)
+  return "aes256ctr";
+#else
+  return "salsa20";
+#endif
+}
+
+// A single stream call under the current nonce, which is then increased
+static void stream(prng_ctx_t &ctx, unsigned char *r, unsigned long long rlen) {
   unsigned long long n = 0;
-  int i;
-  if (!init) {
-    randombytes(key, crypto_stream_salsa20_KEYBYTES);
-    init = 1;
+  size_t i;
+  if (!ctx.init) {
+    randombytes(ctx.key, prng_ctx_t::KEYBYTES);
+    ctx.init = 1;
   }
-  nfl_crypto_stream_salsa20(r, rlen, nonce, key);
+  crypto_stream(r, rlen, ctx.nonce, ctx.key);
 
   // Increase 64-bit counter (nonce)
-  for (i = 0; i < crypto_stream_salsa20_NONCEBYTES; i++) n ^= ((unsigned long long)nonce[i]) << 8 * i;
+  for (i = 0; i < prng_ctx_t::NONCEBYTES; i++) n ^= ((unsigned long long)ctx.nonce[i]) << 8 * i;
   n++;
-  for (i = 0; i < crypto_stream_salsa20_NONCEBYTES; i++) nonce[i] = (n >> 8 * i) & 0xff;
+  for (i = 0; i < prng_ctx_t::NONCEBYTES; i++) ctx.nonce[i] = (n >> 8 * i) & 0xff;
+}
+
+void prng_ctx_t::refill() {
+  size_t const unread = BUFFERBYTES - buffer_pos;
+  memmove(buffer, buffer + buffer_pos, unread);
+  stream(*this, buffer + unread, BUFFERBYTES - unread);
+  buffer_pos = 0;
+}
+
+prng_ctx_t &default_prng_ctx() {
+  static thread_local prng_ctx_t ctx;
+  return ctx;
+}
+
+void fastrandombytes(prng_ctx_t &ctx, unsigned char *r, unsigned long long rlen) {
+#ifdef NTT_USE_NOISE_CACHE
+    if (ctx.rand_pointer + rlen > CACHE_RAND_SIZE) {
+        ctx.rand_pointer = ctx.rand_pointer + rlen - CACHE_RAND_SIZE;
+        memcpy(r, CACHE_RAND+ctx.rand_pointer, rlen * sizeof(unsigned char));
+    } else {
+        memcpy(r, CACHE_RAND+ctx.rand_pointer, rlen * sizeof(unsigned char));
+        ctx.rand_pointer+=rlen;
+    }
+#else
+  // Large requests get a stream call of their own, small ones (masks,
+  // session ids, single bits) are served from the buffered keystream
+  // instead of paying the key setup of a call each
+  if (rlen >= prng_ctx_t::BUFFERBYTES) {
+    stream(ctx, r, rlen);
+    return;
+  }
+  while (rlen > 0) {
+    if (ctx.buffer_pos == prng_ctx_t::BUFFERBYTES) ctx.refill();
+    size_t const n = std::min<unsigned long long>(rlen, prng_ctx_t::BUFFERBYTES - ctx.buffer_pos);
+    memcpy(r, ctx.buffer + ctx.buffer_pos, n);
+    ctx.buffer_pos += n;
+    r += n;
+    rlen -= n;
+  }
 #endif
 }
+
+void fastrandombytes(unsigned char *r, unsigned long long rlen) {
+  fastrandombytes(default_prng_ctx(), r, rlen);
+}
 }
@@ -0,0 +1,76 @@
+/*
+ * AES-256 in counter mode with the AES-NI instructions, encrypting 8
+ * counter blocks at once to hide the latency of the rounds. Counter block:
+ * 8-byte nonce || 64-bit big-endian counter.
+ */
+
+#include <cstdint>
+#include <cstring>
+#include "nfl/prng/crypto_stream_aes256ctr.h"
+
+#ifdef NFL_HAVE_AES256CTR
+
+#include <immintrin.h>
+
+namespace {
+
+constexpr size_t BLOCKBYTES = 16;
+constexpr size_t WAYS = 8;
+constexpr size_t ROUNDS = 14;
+
+typedef __m128i block_t;
+
+inline __m128i expand(__m128i k, __m128i t) {
+  k = _mm_xor_si128(k, _mm_slli_si128(k, 4));
+  k = _mm_xor_si128(k, _mm_slli_si128(k, 4));
+  k = _mm_xor_si128(k, _mm_slli_si128(k, 4));
+  return _mm_xor_si128(k, t);
+}
+
+// The round constant of aeskeygenassist must be an immediate
+#define AES256_EXPAND(rk, i, rcon)                                                                  \
+  rk[2 * i] = expand(rk[2 * i - 2], _mm_shuffle_epi32(_mm_aeskeygenassist_si128(rk[2 * i - 1], rcon), 0xff)); \
+  rk[2 * i + 1] = expand(rk[2 * i - 1], _mm_shuffle_epi32(_mm_aeskeygenassist_si128(rk[2 * i], 0), 0xaa));
+
+void key_expansion(block_t rk[ROUNDS + 1], const unsigned char *k) {
+  rk[0] = _mm_loadu_si128((__m128i const *)k);
+  rk[1] = _mm_loadu_si128((__m128i const *)(k + 16));
+  AES256_EXPAND(rk, 1, 0x01) AES256_EXPAND(rk, 2, 0x02) AES256_EXPAND(rk, 3, 0x04)
+  AES256_EXPAND(rk, 4, 0x08) AES256_EXPAND(rk, 5, 0x10) AES256_EXPAND(rk, 6, 0x20)
+  rk[14] = expand(rk[12], _mm_shuffle_epi32(_mm_aeskeygenassist_si128(rk[13], 0x40), 0xff));
+}
+
+#undef AES256_EXPAND
+
+// Blocks ctr..ctr+7
+void aes256_blocks(unsigned char *out, const block_t rk[ROUNDS + 1], uint64_t nonce, uint64_t ctr) {
+  __m128i b[WAYS];
+  for (size_t j = 0; j < WAYS; j++)
+    b[j] = _mm_xor_si128(_mm_set_epi64x(__builtin_bswap64(ctr + j), nonce), rk[0]);
+  for (size_t r = 1; r < ROUNDS; r++)
+    for (size_t j = 0; j < WAYS; j++) b[j] = _mm_aesenc_si128(b[j], rk[r]);
+  for (size_t j = 0; j < WAYS; j++)
+    _mm_storeu_si128((__m128i *)(out + BLOCKBYTES * j), _mm_aesenclast_si128(b[j], rk[ROUNDS]));
+}
+
+}
+
+extern "C" int nfl_crypto_stream_aes256ctr(unsigned char *c, unsigned long long clen,
+                                           const unsigned char *n,
+                                           const unsigned char *k) {
+  constexpr size_t BATCHBYTES = WAYS * BLOCKBYTES;
+  block_t rk[ROUNDS + 1];
+  uint64_t nonce, ctr = 0;
+  key_expansion(rk, k);
+  memcpy(&nonce, n, sizeof(nonce));
+  for (; clen >= BATCHBYTES; clen -= BATCHBYTES, c += BATCHBYTES, ctr += WAYS)
+    aes256_blocks(c, rk, nonce, ctr);
+  if (clen) {
+    unsigned char tail[BATCHBYTES];
+    aes256_blocks(tail, rk, nonce, ctr);
+    memcpy(c, tail, clen);
+  }
+  return 0;
+}
+
+#endif
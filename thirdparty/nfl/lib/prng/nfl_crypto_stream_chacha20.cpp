@@ -0,0 +1,195 @@
+/*
+ * ChaCha20 stream, D. J. Bernstein's original variant: 64-bit block
+ * counter in words 12-13 and 64-bit nonce in words 14-15. The vector
+ * versions run one block per 32-bit lane and transpose the states back
+ * to blocks when storing them.
+ */
+
+#include <cstdint>
+#include <cstring>
+#include "nfl/prng/crypto_stream_chacha20.h"
+
+#if defined(NTT_AVX2) || defined(NTT_AVX512)
+#include <immintrin.h>
+#define CHACHA20_AVX2
+#elif defined(NTT_SSE)
+#include <immintrin.h>
+#define CHACHA20_SSE
+#endif
+
+namespace {
+
+constexpr size_t BLOCKBYTES = 64;
+
+inline uint32_t load32_le(const unsigned char *p) {
+  return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+inline void store32_le(unsigned char *p, uint32_t v) {
+  p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+}
+
+// Constants, key, counter (set per block) and nonce
+void chacha20_init(uint32_t s[16], const unsigned char *n, const unsigned char *k) {
+  s[0] = 0x61707865; s[1] = 0x3320646e; s[2] = 0x79622d32; s[3] = 0x6b206574;
+  for (size_t i = 0; i < 8; i++) s[4 + i] = load32_le(k + 4 * i);
+  s[12] = s[13] = 0;
+  s[14] = load32_le(n);
+  s[15] = load32_le(n + 4);
+}
+
+// Double rounds over the 16 state words, ADD/XOR/ROTL being the lane-wise
+// operations of the implementation
+#define CHACHA20_QR(x, a, b, c, d)                            \
+  x[a] = ADD(x[a], x[b]); x[d] = ROTL(XOR(x[d], x[a]), 16);   \
+  x[c] = ADD(x[c], x[d]); x[b] = ROTL(XOR(x[b], x[c]), 12);   \
+  x[a] = ADD(x[a], x[b]); x[d] = ROTL(XOR(x[d], x[a]), 8);    \
+  x[c] = ADD(x[c], x[d]); x[b] = ROTL(XOR(x[b], x[c]), 7);
+
+#define CHACHA20_ROUNDS(x)                                    \
+  for (int r = 0; r < 10; r++) {                              \
+    CHACHA20_QR(x, 0, 4, 8, 12) CHACHA20_QR(x, 1, 5, 9, 13)   \
+    CHACHA20_QR(x, 2, 6, 10, 14) CHACHA20_QR(x, 3, 7, 11, 15) \
+    CHACHA20_QR(x, 0, 5, 10, 15) CHACHA20_QR(x, 1, 6, 11, 12) \
+    CHACHA20_QR(x, 2, 7, 8, 13) CHACHA20_QR(x, 3, 4, 9, 14)   \
+  }
+
+#if defined(CHACHA20_AVX2)
+
+constexpr size_t WAYS = 8;
+
+inline __m256i rotl(__m256i x, int n) {
+  if (n == 16)
+    return _mm256_shuffle_epi8(x, _mm256_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+                                                   2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13));
+  if (n == 8)
+    return _mm256_shuffle_epi8(x, _mm256_setr_epi8(3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14,
+                                                   3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14));
+  return _mm256_or_si256(_mm256_slli_epi32(x, n), _mm256_srli_epi32(x, 32 - n));
+}
+
+// Words w..w+3 of the blocks of each 128-bit half to blocks
+inline void transpose4(__m256i &a, __m256i &b, __m256i &c, __m256i &d) {
+  __m256i t0 = _mm256_unpacklo_epi32(a, b), t1 = _mm256_unpackhi_epi32(a, b);
+  __m256i t2 = _mm256_unpacklo_epi32(c, d), t3 = _mm256_unpackhi_epi32(c, d);
+  a = _mm256_unpacklo_epi64(t0, t2); b = _mm256_unpackhi_epi64(t0, t2);
+  c = _mm256_unpacklo_epi64(t1, t3); d = _mm256_unpackhi_epi64(t1, t3);
+}
+
+#define ADD(a, b) _mm256_add_epi32(a, b)
+#define XOR(a, b) _mm256_xor_si256(a, b)
+#define ROTL(a, n) rotl(a, n)
+
+// Blocks ctr..ctr+7
+void chacha20_blocks(unsigned char *out, const uint32_t s[16], uint64_t ctr) {
+  uint32_t lo[WAYS], hi[WAYS];
+  for (size_t j = 0; j < WAYS; j++) {
+    lo[j] = (uint32_t)(ctr + j);
+    hi[j] = (uint32_t)((ctr + j) >> 32);
+  }
+  __m256i in[16], x[16];
+  for (size_t i = 0; i < 16; i++) in[i] = _mm256_set1_epi32(s[i]);
+  in[12] = _mm256_loadu_si256((__m256i const *)lo);
+  in[13] = _mm256_loadu_si256((__m256i const *)hi);
+  for (size_t i = 0; i < 16; i++) x[i] = in[i];
+  CHACHA20_ROUNDS(x)
+  for (size_t i = 0; i < 16; i++) x[i] = ADD(x[i], in[i]);
+  for (size_t i = 0; i < 16; i += 4) transpose4(x[i], x[i + 1], x[i + 2], x[i + 3]);
+  // x[4g+j] holds words 4g..4g+3 of blocks j (low half) and j+4 (high half)
+  for (size_t j = 0; j < 4; j++) {
+    unsigned char *b = out + BLOCKBYTES * j, *b4 = out + BLOCKBYTES * (j + 4);
+    _mm256_storeu_si256((__m256i *)b, _mm256_permute2x128_si256(x[j], x[4 + j], 0x20));
+    _mm256_storeu_si256((__m256i *)(b + 32), _mm256_permute2x128_si256(x[8 + j], x[12 + j], 0x20));
+    _mm256_storeu_si256((__m256i *)b4, _mm256_permute2x128_si256(x[j], x[4 + j], 0x31));
+    _mm256_storeu_si256((__m256i *)(b4 + 32), _mm256_permute2x128_si256(x[8 + j], x[12 + j], 0x31));
+  }
+}
+
+#elif defined(CHACHA20_SSE)
+
+constexpr size_t WAYS = 4;
+
+inline __m128i rotl(__m128i x, int n) {
+#ifdef __SSSE3__
+  if (n == 16)
+    return _mm_shuffle_epi8(x, _mm_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13));
+  if (n == 8)
+    return _mm_shuffle_epi8(x, _mm_setr_epi8(3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14));
+#endif
+  return _mm_or_si128(_mm_slli_epi32(x, n), _mm_srli_epi32(x, 32 - n));
+}
+
+inline void transpose4(__m128i &a, __m128i &b, __m128i &c, __m128i &d) {
+  __m128i t0 = _mm_unpacklo_epi32(a, b), t1 = _mm_unpackhi_epi32(a, b);
+  __m128i t2 = _mm_unpacklo_epi32(c, d), t3 = _mm_unpackhi_epi32(c, d);
+  a = _mm_unpacklo_epi64(t0, t2); b = _mm_unpackhi_epi64(t0, t2);
+  c = _mm_unpacklo_epi64(t1, t3); d = _mm_unpackhi_epi64(t1, t3);
+}
+
+#define ADD(a, b) _mm_add_epi32(a, b)
+#define XOR(a, b) _mm_xor_si128(a, b)
+#define ROTL(a, n) rotl(a, n)
+
+// Blocks ctr..ctr+3
+void chacha20_blocks(unsigned char *out, const uint32_t s[16], uint64_t ctr) {
+  uint32_t lo[WAYS], hi[WAYS];
+  for (size_t j = 0; j < WAYS; j++) {
+    lo[j] = (uint32_t)(ctr + j);
+    hi[j] = (uint32_t)((ctr + j) >> 32);
+  }
+  __m128i in[16], x[16];
+  for (size_t i = 0; i < 16; i++) in[i] = _mm_set1_epi32(s[i]);
+  in[12] = _mm_loadu_si128((__m128i const *)lo);
+  in[13] = _mm_loadu_si128((__m128i const *)hi);
+  for (size_t i = 0; i < 16; i++) x[i] = in[i];
+  CHACHA20_ROUNDS(x)
+  for (size_t i = 0; i < 16; i++) x[i] = ADD(x[i], in[i]);
+  for (size_t i = 0; i < 16; i += 4) transpose4(x[i], x[i + 1], x[i + 2], x[i + 3]);
+  for (size_t j = 0; j < WAYS; j++)
+    for (size_t g = 0; g < 4; g++)
+      _mm_storeu_si128((__m128i *)(out + BLOCKBYTES * j + 16 * g), x[4 * g + j]);
+}
+
+#else
+
+constexpr size_t WAYS = 1;
+
+#define ADD(a, b) ((a) + (b))
+#define XOR(a, b) ((a) ^ (b))
+#define ROTL(a, n) (((a) << (n)) | ((a) >> (32 - (n))))
+
+// Block ctr
+void chacha20_blocks(unsigned char *out, const uint32_t s[16], uint64_t ctr) {
+  uint32_t in[16], x[16];
+  memcpy(in, s, sizeof(in));
+  in[12] = (uint32_t)ctr;
+  in[13] = (uint32_t)(ctr >> 32);
+  memcpy(x, in, sizeof(x));
+  CHACHA20_ROUNDS(x)
+  for (size_t i = 0; i < 16; i++) store32_le(out + 4 * i, ADD(x[i], in[i]));
+}
+
+#endif
+
+#undef ADD
+#undef XOR
+#undef ROTL
+
+}
+
+extern "C" int nfl_crypto_stream_chacha20(unsigned char *c, unsigned long long clen,
+                                          const unsigned char *n,
+                                          const unsigned char *k) {
+  constexpr size_t BATCHBYTES = WAYS * BLOCKBYTES;
+  uint32_t s[16];
+  uint64_t ctr = 0;
+  chacha20_init(s, n, k);
+  for (; clen >= BATCHBYTES; clen -= BATCHBYTES, c += BATCHBYTES, ctr += WAYS)
+    chacha20_blocks(c, s, ctr);
+  if (clen) {
+    unsigned char tail[BATCHBYTES];
+    chacha20_blocks(tail, s, ctr);
+    memcpy(c, tail, clen);
+  }
+  return 0;
+}
@@ -6,18 +6,20 @@
 
 namespace nfl {
 
-static int fd = -1;
+static int open_urandom() {
+  int fd;
+  for (;;) {
+    fd = open("/dev/urandom", O_RDONLY);
+    if (fd != -1) break;
+    sleep(1);
+  }
+  return fd;
+}
 
 void randombytes(unsigned char *x, unsigned long long xlen) {
   int i;
-
-  if (fd == -1) {
-    for (;;) {
-      fd = open("/dev/urandom", O_RDONLY);
-      if (fd != -1) break;
-      sleep(1);
-    }
-  }
+  // Opened once, thread-safe initialisation
+  static const int fd = open_urandom();
 
   while (xlen > 0) {
     i = (xlen < 1048576) ? xlen : 1048576;